@@ -0,0 +1,981 @@
+#include "ConcurrentMemoryPool.h"
+#include "DiffusionCPU.h"
+#include "DynamicKDTree.h"
+#include "FlatKDTree.h"
+#include "FreeList.h"
+#include "HexGrid.h"
+#include "HexReactionDiffusionCPU.h"
+#include "KDTree.hpp"
+#include "ReactionDiffusionCPU.h"
+#include "ReactionDiffusionBatch.h"
+#include "SizeClassAllocator.h"
+#include "MemoryPool.h"
+#include "ParticlesCPU.h"
+#include "ThreadPool.hpp"
+#include "Timer.h"
+#include "VirtualArena.h"
+#include "WorkStealingPool.h"
+
+#include "print.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/common.hpp>
+
+// Steps per second of DiffusionCPU::step(R, number_of_steps) for several
+// number of fused steps
+// fused_steps = 1 corresponds to the unfused DiffusionCPU::step(R)
+void diffusion_temporal_blocking(){
+
+    constexpr int grid_sizes[] = {256, 1024, 2048, 4096};
+    constexpr int fused_steps[] = {1, 2, 4, 8};
+    constexpr int steps_per_run = 64;
+    constexpr float R = 0.35f;
+
+    print("---- DiffusionCPU temporal blocking ----");
+    print("grid fused_steps steps/s ns/cell/step");
+
+    for(const int grid_size : grid_sizes){
+
+        DiffusionCPU simulation;
+        simulation.max_fused_steps = 8;
+        simulation.start(grid_size, grid_size);
+        simulation.interaction(0.f, 0.f, 0.25f, DiffusionCPU::SOURCE);
+        simulation.interaction(0.5f, 0.5f, 0.1f, DiffusionCPU::SINK);
+
+        for(const int fused : fused_steps){
+            simulation.max_fused_steps = fused;
+
+            // warm up
+            simulation.step(R, fused);
+
+            Timer timer;
+            timer.start();
+            simulation.step(R, steps_per_run);
+            const double seconds = timer.get<double, Timer::seconds>();
+
+            const double steps_per_second = steps_per_run / seconds;
+            const double ns_per_cell = seconds * 1e9 / ((double)steps_per_run * grid_size * grid_size);
+
+            print(grid_size, fused, steps_per_second, ns_per_cell);
+        }
+    }
+}
+
+// Steps per second of ReactionDiffusionCPU::step() against a scalar loop on
+// the interleaved {u, v} layout of the ReactionDiffusion textures
+void reaction_diffusion_vectorized(){
+
+    constexpr int grid_sizes[] = {256, 1024, 2048};
+    constexpr int steps_per_run = 16;
+
+    print("---- ReactionDiffusionCPU vectorized step ----");
+    print("grid version steps/s ns/cell/step");
+
+    for(const int grid_size : grid_sizes){
+
+        ReactionDiffusionCPU simulation;
+        simulation.start(grid_size, grid_size);
+        simulation.point(0.f, 0.f, 0.25f, 0.f, 1.f);
+
+        // ---- Scalar ---- //
+
+        std::vector<float> state(2 * grid_size * grid_size);
+        std::vector<float> next(2 * grid_size * grid_size);
+        simulation.get_state(state.data());
+
+        Timer timer;
+        timer.start();
+        for(int istep = 0; istep != steps_per_run; ++istep){
+            for(int y = 0; y != grid_size; ++y){
+                const float* row = state.data() + 2 * y * grid_size;
+                const float* row_down = state.data() + 2 * std::max(y - 1, 0) * grid_size;
+                const float* row_up = state.data() + 2 * std::min(y + 1, grid_size - 1) * grid_size;
+
+                for(int x = 0; x != grid_size; ++x){
+                    const int left = 2 * std::max(x - 1, 0);
+                    const int right = 2 * std::min(x + 1, grid_size - 1);
+
+                    for(int channel = 0; channel != 2; ++channel){
+                        const float laplacian = (1.f / 6.f) *
+                            (4.f * (row[right + channel] + row[left + channel]
+                                + row_up[2 * x + channel] + row_down[2 * x + channel])
+                            + row_down[left + channel] + row_down[right + channel]
+                            + row_up[left + channel] + row_up[right + channel]
+                            - 20.f * row[2 * x + channel]);
+                        next[2 * (y * grid_size + x) + channel] = row[2 * x + channel]
+                            + (channel == 0 ? simulation.sim_Ru : simulation.sim_Rv) * laplacian;
+                    }
+
+                    const float u = row[2 * x];
+                    const float v = row[2 * x + 1];
+                    next[2 * (y * grid_size + x)] += - u * v * v + simulation.sim_F * (1.f - u);
+                    next[2 * (y * grid_size + x) + 1] += u * v * v - (simulation.sim_F + simulation.sim_R) * v;
+                }
+            }
+            state.swap(next);
+        }
+        const double scalar_seconds = timer.get<double, Timer::seconds>();
+
+        // ---- Vectorized ---- //
+
+        simulation.step();
+
+        timer.start();
+        for(int istep = 0; istep != steps_per_run; ++istep){
+            simulation.step();
+        }
+        const double vectorized_seconds = timer.get<double, Timer::seconds>();
+
+        const double cells = (double)steps_per_run * grid_size * grid_size;
+        print(grid_size, "scalar", steps_per_run / scalar_seconds, scalar_seconds * 1e9 / cells);
+        print(grid_size, "vectorized", steps_per_run / vectorized_seconds, vectorized_seconds * 1e9 / cells);
+    }
+}
+
+// Instances per second of a 256 x 256 (F, k) sweep with ReactionDiffusionBatch
+// for several sizes of instance grids
+void reaction_diffusion_sweep(){
+
+    constexpr int instance_sizes[] = {16, 32, 64};
+    constexpr int parameter_count = 256;
+    constexpr int steps_per_instance = 32;
+
+    print("---- ReactionDiffusionBatch parameter sweep ----");
+    print("instance_grid instances/s ns/cell/step");
+
+    for(const int instance_size : instance_sizes){
+
+        ReactionDiffusionBatch simulation;
+        simulation.start(instance_size, instance_size, 4096);
+
+        double checksum = 0.;
+
+        Timer timer;
+        timer.start();
+        simulation.sweep(0.01f, 0.08f, parameter_count, 0.04f, 0.07f, parameter_count, steps_per_instance,
+                [&checksum](const int, const int, const float, const float,
+                    const ReactionDiffusionBatch::Statistics& statistics){
+
+            checksum += statistics.mean_v;
+        });
+        const double seconds = timer.get<double, Timer::seconds>();
+
+        const double instances = (double)parameter_count * parameter_count;
+        const double cells = instances * instance_size * instance_size * steps_per_instance;
+        print(instance_size, instances / seconds, seconds * 1e9 / cells, "checksum", checksum);
+    }
+}
+
+// Time per particle of ParticlesCPU::step with a neighbor radius that keeps
+// the same mean number of neighbors ie the cost is linear when it is constant
+void particles_neighbor_search(){
+
+    constexpr int particle_counts[] = {1024, 16384, 262144, 1048576};
+    constexpr float mean_neighbors = 16.f;
+    constexpr int steps_per_run = 4;
+
+    print("---- ParticlesCPU neighbor search ----");
+    print("particles radius steps/s ns/particle/step");
+
+    for(const int particles : particle_counts){
+
+        // area of the disc = mean_neighbors / density with a domain of area 4
+        const float radius = std::sqrt(mean_neighbors * 4.f / (3.14159265f * particles));
+
+        ParticlesCPU simulation;
+        simulation.neighbor_radius = radius;
+        simulation.start(particles);
+        simulation.step(0.01f);
+
+        Timer timer;
+        timer.start();
+        for(int istep = 0; istep != steps_per_run; ++istep){
+            simulation.step(0.01f);
+        }
+        const double seconds = timer.get<double, Timer::seconds>();
+
+        print(particles, radius, steps_per_run / seconds, seconds * 1e9 / ((double)steps_per_run * particles));
+    }
+}
+
+// Tasks per second for tasks incrementing a counter, submitted by the main
+// thread to ThreadPool::Enqueue and WorkStealingPool::run, and created by the
+// recursive splitting of WorkStealingPool::parallel_for with a grain of 1
+void thread_pool_tiny_tasks(){
+
+    constexpr unsigned int thread_counts[] = {1, 2, 4, 8};
+    constexpr int number_of_tasks = 1 << 18;
+
+    print("---- Tiny tasks ----");
+    print("threads pool tasks/s");
+
+    for(const unsigned int threads : thread_counts){
+
+        std::atomic<int> counter(0);
+        std::atomic<int>* counter_pointer = &counter;
+
+        // ---- ThreadPool ---- //
+
+        {
+            ThreadPool pool(threads);
+            std::vector<std::future<void>> tasks;
+            tasks.reserve(number_of_tasks);
+
+            Timer timer;
+            timer.start();
+            for(int itask = 0; itask != number_of_tasks; ++itask){
+                tasks.push_back(pool.Enqueue([counter_pointer](){
+                    counter_pointer->fetch_add(1, std::memory_order_relaxed);
+                }));
+            }
+            for(std::future<void>& task : tasks){
+                task.wait();
+            }
+            const double seconds = timer.get<double, Timer::seconds>();
+
+            print(threads, "ThreadPool", number_of_tasks / seconds);
+        }
+
+        // ---- WorkStealingPool ---- //
+
+        {
+            WorkStealingPool pool(threads);
+
+            Timer timer;
+            timer.start();
+            WorkStealingPool::TaskGroup group;
+            for(int itask = 0; itask != number_of_tasks; ++itask){
+                pool.run(group, [counter_pointer](){
+                    counter_pointer->fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            pool.wait(group);
+            const double run_seconds = timer.get<double, Timer::seconds>();
+
+            timer.start();
+            pool.parallel_for(0, number_of_tasks, 1, [counter_pointer](const int begin, const int end){
+                counter_pointer->fetch_add(end - begin, std::memory_order_relaxed);
+            });
+            const double parallel_for_seconds = timer.get<double, Timer::seconds>();
+
+            print(threads, "WorkStealingPool::run", number_of_tasks / run_seconds);
+            print(threads, "WorkStealingPool::parallel_for", number_of_tasks / parallel_for_seconds);
+        }
+
+        if(counter.load() != 3 * number_of_tasks){
+            print("error : missing tasks", counter.load(), "of", 3 * number_of_tasks);
+        }
+    }
+}
+
+void memory_pool_contention(){
+
+    constexpr unsigned int thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+    constexpr int total_operations = 1 << 22;
+    constexpr int burst = 16;
+    constexpr size_t object_size = 32;
+
+    print("---- Memory pool contention ----");
+    print("threads allocator get+give/s");
+
+    // each thread repeatedly gets /burst/ blocks and gives them back
+    auto run_threads = [](const unsigned int threads, const auto& thread_function){
+        std::vector<std::thread> workers;
+        Timer timer;
+        timer.start();
+        for(unsigned int ithread = 0; ithread != threads; ++ithread){
+            workers.emplace_back(thread_function);
+        }
+        for(std::thread& worker : workers){
+            worker.join();
+        }
+        return timer.get<double, Timer::seconds>();
+    };
+
+    struct Object{
+        char data[object_size];
+    };
+
+    for(const unsigned int threads : thread_counts){
+        const int bursts_per_thread = total_operations / burst / threads;
+        const double operations = (double)bursts_per_thread * burst * threads;
+
+        // ---- malloc ---- //
+
+        {
+            const double seconds = run_threads(threads, [bursts_per_thread](){
+                void* objects[burst];
+                for(int iburst = 0; iburst != bursts_per_thread; ++iburst){
+                    for(int iobject = 0; iobject != burst; ++iobject){
+                        objects[iobject] = malloc(object_size);
+                        *(volatile char*)objects[iobject] = 0;
+                    }
+                    for(int iobject = 0; iobject != burst; ++iobject){
+                        free(objects[iobject]);
+                    }
+                }
+            });
+            print(threads, "malloc", operations / seconds);
+        }
+
+        // ---- MemoryPool + std::mutex ---- //
+
+        {
+            MemoryPool<object_size> pool;
+            pool.allocate(burst * threads);
+            std::mutex pool_mutex;
+
+            const double seconds = run_threads(threads, [&pool, &pool_mutex, bursts_per_thread](){
+                Object* objects[burst];
+                for(int iburst = 0; iburst != bursts_per_thread; ++iburst){
+                    for(int iobject = 0; iobject != burst; ++iobject){
+                        std::lock_guard<std::mutex> lock(pool_mutex);
+                        objects[iobject] = pool.get<Object>();
+                    }
+                    for(int iobject = 0; iobject != burst; ++iobject){
+                        std::lock_guard<std::mutex> lock(pool_mutex);
+                        pool.give(objects[iobject]);
+                    }
+                }
+            });
+            print(threads, "MemoryPool + mutex", operations / seconds);
+        }
+
+        // ---- ConcurrentMemoryPool ---- //
+
+        {
+            // enough blocks for every cache to be full
+            ConcurrentMemoryPool<object_size> pool;
+            pool.allocate(3 * 32 * threads);
+
+            const double seconds = run_threads(threads, [&pool, bursts_per_thread](){
+                ConcurrentMemoryPool<object_size>::Cache cache(pool);
+                Object* objects[burst];
+                for(int iburst = 0; iburst != bursts_per_thread; ++iburst){
+                    for(int iobject = 0; iobject != burst; ++iobject){
+                        objects[iobject] = cache.get<Object>();
+                    }
+                    for(int iobject = 0; iobject != burst; ++iobject){
+                        cache.give(objects[iobject]);
+                    }
+                }
+            });
+            print(threads, "ConcurrentMemoryPool", operations / seconds);
+        }
+    }
+}
+
+void size_class_containers(){
+
+    constexpr int number_of_values = 1 << 18;
+    constexpr int repetitions = 8;
+
+    print("---- Size class allocator ----");
+    print("resource container operations/s");
+
+    auto run = [](std::pmr::memory_resource* resource){
+        Timer timer;
+        timer.start();
+        for(int irepetition = 0; irepetition != repetitions; ++irepetition){
+            std::pmr::map<int, int> map(resource);
+            std::pmr::list<float> list(resource);
+            for(int ivalue = 0; ivalue != number_of_values; ++ivalue){
+                map[(ivalue * 7919) % number_of_values] = ivalue;
+                list.push_back((float)ivalue);
+            }
+        }
+        return (double)repetitions * number_of_values / timer.get<double, Timer::seconds>();
+    };
+
+    print("new_delete_resource", "map+list", run(std::pmr::new_delete_resource()));
+
+    SizeClassAllocator allocator;
+    print("SizeClassAllocator", "map+list", run(&allocator));
+}
+
+void free_list_latency(){
+
+    constexpr int number_of_operations = 1 << 20;
+    constexpr int max_live_blocks = 4096;
+
+    print("---- FreeList latency ----");
+    print("allocator mean_ns p99.9_ns max_ns");
+
+    // the same sequence of gets and gives for both allocators, each operation
+    // is timed separately to measure the worst case
+    auto run = [](const char* name, const auto& get_bytes, const auto& give_bytes){
+        std::vector<void*> blocks;
+        blocks.reserve(max_live_blocks);
+        std::vector<float> latencies(number_of_operations);
+
+        unsigned int random = 12345;
+        Timer timer;
+        for(int ioperation = 0; ioperation != number_of_operations; ++ioperation){
+            random = random * 1664525u + 1013904223u;
+            const bool get = blocks.empty() || ((random >> 16) % 2 && blocks.size() != max_live_blocks);
+
+            timer.start();
+            if(get){
+                blocks.push_back(get_bytes(16 + (random >> 8) % 2048));
+            }else{
+                const size_t iblock = (random >> 8) % blocks.size();
+                give_bytes(blocks[iblock]);
+                blocks[iblock] = blocks.back();
+                blocks.pop_back();
+            }
+            latencies[ioperation] = timer.get<float, Timer::nano>();
+        }
+        for(void* block : blocks){
+            give_bytes(block);
+        }
+
+        double sum = 0.;
+        for(const float latency : latencies){
+            sum += latency;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        print(name, sum / number_of_operations, latencies[number_of_operations - number_of_operations / 1000],
+                latencies.back());
+    };
+
+    run("malloc", [](const size_t bytes){return malloc(bytes);}, [](void* ptr){free(ptr);});
+
+    FreeList free_list;
+    free_list.allocate(max_live_blocks * 4096);
+    FreeList* free_list_pointer = &free_list;
+    run("FreeList", [free_list_pointer](const size_t bytes){return free_list_pointer->get_bytes(bytes);},
+            [free_list_pointer](void* ptr){free_list_pointer->give_bytes(ptr);});
+}
+
+void virtual_arena_tlb(){
+
+    constexpr size_t buffer_bytes = (size_t)1 << 30;
+    constexpr size_t number_of_values = buffer_bytes / sizeof(float);
+    constexpr int number_of_reads = 1 << 24;
+
+    print("---- VirtualArena huge pages ----");
+    print("backing random_reads/s");
+
+    // dependent random reads ie each read waits for the previous one so the
+    // TLB misses are not hidden by the out of order execution
+    auto run = [](const char* name, float* values){
+        for(size_t ivalue = 0; ivalue != number_of_values; ++ivalue){
+            values[ivalue] = 0.f;
+        }
+
+        Timer timer;
+        timer.start();
+        size_t index = 0;
+        float sum = 0.f;
+        for(int iread = 0; iread != number_of_reads; ++iread){
+            const float value = values[index];
+            sum += value;
+            index = (index * 6364136223846793005ull + 1442695040888963407ull + (size_t)value) % number_of_values;
+        }
+        print(name, number_of_reads / timer.get<double, Timer::seconds>(), sum);
+    };
+
+    float* values = (float*)malloc(buffer_bytes);
+    if(values){
+        run("malloc", values);
+        free(values);
+    }
+
+    VirtualArena arena;
+    if(arena.reserve(buffer_bytes, VirtualArena::NONE)){
+        run("VirtualArena::NONE", (float*)arena.get_bytes(buffer_bytes));
+    }
+    if(arena.reserve(buffer_bytes, VirtualArena::TRANSPARENT)){
+        run("VirtualArena::TRANSPARENT", (float*)arena.get_bytes(buffer_bytes));
+    }
+    if(arena.reserve(buffer_bytes, VirtualArena::EXPLICIT) && arena.huge_pages == VirtualArena::EXPLICIT){
+        run("VirtualArena::EXPLICIT", (float*)arena.get_bytes(buffer_bytes));
+    }
+}
+
+void hexgrid_build(){
+
+    constexpr unsigned int width = 1000;
+    constexpr unsigned int height = 1000;
+    constexpr int sweeps = 10;
+
+    print("---- HexGrid build ----");
+    print("layout cells seconds");
+
+    Timer timer;
+
+    HexGrid<float> scanline;
+    timer.start();
+    scanline.buildGridScanline(width, height);
+    print("scanline", scanline.number_of_cells, timer.get<double, Timer::seconds>());
+
+    std::vector<glm::ivec3> coords(scanline.number_of_cells);
+    for(unsigned int icell = 0; icell != scanline.number_of_cells; ++icell){
+        coords[icell] = scanline.cell_coord(icell);
+    }
+
+    HexGrid<float> custom;
+    timer.start();
+    custom.buildCustom(coords);
+    print("custom", custom.number_of_cells, timer.get<double, Timer::seconds>());
+
+    // the neighbor search of the previous std::map<glm::ivec3, HexCell*>
+    timer.start();
+    std::map<uint64_t, uint32_t> coord_to_cell;
+    for(unsigned int icell = 0; icell != scanline.number_of_cells; ++icell){
+        coord_to_cell.emplace(pack_axial(coords[icell]), icell);
+    }
+    std::vector<uint32_t> neighbor_indices(6 * scanline.number_of_cells);
+    for(unsigned int icell = 0; icell != scanline.number_of_cells; ++icell){
+        for(int ineighbor = 0; ineighbor != 6; ++ineighbor){
+            auto neighbor = coord_to_cell.find(pack_axial(coords[icell] + neighbor_coord[ineighbor]));
+            neighbor_indices[6 * icell + ineighbor] = (neighbor != coord_to_cell.end()) ? neighbor->second : HexGrid<float>::invalid_cell;
+        }
+    }
+    print("std::map", scanline.number_of_cells, timer.get<double, Timer::seconds>());
+
+    // average of the neighbors through the neighbor table
+    std::vector<float> output(scanline.number_of_cells);
+    for(unsigned int icell = 0; icell != scanline.number_of_cells; ++icell){
+        scanline.grid_values[icell] = (float)(icell % 7);
+    }
+    timer.start();
+    for(int isweep = 0; isweep != sweeps; ++isweep){
+        for(unsigned int icell = 0; icell != scanline.number_of_cells; ++icell){
+            const uint32_t* neighbors = scanline.neighbor_indices + 6 * icell;
+            float sum = 0.f;
+            for(int ineighbor = 0; ineighbor != 6; ++ineighbor){
+                sum += (neighbors[ineighbor] != HexGrid<float>::invalid_cell) ? scanline.grid_values[neighbors[ineighbor]] : 0.f;
+            }
+            output[icell] = sum / 6.f;
+        }
+    }
+    print("neighbor sweep ns/cell", timer.get<double, Timer::nano>() / sweeps / scanline.number_of_cells, output[width + 1]);
+}
+
+// ns/cell/step of HexReactionDiffusionCPU on a scanline grid, on a layered
+// grid of about the same number of cells ie only through the neighbor table,
+// and of ReactionDiffusionCPU on the square grid of the same size
+void hex_reaction_diffusion(){
+
+    constexpr int grid_sizes[] = {256, 1024, 2048};
+    constexpr int steps_per_run = 16;
+
+    print("---- HexReactionDiffusionCPU step ----");
+    print("grid version steps/s ns/cell/step");
+
+    for(const int grid_size : grid_sizes){
+
+        auto run = [&](const char* version, const double cells, auto&& step){
+            step();
+
+            Timer timer;
+            timer.start();
+            for(int istep = 0; istep != steps_per_run; ++istep){
+                step();
+            }
+            const double seconds = timer.get<double, Timer::seconds>();
+
+            print(grid_size, version, steps_per_run / seconds, seconds * 1e9 / (steps_per_run * cells));
+        };
+
+        ReactionDiffusionCPU square;
+        square.start(grid_size, grid_size);
+        square.point(0.f, 0.f, 0.25f, 0.f, 1.f);
+        run("square", (double)grid_size * grid_size, [&](){ square.step(); });
+
+        HexReactionDiffusionCPU scanline;
+        scanline.start(grid_size, grid_size);
+        scanline.point(scanline.grid.cell_coord(grid_size * grid_size / 2 + grid_size / 2), grid_size / 8, 0.f, 1.f);
+        run("hex_scanline", scanline.grid.number_of_cells, [&](){ scanline.step(); });
+        run("hex_scanline_diffusion", scanline.grid.number_of_cells, [&](){ scanline.step_diffusion(0.2f); });
+
+        // 3 * layers^2 cells
+        HexReactionDiffusionCPU layered;
+        layered.start_layered((int)(grid_size / std::sqrt(3.)));
+        layered.point(glm::ivec3(0), grid_size / 8, 0.f, 1.f);
+        run("hex_layered", layered.grid.number_of_cells, [&](){ layered.step(); });
+    }
+}
+
+// Point in [0;1[^3 from a linear congruential generator updating /random/,
+// the sequence is the same on every platform unlike rand()
+static glm::vec3 random_point(unsigned int& random){
+    float coordinates[3];
+    for(float& coordinate : coordinates){
+        random = random * 1664525u + 1013904223u;
+        coordinate = (float)(random >> 8) / (float)(1u << 24);
+    }
+    return glm::vec3(coordinates[0], coordinates[1], coordinates[2]);
+}
+
+// Build time and nearest neighbor queries per second of KDTree and FlatKDTree
+// on the same uniformly distributed points
+// mismatches counts the queries where KDTree::searchNN does not return a
+// point at the nearest distance, up to the rounding of the vectorized distances
+void kdtree_nearest(){
+
+    constexpr unsigned int number_of_points = 1000000;
+    constexpr unsigned int number_of_queries = 10000000;
+
+    print("---- KDTree nearest neighbor ----");
+    print("version build_s queries/s ns/query mismatches");
+
+    unsigned int random = 12345;
+
+    std::vector<glm::vec3> points(number_of_points);
+    std::vector<Star> stars(number_of_points);
+    for(unsigned int ipoint = 0; ipoint != number_of_points; ++ipoint){
+        points[ipoint] = random_point(random);
+        stars[ipoint].mPosition.mX = points[ipoint].x;
+        stars[ipoint].mPosition.mY = points[ipoint].y;
+        stars[ipoint].mPosition.mZ = points[ipoint].z;
+    }
+
+    std::vector<glm::vec3> queries(number_of_queries);
+    for(glm::vec3& query : queries){
+        query = random_point(random);
+    }
+
+    // ---- FlatKDTree ---- //
+
+    Timer timer;
+    timer.start();
+    FlatKDTree flat_tree;
+    flat_tree.build(points.data(), number_of_points);
+    const double flat_build_seconds = timer.get<double, Timer::seconds>();
+
+    std::vector<float> flat_distances(number_of_queries);
+    timer.start();
+    for(unsigned int iquery = 0; iquery != number_of_queries; ++iquery){
+        flat_tree.nearest(queries[iquery], &flat_distances[iquery]);
+    }
+    const double flat_seconds = timer.get<double, Timer::seconds>();
+
+    // ---- KDTree ---- //
+
+    timer.start();
+    KDTree tree;
+    tree.build(stars.begin(), stars.end());
+    const double build_seconds = timer.get<double, Timer::seconds>();
+
+    unsigned int mismatches = 0;
+    Star query_star;
+    timer.start();
+    for(unsigned int iquery = 0; iquery != number_of_queries; ++iquery){
+        query_star.mPosition.mX = queries[iquery].x;
+        query_star.mPosition.mY = queries[iquery].y;
+        query_star.mPosition.mZ = queries[iquery].z;
+
+        const Star* nearest = tree.searchNN(&query_star);
+        const glm::vec3 difference = glm::vec3(nearest->mPosition.mX, nearest->mPosition.mY, nearest->mPosition.mZ)
+            - queries[iquery];
+        mismatches += difference.x * difference.x + difference.y * difference.y + difference.z * difference.z
+            > flat_distances[iquery] + 1e-6f;
+    }
+    const double seconds = timer.get<double, Timer::seconds>();
+
+    print("KDTree", build_seconds, number_of_queries / seconds, seconds * 1e9 / number_of_queries, mismatches);
+    print("FlatKDTree", flat_build_seconds, number_of_queries / flat_seconds, flat_seconds * 1e9 / number_of_queries, 0);
+}
+
+// Queries per second of FlatKDTree on uniformly distributed points: nearest
+// in the order of the queries, nearest_batch, knn and radius with about
+// /k/ points within the radius
+void kdtree_queries(){
+
+    constexpr unsigned int number_of_points = 1000000;
+    constexpr unsigned int number_of_queries = 1000000;
+    constexpr unsigned int k = 8;
+    const float radius = std::cbrt(3.f * k / (4.f * 3.14159265f * number_of_points));
+
+    print("---- FlatKDTree queries ----");
+    print("query queries/s ns/query");
+
+    unsigned int random = 12345;
+
+    std::vector<glm::vec3> points(number_of_points);
+    for(glm::vec3& point : points){
+        point = random_point(random);
+    }
+    std::vector<glm::vec3> queries(number_of_queries);
+    for(glm::vec3& query : queries){
+        query = random_point(random);
+    }
+
+    FlatKDTree tree;
+    tree.build(points.data(), number_of_points);
+
+    std::vector<uint32_t> indices(number_of_queries);
+    std::vector<float> distances(number_of_queries);
+
+    auto run = [&](const char* query, auto&& function){
+        Timer timer;
+        timer.start();
+        function();
+        const double seconds = timer.get<double, Timer::seconds>();
+        print(query, number_of_queries / seconds, seconds * 1e9 / number_of_queries);
+    };
+
+    run("nearest", [&](){
+        for(unsigned int iquery = 0; iquery != number_of_queries; ++iquery){
+            indices[iquery] = tree.nearest(queries[iquery], &distances[iquery]);
+        }
+    });
+
+    run("nearest_batch", [&](){
+        tree.nearest_batch(queries.data(), number_of_queries, indices.data(), distances.data());
+    });
+
+    run("knn", [&](){
+        FlatKDTree::Neighbor neighbors[k];
+        for(unsigned int iquery = 0; iquery != number_of_queries; ++iquery){
+            tree.knn(queries[iquery], k, neighbors);
+            indices[iquery] = neighbors[0].index;
+        }
+    });
+
+    unsigned int found = 0;
+    run("radius", [&](){
+        for(unsigned int iquery = 0; iquery != number_of_queries; ++iquery){
+            tree.radius(queries[iquery], radius, [&found](const uint32_t, const float){
+                ++found;
+            });
+        }
+    });
+    print("radius", radius, "points per query", (double)found / number_of_queries);
+}
+
+// Points per second of FlatKDTree::build on uniformly distributed points,
+// sequential and with a WorkStealingPool of 1, 2, 4, ... threads up to the
+// number of hardware threads
+void kdtree_parallel_build(){
+
+    constexpr unsigned int number_of_points = 10000000;
+
+    print("---- FlatKDTree build ----");
+    print("threads build_s points/s points/s/thread");
+
+    unsigned int random = 12345;
+
+    std::vector<glm::vec3> points(number_of_points);
+    for(glm::vec3& point : points){
+        point = random_point(random);
+    }
+
+    FlatKDTree tree;
+
+    Timer timer;
+    timer.start();
+    tree.build(points.data(), number_of_points);
+    const double sequential_seconds = timer.get<double, Timer::seconds>();
+    print("sequential", sequential_seconds, number_of_points / sequential_seconds, number_of_points / sequential_seconds);
+
+    const unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned int number_of_threads = 1; number_of_threads <= max_threads; number_of_threads *= 2){
+        WorkStealingPool thread_pool(number_of_threads);
+
+        timer.start();
+        tree.build(points.data(), number_of_points, &thread_pool);
+        const double seconds = timer.get<double, Timer::seconds>();
+        print(number_of_threads, seconds, number_of_points / seconds, number_of_points / seconds / number_of_threads);
+    }
+}
+
+// Time to get a queryable FlatKDTree by building it or by mapping a file
+// written by FlatKDTree::write, and nearest queries per second on the built
+// and on the mapped tree
+// The file is in the page cache after write ie a first launch would also
+// read it from the disk
+void kdtree_mapped_file(){
+
+    constexpr unsigned int number_of_points = 10000000;
+    constexpr unsigned int number_of_queries = 1000000;
+    const char* path = "benchmark_flat_kdtree.bin";
+
+    print("---- FlatKDTree file ----");
+
+    unsigned int random = 12345;
+
+    std::vector<glm::vec3> points(number_of_points);
+    for(glm::vec3& point : points){
+        point = random_point(random);
+    }
+    std::vector<glm::vec3> queries(number_of_queries);
+    for(glm::vec3& query : queries){
+        query = random_point(random);
+    }
+
+    Timer timer;
+    timer.start();
+    FlatKDTree tree;
+    tree.build(points.data(), number_of_points);
+    const double build_seconds = timer.get<double, Timer::seconds>();
+
+    timer.start();
+    tree.write(path);
+    const double write_seconds = timer.get<double, Timer::seconds>();
+
+    timer.start();
+    FlatKDTree mapped_tree;
+    mapped_tree.map(path);
+    const double map_seconds = timer.get<double, Timer::seconds>();
+
+    print("build_s", build_seconds, "write_s", write_seconds, "map_s", map_seconds,
+        "file_MB", (mapped_tree.mapping_bytes >> 20));
+
+    auto run = [&](const char* version, const FlatKDTree& queried_tree){
+        Timer timer;
+        timer.start();
+        float total = 0.f;
+        for(const glm::vec3& query : queries){
+            float distance;
+            queried_tree.nearest(query, &distance);
+            total += distance;
+        }
+        const double seconds = timer.get<double, Timer::seconds>();
+        print(version, "queries/s", number_of_queries / seconds, "ns/query", seconds * 1e9 / number_of_queries, total);
+    };
+
+    // the first queries on the mapped tree also map its pages
+    run("mapped", mapped_tree);
+    run("mapped", mapped_tree);
+    run("built", tree);
+
+    mapped_tree.clear();
+    std::remove(path);
+}
+
+// DynamicKDTree updates and nearest queries compared with the queries on a
+// FlatKDTree of the same points
+// The frames move every point by a small step as the particles do, then a
+// tenth of the points to random positions
+void kdtree_dynamic(){
+
+    constexpr unsigned int number_of_points = 1000000;
+    constexpr unsigned int number_of_queries = 1000000;
+    constexpr int number_of_frames = 10;
+
+    print("---- DynamicKDTree ----");
+
+    unsigned int random = 12345;
+
+    std::vector<glm::vec3> points(number_of_points);
+    for(glm::vec3& point : points){
+        point = random_point(random);
+    }
+    std::vector<glm::vec3> queries(number_of_queries);
+    for(glm::vec3& query : queries){
+        query = random_point(random);
+    }
+
+    auto query_time = [&](const auto& tree){
+        Timer timer;
+        timer.start();
+        float total = 0.f;
+        for(const glm::vec3& query : queries){
+            float distance;
+            tree.nearest(query, &distance);
+            total += distance;
+        }
+        return std::make_pair(timer.get<double, Timer::seconds>() * 1e9 / number_of_queries, total);
+    };
+    auto levels = [](const DynamicKDTree& tree){
+        unsigned int used_levels = 0;
+        for(unsigned int ilevel = 0; ilevel != DynamicKDTree::max_levels; ++ilevel){
+            used_levels += tree.level_points[ilevel] != 0;
+        }
+        return used_levels;
+    };
+
+    FlatKDTree static_tree;
+    static_tree.build(points.data(), number_of_points);
+    const auto static_query = query_time(static_tree);
+    print("static", "ns/query", static_query.first, static_query.second);
+
+    DynamicKDTree tree;
+    Timer timer;
+    timer.start();
+    for(const glm::vec3& point : points){
+        tree.insert(point);
+    }
+    const double insert_seconds = timer.get<double, Timer::seconds>();
+    const auto insert_query = query_time(tree);
+    print("inserted", "ns/insert", insert_seconds * 1e9 / number_of_points, "ns/query", insert_query.first,
+        insert_query.second, "levels", levels(tree));
+
+    double small_seconds = 0.;
+    double large_seconds = 0.;
+    for(int iframe = 0; iframe != number_of_frames; ++iframe){
+        for(glm::vec3& point : points){
+            point = glm::clamp(point + 0.002f * (random_point(random) - 0.5f), 0.f, 1.f);
+        }
+        timer.start();
+        for(uint32_t ipoint = 0; ipoint != number_of_points; ++ipoint){
+            tree.move(ipoint, points[ipoint]);
+        }
+        small_seconds += timer.get<double, Timer::seconds>();
+
+        for(uint32_t ipoint = 0; ipoint != number_of_points / 10; ++ipoint){
+            points[ipoint * 10] = random_point(random);
+        }
+        timer.start();
+        for(uint32_t ipoint = 0; ipoint != number_of_points / 10; ++ipoint){
+            tree.move(ipoint * 10, points[ipoint * 10]);
+        }
+        large_seconds += timer.get<double, Timer::seconds>();
+    }
+    const auto move_query = query_time(tree);
+    print("moved", "ns/small move", small_seconds * 1e9 / number_of_frames / number_of_points,
+        "ns/large move", large_seconds * 1e9 / number_of_frames / (number_of_points / 10),
+        "ns/query", move_query.first, move_query.second, "levels", levels(tree));
+
+    static_tree.build(points.data(), number_of_points);
+    const auto moved_static_query = query_time(static_tree);
+    timer.start();
+    tree.rebuild();
+    const double rebuild_seconds = timer.get<double, Timer::seconds>();
+    const auto rebuilt_query = query_time(tree);
+    print("rebuilt", "s", rebuild_seconds, "ns/query", rebuilt_query.first, rebuilt_query.second,
+        "static ns/query", moved_static_query.first, moved_static_query.second);
+
+    timer.start();
+    for(uint32_t ipoint = 0; ipoint != number_of_points; ipoint += 2){
+        tree.erase(ipoint);
+    }
+    const double erase_seconds = timer.get<double, Timer::seconds>();
+    const auto erase_query = query_time(tree);
+    print("erased", "ns/erase", erase_seconds * 1e9 / (number_of_points / 2), "ns/query", erase_query.first,
+        erase_query.second, "levels", levels(tree));
+}
+
+int main(){
+
+    diffusion_temporal_blocking();
+    reaction_diffusion_vectorized();
+    reaction_diffusion_sweep();
+    particles_neighbor_search();
+    thread_pool_tiny_tasks();
+    memory_pool_contention();
+    size_class_containers();
+    free_list_latency();
+    virtual_arena_tlb();
+    hexgrid_build();
+    hex_reaction_diffusion();
+    kdtree_nearest();
+    kdtree_queries();
+    kdtree_parallel_build();
+    kdtree_mapped_file();
+    kdtree_dynamic();
+
+}
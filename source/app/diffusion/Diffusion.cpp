@@ -2,6 +2,9 @@
 
 #include "Diffusion.h"
 
+#include "LinearAllocator.h"
+#include "MemoryStatistics.h"
+
 #include <cmath>
 #include "print.h"
 
@@ -180,8 +183,10 @@ void Diffusion::start(const int simulation_width, const int simulation_height){
 
     // ---- Initializing state textures and framebuffer ---- //
 
-    // TODO (Nodli) : VLAs are not supported on windows, instead use malloc / new or glMapBufferRange to let the driver do the allocation
-    float* initial_data = (float*)malloc(width * height * sizeof(float));
+    MemoryTag memory_tag("Diffusion::start");
+    LinearAllocator& scratch = scratch_allocator();
+    const LinearAllocator::Marker scratch_marker = scratch.mark();
+    float* initial_data = scratch.get_array<float>(width * height);
     for(int idata = 0; idata != width * height; ++idata){
         initial_data[idata] = min_initial_max[CLEAR];
     }
@@ -212,7 +217,7 @@ void Diffusion::start(const int simulation_width, const int simulation_height){
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    free(initial_data);
+    scratch.rewind(scratch_marker);
 }
 
 void Diffusion::reset(){
@@ -0,0 +1,864 @@
+#define NOMINMAX
+
+#include "DiffusionCPU.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// ---- Row kernels ---- //
+
+// Writes the values seen by the stencil for one row ie the source / sink value
+// when the cell is not CLEAR and the state value otherwise
+// /padded_output/ has one extra value on each side that replicates the border
+// to reproduce GL_CLAMP_TO_EDGE
+static void effective_row(const float* state_row, const float* source_sink_row,
+        const float clear_value, const int width, float* padded_output){
+
+    float* output = padded_output + 1;
+    int x = 0;
+
+#if defined(__AVX512F__)
+    const __m512 clear_512 = _mm512_set1_ps(clear_value);
+    for(; x + 16 <= width; x += 16){
+        const __m512 state_value = _mm512_loadu_ps(state_row + x);
+        const __m512 source_sink_value = _mm512_loadu_ps(source_sink_row + x);
+        const __mmask16 is_clear = _mm512_cmp_ps_mask(source_sink_value, clear_512, _CMP_EQ_OQ);
+        _mm512_storeu_ps(output + x, _mm512_mask_blend_ps(is_clear, source_sink_value, state_value));
+    }
+#endif
+
+#if defined(__AVX__)
+    const __m256 clear_256 = _mm256_set1_ps(clear_value);
+    for(; x + 8 <= width; x += 8){
+        const __m256 state_value = _mm256_loadu_ps(state_row + x);
+        const __m256 source_sink_value = _mm256_loadu_ps(source_sink_row + x);
+        const __m256 is_clear = _mm256_cmp_ps(source_sink_value, clear_256, _CMP_EQ_OQ);
+        _mm256_storeu_ps(output + x, _mm256_blendv_ps(source_sink_value, state_value, is_clear));
+    }
+#endif
+
+    for(; x != width; ++x){
+        output[x] = (source_sink_row[x] != clear_value) ? source_sink_row[x] : state_row[x];
+    }
+
+    output[-1] = output[0];
+    output[width] = output[width - 1];
+}
+
+// Same expression as laplacian9 in Diffusion::code_step_forward
+// The rows are padded ie the value of the cell x is at index x + 1
+static void step_row(const float* row_down, const float* row, const float* row_up,
+        const float R, const int width, float* output){
+
+    int x = 0;
+
+#if defined(__AVX512F__)
+    const __m512 R_512 = _mm512_set1_ps(R);
+    const __m512 four_512 = _mm512_set1_ps(4.f);
+    const __m512 twenty_512 = _mm512_set1_ps(20.f);
+    const __m512 sixth_512 = _mm512_set1_ps(1.f / 6.f);
+    for(; x + 16 <= width; x += 16){
+        const __m512 current = _mm512_loadu_ps(row + x + 1);
+
+        __m512 cross = _mm512_add_ps(_mm512_loadu_ps(row + x + 2), _mm512_loadu_ps(row + x));
+        cross = _mm512_add_ps(cross, _mm512_loadu_ps(row_up + x + 1));
+        cross = _mm512_add_ps(cross, _mm512_loadu_ps(row_down + x + 1));
+
+        __m512 sum = _mm512_mul_ps(four_512, cross);
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(row_down + x));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(row_down + x + 2));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(row_up + x));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(row_up + x + 2));
+        sum = _mm512_sub_ps(sum, _mm512_mul_ps(twenty_512, current));
+
+        const __m512 laplacian = _mm512_mul_ps(sixth_512, sum);
+        _mm512_storeu_ps(output + x, _mm512_add_ps(current, _mm512_mul_ps(R_512, laplacian)));
+    }
+#endif
+
+#if defined(__AVX__)
+    const __m256 R_256 = _mm256_set1_ps(R);
+    const __m256 four_256 = _mm256_set1_ps(4.f);
+    const __m256 twenty_256 = _mm256_set1_ps(20.f);
+    const __m256 sixth_256 = _mm256_set1_ps(1.f / 6.f);
+    for(; x + 8 <= width; x += 8){
+        const __m256 current = _mm256_loadu_ps(row + x + 1);
+
+        __m256 cross = _mm256_add_ps(_mm256_loadu_ps(row + x + 2), _mm256_loadu_ps(row + x));
+        cross = _mm256_add_ps(cross, _mm256_loadu_ps(row_up + x + 1));
+        cross = _mm256_add_ps(cross, _mm256_loadu_ps(row_down + x + 1));
+
+        __m256 sum = _mm256_mul_ps(four_256, cross);
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(row_down + x));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(row_down + x + 2));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(row_up + x));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(row_up + x + 2));
+        sum = _mm256_sub_ps(sum, _mm256_mul_ps(twenty_256, current));
+
+        const __m256 laplacian = _mm256_mul_ps(sixth_256, sum);
+        _mm256_storeu_ps(output + x, _mm256_add_ps(current, _mm256_mul_ps(R_256, laplacian)));
+    }
+#endif
+
+    for(; x != width; ++x){
+        const float current = row[x + 1];
+
+        const float laplacian = (1.f / 6.f) *
+
+                (4.f * (row[x + 2] + row[x] + row_up[x + 1] + row_down[x + 1])
+
+                + row_down[x]
+                + row_down[x + 2]
+                + row_up[x]
+                + row_up[x + 2]
+
+                - 20.f * current);
+
+        output[x] = current + R * laplacian;
+    }
+}
+
+// ---- DiffusionCPU ---- //
+
+DiffusionCPU::DiffusionCPU(const unsigned int number_of_threads)
+    : thread_pool(std::max(1, band_count(number_of_threads) - 1)){
+
+    // the calling thread processes the last band
+    number_of_bands = band_count(number_of_threads);
+}
+
+DiffusionCPU::~DiffusionCPU(){
+    free(state[0]);
+    free(state[1]);
+    free(source_sink);
+    free(band_storage);
+    free(tile_storage);
+    free(multigrid_storage);
+}
+
+void DiffusionCPU::start(const int simulation_width, const int simulation_height){
+
+    width = simulation_width;
+    height = simulation_height;
+
+    // ---- Initializing state and source - sink grids ---- //
+
+    free(state[0]);
+    free(state[1]);
+    free(source_sink);
+
+    state[0] = (float*)malloc(width * height * sizeof(float));
+    state[1] = (float*)malloc(width * height * sizeof(float));
+    source_sink = (float*)malloc(width * height * sizeof(float));
+
+    for(int idata = 0; idata != width * height; ++idata){
+        state[0][idata] = min_initial_max[CLEAR];
+        state[1][idata] = min_initial_max[CLEAR];
+        source_sink[idata] = min_initial_max[CLEAR];
+    }
+    current_state = false;
+
+    // ---- Initializing the rows used by each band ---- //
+
+    // multiple of 16 floats ie 64 bytes to keep the rows on separate cache lines
+    row_pitch = ((width + 2) + 15) / 16 * 16;
+
+    free(band_storage);
+    band_storage = (float*)malloc(number_of_bands * 3 * row_pitch * sizeof(float));
+
+    // ---- Initializing the tiles used by each band ---- //
+
+    tile_pitch = ((tile_width + 2 * max_fused_steps + 2) + 15) / 16 * 16;
+    const int tile_buffer_rows = 2 * (tile_height + 2 * max_fused_steps) + 1;
+
+    free(tile_storage);
+    tile_storage = (float*)malloc(number_of_bands * tile_buffer_rows * tile_pitch * sizeof(float));
+
+    // ---- Initializing the activity of the tiles ---- //
+
+    // both states are uniform ie nothing can change until an interaction
+    const int number_of_tiles = ((width + tile_width - 1) / tile_width) * ((height + tile_height - 1) / tile_height);
+    tile_changed.assign(number_of_tiles, 0);
+    tile_synchronized.assign(number_of_tiles, 1);
+    active_tiles = 0;
+}
+
+void DiffusionCPU::reset(){
+
+    for(int idata = 0; idata != width * height; ++idata){
+        state[(int)current_state][idata] = min_initial_max[CLEAR];
+        source_sink[idata] = min_initial_max[CLEAR];
+    }
+
+    set_tiles_changed(0, width, 0, height);
+}
+
+void DiffusionCPU::interaction(const float center_x, const float center_y,
+        const float radius, InteractionType interaction_value_id){
+
+    // Same coverage as the rasterization of Diffusion::code_interaction_set_value
+    // ie the cells whose center is within the disc
+    const float value = min_initial_max[interaction_value_id];
+
+    const int min_x = std::max(0, (int)std::floor((center_x - radius + 1.f) * 0.5f * width));
+    const int max_x = std::min(width, (int)std::ceil((center_x + radius + 1.f) * 0.5f * width));
+    const int min_y = std::max(0, (int)std::floor((center_y - radius + 1.f) * 0.5f * height));
+    const int max_y = std::min(height, (int)std::ceil((center_y + radius + 1.f) * 0.5f * height));
+
+    if(min_x >= max_x || min_y >= max_y){
+        return;
+    }
+
+    set_tiles_changed(min_x, max_x, min_y, max_y);
+
+    for(int y = min_y; y < max_y; ++y){
+        const float distance_y = (-1.f + (2 * y + 1) / (float)height) - center_y;
+
+        for(int x = min_x; x < max_x; ++x){
+            const float distance_x = (-1.f + (2 * x + 1) / (float)width) - center_x;
+
+            if(distance_x * distance_x + distance_y * distance_y <= radius * radius){
+                source_sink[y * width + x] = value;
+            }
+        }
+    }
+}
+
+void DiffusionCPU::step(const float R){
+
+    if(track_activity){
+        step_active_tiles(R);
+        return;
+    }
+
+    parallel_bands(thread_pool, number_of_bands, height, [this, R](const int iband, const int row_begin, const int row_end){
+        step_band(row_begin, row_end, R, band_storage + iband * 3 * row_pitch);
+    });
+
+    current_state = !current_state;
+
+    // the activity of the tiles is unknown to the next tracked step
+    set_tiles_changed(0, width, 0, height);
+}
+
+void DiffusionCPU::step_band(const int row_begin, const int row_end, const float R, float* band_rows){
+
+    const float* previous = state[(int)current_state];
+    float* next = state[(int)!current_state];
+    const float clear_value = min_initial_max[CLEAR];
+
+    // rolling window of the effective values of the rows y - 1, y and y + 1
+    float* row_down = band_rows;
+    float* row = band_rows + row_pitch;
+    float* row_up = band_rows + 2 * row_pitch;
+
+    const int first_row_down = std::max(row_begin - 1, 0);
+    effective_row(previous + first_row_down * width, source_sink + first_row_down * width,
+            clear_value, width, row_down);
+    effective_row(previous + row_begin * width, source_sink + row_begin * width,
+            clear_value, width, row);
+
+    for(int y = row_begin; y != row_end; ++y){
+        const int y_up = std::min(y + 1, height - 1);
+        effective_row(previous + y_up * width, source_sink + y_up * width,
+                clear_value, width, row_up);
+
+        step_row(row_down, row, row_up, R, width, next + y * width);
+
+        float* recycled_row = row_down;
+        row_down = row;
+        row = row_up;
+        row_up = recycled_row;
+    }
+}
+
+template<typename TileFunction>
+void DiffusionCPU::parallel_tiles(const int number_of_tiles, const TileFunction& tile_function){
+
+    const int tile_buffer_floats = (2 * (tile_height + 2 * max_fused_steps) + 1) * tile_pitch;
+
+    // the tiles are distributed dynamically because the tiles on the
+    // borders of the grid are cheaper
+    std::atomic<int> next_tile(0);
+    auto band_function = [&next_tile, &tile_function, number_of_tiles](float* tile_buffers){
+        for(int itile = next_tile++; itile < number_of_tiles; itile = next_tile++){
+            tile_function(itile, tile_buffers);
+        }
+    };
+
+    std::vector<std::future<void>> band_tasks;
+    band_tasks.reserve(number_of_bands);
+
+    for(int iband = 0; iband < number_of_bands - 1 && iband + 1 < number_of_tiles; ++iband){
+        float* tile_buffers = tile_storage + iband * tile_buffer_floats;
+        band_tasks.push_back(thread_pool.Enqueue([&band_function, tile_buffers](){
+            band_function(tile_buffers);
+        }));
+    }
+
+    band_function(tile_storage + (number_of_bands - 1) * tile_buffer_floats);
+
+    for(std::future<void>& task : band_tasks){
+        task.wait();
+    }
+}
+
+void DiffusionCPU::step(const float R, const int number_of_steps){
+
+    const int tiles_x = (width + tile_width - 1) / tile_width;
+    const int tiles_y = (height + tile_height - 1) / tile_height;
+
+    int remaining_steps = number_of_steps;
+    while(remaining_steps > 0){
+        const int fused_steps = std::min(remaining_steps, max_fused_steps);
+        remaining_steps -= fused_steps;
+
+        // a single step does not benefit from the tiling
+        if(fused_steps == 1){
+            step(R);
+            continue;
+        }
+
+        parallel_tiles(tiles_x * tiles_y, [this, tiles_x, R, fused_steps](const int itile, float* tile_buffers){
+            step_tile(itile % tiles_x, itile / tiles_x, R, fused_steps, tile_buffers);
+        });
+
+        current_state = !current_state;
+        set_tiles_changed(0, width, 0, height);
+    }
+}
+
+void DiffusionCPU::step_active_tiles(const float R){
+
+    const int tiles_x = (width + tile_width - 1) / tile_width;
+    const int tiles_y = (height + tile_height - 1) / tile_height;
+    const int number_of_tiles = tiles_x * tiles_y;
+
+    // ---- Active tiles ie a tile or one of its neighbors changed ---- //
+
+    std::vector<unsigned char> tile_active(number_of_tiles, 0);
+    active_tiles = 0;
+
+    for(int tile_y = 0; tile_y != tiles_y; ++tile_y){
+        for(int tile_x = 0; tile_x != tiles_x; ++tile_x){
+
+            unsigned char active = 0;
+            for(int neighbor_y = std::max(tile_y - 1, 0); neighbor_y <= std::min(tile_y + 1, tiles_y - 1); ++neighbor_y){
+                for(int neighbor_x = std::max(tile_x - 1, 0); neighbor_x <= std::min(tile_x + 1, tiles_x - 1); ++neighbor_x){
+                    active |= tile_changed[neighbor_y * tiles_x + neighbor_x];
+                }
+            }
+
+            tile_active[tile_y * tiles_x + tile_x] = active;
+            active_tiles += active;
+        }
+    }
+
+    // ---- Tiles update ---- //
+
+    std::vector<unsigned char> next_tile_changed(number_of_tiles, 0);
+
+    parallel_tiles(number_of_tiles, [&](const int itile, float* tile_buffers){
+        const int tile_x = itile % tiles_x;
+        const int tile_y = itile / tiles_x;
+
+        const float* previous = state[(int)current_state];
+        float* next = state[(int)!current_state];
+
+        const int x_begin = tile_x * tile_width;
+        const int x_end = std::min(x_begin + tile_width, width);
+        const int y_begin = tile_y * tile_height;
+        const int y_end = std::min(y_begin + tile_height, height);
+
+        if(tile_active[itile]){
+            step_tile(tile_x, tile_y, R, 1, tile_buffers);
+
+            float maximum_change = 0.f;
+            for(int y = y_begin; y != y_end; ++y){
+                for(int x = x_begin; x != x_end; ++x){
+                    maximum_change = std::max(maximum_change, std::abs(next[y * width + x] - previous[y * width + x]));
+                }
+            }
+
+            next_tile_changed[itile] = (maximum_change > activity_epsilon);
+            tile_synchronized[itile] = (maximum_change == 0.f);
+
+        // an inactive tile is copied once so that both states hold the same
+        // values and it can then be skipped
+        }else if(!tile_synchronized[itile]){
+            for(int y = y_begin; y != y_end; ++y){
+                std::copy(previous + y * width + x_begin, previous + y * width + x_end, next + y * width + x_begin);
+            }
+
+            tile_synchronized[itile] = 1;
+        }
+    });
+
+    tile_changed.swap(next_tile_changed);
+
+    current_state = !current_state;
+}
+
+void DiffusionCPU::set_tiles_changed(const int x_begin, const int x_end, const int y_begin, const int y_end){
+
+    const int tiles_x = (width + tile_width - 1) / tile_width;
+
+    for(int tile_y = y_begin / tile_height; tile_y <= (y_end - 1) / tile_height; ++tile_y){
+        for(int tile_x = x_begin / tile_width; tile_x <= (x_end - 1) / tile_width; ++tile_x){
+            tile_changed[tile_y * tiles_x + tile_x] = 1;
+            tile_synchronized[tile_y * tiles_x + tile_x] = 0;
+        }
+    }
+}
+
+void DiffusionCPU::step_tile(const int tile_x, const int tile_y, const float R,
+        const int number_of_steps, float* tile_buffers){
+
+    const float* previous = state[(int)current_state];
+    float* next = state[(int)!current_state];
+    const float clear_value = min_initial_max[CLEAR];
+
+    const int x_begin = tile_x * tile_width;
+    const int x_end = std::min(x_begin + tile_width, width);
+    const int y_begin = tile_y * tile_height;
+    const int y_end = std::min(y_begin + tile_height, height);
+
+    // region loaded in the tile buffers ie the tile with a halo of
+    // /number_of_steps/ cells clamped to the grid
+    // the value of the cell {x, y} is at index (y - load_y_begin) * tile_pitch + (x - load_x_begin) + 1
+    const int load_x_begin = std::max(x_begin - number_of_steps, 0);
+    const int load_x_end = std::min(x_end + number_of_steps, width);
+    const int load_y_begin = std::max(y_begin - number_of_steps, 0);
+    const int load_y_end = std::min(y_end + number_of_steps, height);
+
+    float* buffers[2] = {tile_buffers, tile_buffers + (tile_height + 2 * max_fused_steps) * tile_pitch};
+    float* raw_row = tile_buffers + 2 * (tile_height + 2 * max_fused_steps) * tile_pitch;
+
+    for(int y = load_y_begin; y != load_y_end; ++y){
+        effective_row(previous + y * width + load_x_begin, source_sink + y * width + load_x_begin,
+                clear_value, load_x_end - load_x_begin, buffers[0] + (y - load_y_begin) * tile_pitch);
+    }
+
+    for(int istep = 1; istep <= number_of_steps; ++istep){
+        const float* input = buffers[(istep - 1) & 1];
+        float* output = buffers[istep & 1];
+
+        // cells that are still needed to compute the tile after the remaining steps
+        const int halo = number_of_steps - istep;
+        const int step_x_begin = std::max(x_begin - halo, 0);
+        const int step_x_end = std::min(x_end + halo, width);
+        const int step_y_begin = std::max(y_begin - halo, 0);
+        const int step_y_end = std::min(y_end + halo, height);
+
+        const int row_offset = step_x_begin - load_x_begin;
+        const int row_width = step_x_end - step_x_begin;
+
+        for(int y = step_y_begin; y != step_y_end; ++y){
+            const float* row_down = input + (std::max(y - 1, 0) - load_y_begin) * tile_pitch + row_offset;
+            const float* row = input + (y - load_y_begin) * tile_pitch + row_offset;
+            const float* row_up = input + (std::min(y + 1, height - 1) - load_y_begin) * tile_pitch + row_offset;
+
+            if(istep == number_of_steps){
+                step_row(row_down, row, row_up, R, row_width, next + y * width + step_x_begin);
+
+            }else{
+                step_row(row_down, row, row_up, R, row_width, raw_row);
+                effective_row(raw_row, source_sink + y * width + step_x_begin,
+                        clear_value, row_width, output + (y - load_y_begin) * tile_pitch + row_offset);
+            }
+        }
+    }
+}
+
+// ---- Implicit steps ---- //
+
+// Writes A u = u - coefficient * laplacian9(u) for one row with clamped borders
+static void operator_row(const float* row_down, const float* row, const float* row_up,
+        const int width, const float coefficient, float* output){
+
+    auto laplacian = [row_down, row, row_up](const int x, const int x_left, const int x_right){
+        return (1.f / 6.f) *
+
+                (4.f * (row[x_right] + row[x_left] + row_up[x] + row_down[x])
+
+                + row_down[x_left]
+                + row_down[x_right]
+                + row_up[x_left]
+                + row_up[x_right]
+
+                - 20.f * row[x]);
+    };
+
+    output[0] = row[0] - coefficient * laplacian(0, 0, std::min(1, width - 1));
+
+    for(int x = 1; x < width - 1; ++x){
+        output[x] = row[x] - coefficient * laplacian(x, x - 1, x + 1);
+    }
+
+    if(width > 1){
+        output[width - 1] = row[width - 1] - coefficient * laplacian(width - 1, width - 2, width - 1);
+    }
+}
+
+// Cell-centered bilinear interpolation in one dimension ie the fine cell
+// /fine/ receives 3/4 of the coarse cell fine / 2 and 1/4 of its neighbor
+// on the side of /fine/, clamped to [0; coarse_size[
+static int coarse_neighbor(const int fine, const int coarse_size){
+    return std::min(std::max(fine / 2 + ((fine & 1) ? 1 : -1), 0), coarse_size - 1);
+}
+
+// Weight of the coarse cell /coarse/ in the interpolation of the fine cell /fine/
+static float interpolation_weight(const int fine, const int coarse, const int coarse_size){
+    return (fine / 2 == coarse ? 0.75f : 0.f) + (coarse_neighbor(fine, coarse_size) == coarse ? 0.25f : 0.f);
+}
+
+void DiffusionCPU::multigrid_build(){
+
+    // ---- Level sizes ---- //
+
+    multigrid_levels.clear();
+
+    MultigridLevel level;
+    level.width = width;
+    level.height = height;
+    multigrid_levels.push_back(level);
+
+    while(level.width > 4 || level.height > 4){
+        level.width = (level.width + 1) / 2;
+        level.height = (level.height + 1) / 2;
+        multigrid_levels.push_back(level);
+    }
+
+    // ---- Storage ---- //
+
+    // the level 0 uses the states as solution and right hand side but
+    // stores the vectors of the conjugate gradient
+    constexpr int conjugate_gradient_vectors = 4;
+
+    size_t floats = 0;
+    size_t bytes = 0;
+    for(size_t ilevel = 0; ilevel != multigrid_levels.size(); ++ilevel){
+        const size_t cells = multigrid_levels[ilevel].width * multigrid_levels[ilevel].height;
+        floats += (ilevel == 0) ? (1 + conjugate_gradient_vectors) * cells : 3 * cells;
+        bytes += cells;
+    }
+
+    free(multigrid_storage);
+    multigrid_storage = (float*)malloc(floats * sizeof(float) + bytes);
+
+    float* float_storage = multigrid_storage;
+    unsigned char* byte_storage = (unsigned char*)(multigrid_storage + floats);
+    for(size_t ilevel = 0; ilevel != multigrid_levels.size(); ++ilevel){
+        MultigridLevel& current_level = multigrid_levels[ilevel];
+        const size_t cells = current_level.width * current_level.height;
+
+        if(ilevel == 0){
+            conjugate_gradient_residual = float_storage;
+            conjugate_gradient_direction = float_storage + cells;
+            conjugate_gradient_operator_direction = float_storage + 2 * cells;
+            conjugate_gradient_preconditioned = float_storage + 3 * cells;
+            float_storage += conjugate_gradient_vectors * cells;
+
+        }else{
+            current_level.solution = float_storage;
+            current_level.right_hand_side = float_storage + cells;
+            float_storage += 2 * cells;
+        }
+
+        current_level.residual = float_storage;
+        float_storage += cells;
+
+        current_level.fixed = byte_storage;
+        byte_storage += cells;
+    }
+}
+
+void DiffusionCPU::multigrid_operator(const MultigridLevel& level, const float* input, float* output){
+
+    parallel_bands(thread_pool, number_of_bands, level.height, [&level, input, output](const int, const int row_begin, const int row_end){
+        for(int y = row_begin; y != row_end; ++y){
+            const float* row = input + y * level.width;
+            const float* row_down = input + std::max(y - 1, 0) * level.width;
+            const float* row_up = input + std::min(y + 1, level.height - 1) * level.width;
+
+            float* output_row = output + y * level.width;
+            const unsigned char* fixed = level.fixed + y * level.width;
+
+            operator_row(row_down, row, row_up, level.width, level.coefficient, output_row);
+
+            for(int x = 0; x != level.width; ++x){
+                output_row[x] = fixed[x] ? 0.f : output_row[x];
+            }
+        }
+    });
+}
+
+float DiffusionCPU::multigrid_residual(MultigridLevel& level){
+
+    std::vector<float> band_maximum(number_of_bands, 0.f);
+
+    parallel_bands(thread_pool, number_of_bands, level.height, [&level, &band_maximum](const int iband, const int row_begin, const int row_end){
+        float maximum = 0.f;
+
+        for(int y = row_begin; y != row_end; ++y){
+            const float* row = level.solution + y * level.width;
+            const float* row_down = level.solution + std::max(y - 1, 0) * level.width;
+            const float* row_up = level.solution + std::min(y + 1, level.height - 1) * level.width;
+
+            float* residual = level.residual + y * level.width;
+            const float* right_hand_side = level.right_hand_side + y * level.width;
+            const unsigned char* fixed = level.fixed + y * level.width;
+
+            operator_row(row_down, row, row_up, level.width, level.coefficient, residual);
+
+            for(int x = 0; x != level.width; ++x){
+                residual[x] = fixed[x] ? 0.f : right_hand_side[x] - residual[x];
+                maximum = std::max(maximum, std::abs(residual[x]));
+            }
+        }
+
+        band_maximum[iband] = maximum;
+    });
+
+    return *std::max_element(band_maximum.begin(), band_maximum.end());
+}
+
+void DiffusionCPU::multigrid_smooth(MultigridLevel& level, const int iterations){
+
+    // weighted Jacobi iterations
+    const float weight = multigrid_jacobi_weight / (1.f + level.coefficient * 20.f / 6.f);
+
+    for(int iteration = 0; iteration != iterations; ++iteration){
+        multigrid_residual(level);
+
+        parallel_bands(thread_pool, number_of_bands, level.height, [&level, weight](const int, const int row_begin, const int row_end){
+            for(int icell = row_begin * level.width; icell != row_end * level.width; ++icell){
+                level.solution[icell] += weight * level.residual[icell];
+            }
+        });
+    }
+}
+
+void DiffusionCPU::multigrid_vcycle(const int ilevel){
+
+    MultigridLevel& fine = multigrid_levels[ilevel];
+
+    if(ilevel + 1 == (int)multigrid_levels.size()){
+        multigrid_smooth(fine, multigrid_coarsest_steps);
+        return;
+    }
+
+    MultigridLevel& coarse = multigrid_levels[ilevel + 1];
+
+    multigrid_smooth(fine, multigrid_smoothing_steps);
+    multigrid_residual(fine);
+
+    // ---- Restriction : transpose of the prolongation divided by 4 ---- //
+
+    parallel_bands(thread_pool, number_of_bands, coarse.height, [&fine, &coarse](const int, const int row_begin, const int row_end){
+        for(int y = row_begin; y != row_end; ++y){
+            const int fine_y_begin = std::max(2 * y - 1, 0);
+            const int fine_y_end = std::min(2 * y + 3, fine.height);
+
+            for(int x = 0; x != coarse.width; ++x){
+                const int fine_x_begin = std::max(2 * x - 1, 0);
+                const int fine_x_end = std::min(2 * x + 3, fine.width);
+
+                float weight_x[4];
+                for(int fine_x = fine_x_begin; fine_x != fine_x_end; ++fine_x){
+                    weight_x[fine_x - fine_x_begin] = interpolation_weight(fine_x, x, coarse.width);
+                }
+
+                float sum = 0.f;
+                for(int fine_y = fine_y_begin; fine_y != fine_y_end; ++fine_y){
+                    const float* fine_row = fine.residual + fine_y * fine.width;
+
+                    float row_sum = 0.f;
+                    for(int fine_x = fine_x_begin; fine_x != fine_x_end; ++fine_x){
+                        row_sum += weight_x[fine_x - fine_x_begin] * fine_row[fine_x];
+                    }
+
+                    sum += interpolation_weight(fine_y, y, coarse.height) * row_sum;
+                }
+
+                const int icell = y * coarse.width + x;
+                coarse.right_hand_side[icell] = coarse.fixed[icell] ? 0.f : 0.25f * sum;
+                coarse.solution[icell] = 0.f;
+            }
+        }
+    });
+
+    multigrid_vcycle(ilevel + 1);
+
+    // ---- Prolongation : bilinear interpolation of the coarse correction ---- //
+
+    parallel_bands(thread_pool, number_of_bands, fine.height, [&fine, &coarse](const int, const int row_begin, const int row_end){
+        for(int y = row_begin; y != row_end; ++y){
+            const float* coarse_row = coarse.solution + (y / 2) * coarse.width;
+            const float* coarse_row_neighbor = coarse.solution + coarse_neighbor(y, coarse.height) * coarse.width;
+
+            for(int x = 0; x != fine.width; ++x){
+                const int icell = y * fine.width + x;
+                if(fine.fixed[icell]){
+                    continue;
+                }
+
+                const int coarse_x = x / 2;
+                const int coarse_x_neighbor = coarse_neighbor(x, coarse.width);
+
+                fine.solution[icell] += (9.f / 16.f) * coarse_row[coarse_x]
+                    + (3.f / 16.f) * (coarse_row[coarse_x_neighbor] + coarse_row_neighbor[coarse_x])
+                    + (1.f / 16.f) * coarse_row_neighbor[coarse_x_neighbor];
+            }
+        }
+    });
+
+    multigrid_smooth(fine, multigrid_smoothing_steps);
+}
+
+int DiffusionCPU::step_implicit(const float R, const float theta){
+
+    if(multigrid_levels.empty() || multigrid_levels[0].width != width || multigrid_levels[0].height != height){
+        multigrid_build();
+    }
+
+    // explicit part of the step ie the right hand side
+    if(theta < 1.f){
+        step((1.f - theta) * R);
+    }
+
+    // ---- Levels setup ---- //
+
+    const float clear_value = min_initial_max[CLEAR];
+    const int cells = width * height;
+
+    MultigridLevel& finest = multigrid_levels[0];
+    float* right_hand_side = state[(int)current_state];
+    float* solution = state[(int)!current_state];
+
+    for(int icell = 0; icell != cells; ++icell){
+        finest.fixed[icell] = (source_sink[icell] != clear_value);
+        solution[icell] = finest.fixed[icell] ? source_sink[icell] : right_hand_side[icell];
+    }
+
+    // R is relative to the grid spacing so it is divided by 4 on each coarser level
+    // A coarse cell is a Dirichlet cell when all its fine cells are
+    float coefficient = theta * R;
+    for(size_t ilevel = 0; ilevel != multigrid_levels.size(); ++ilevel){
+        MultigridLevel& level = multigrid_levels[ilevel];
+        level.coefficient = coefficient;
+        coefficient /= 4.f;
+
+        if(ilevel == 0){
+            continue;
+        }
+
+        const MultigridLevel& fine = multigrid_levels[ilevel - 1];
+        for(int y = 0; y != level.height; ++y){
+            for(int x = 0; x != level.width; ++x){
+                unsigned char fixed = 1;
+                for(int fine_y = 2 * y; fine_y != std::min(2 * y + 2, fine.height); ++fine_y){
+                    for(int fine_x = 2 * x; fine_x != std::min(2 * x + 2, fine.width); ++fine_x){
+                        fixed &= fine.fixed[fine_y * fine.width + fine_x];
+                    }
+                }
+                level.fixed[y * level.width + x] = fixed;
+            }
+        }
+    }
+
+    // ---- Conjugate gradient preconditioned by a V-cycle ---- //
+
+    // the V-cycle uses the conjugate gradient residual as right hand side
+    auto precondition = [this, &finest, cells](){
+        std::fill(conjugate_gradient_preconditioned, conjugate_gradient_preconditioned + cells, 0.f);
+        finest.solution = conjugate_gradient_preconditioned;
+        finest.right_hand_side = conjugate_gradient_residual;
+        multigrid_vcycle(0);
+    };
+
+    auto dot = [this, cells](const float* A, const float* B){
+        std::vector<double> band_sum(number_of_bands, 0.);
+        parallel_bands(thread_pool, number_of_bands, height, [this, A, B, &band_sum](const int iband, const int row_begin, const int row_end){
+            double sum = 0.;
+            for(int icell = row_begin * width; icell != row_end * width; ++icell){
+                sum += (double)A[icell] * (double)B[icell];
+            }
+            band_sum[iband] = sum;
+        });
+
+        double sum = 0.;
+        for(const double value : band_sum){
+            sum += value;
+        }
+        return sum;
+    };
+
+    // the tolerance applies to the correction of a Jacobi iteration
+    const float residual_tolerance = multigrid_tolerance * (1.f + theta * R * 20.f / 6.f);
+
+    finest.solution = solution;
+    finest.right_hand_side = right_hand_side;
+    float residual_maximum = multigrid_residual(finest);
+    std::copy(finest.residual, finest.residual + cells, conjugate_gradient_residual);
+
+    int cycles = 0;
+    if(residual_maximum > residual_tolerance && multigrid_max_cycles > 0){
+
+        precondition();
+        std::copy(conjugate_gradient_preconditioned, conjugate_gradient_preconditioned + cells, conjugate_gradient_direction);
+        double residual_dot_preconditioned = dot(conjugate_gradient_residual, conjugate_gradient_preconditioned);
+        cycles = 1;
+
+        while(true){
+            multigrid_operator(finest, conjugate_gradient_direction, conjugate_gradient_operator_direction);
+
+            const float alpha = (float)(residual_dot_preconditioned
+                    / dot(conjugate_gradient_direction, conjugate_gradient_operator_direction));
+
+            std::vector<float> band_maximum(number_of_bands, 0.f);
+            parallel_bands(thread_pool, number_of_bands, height, [this, solution, alpha, &band_maximum](const int iband, const int row_begin, const int row_end){
+                float maximum = 0.f;
+                for(int icell = row_begin * width; icell != row_end * width; ++icell){
+                    solution[icell] += alpha * conjugate_gradient_direction[icell];
+                    conjugate_gradient_residual[icell] -= alpha * conjugate_gradient_operator_direction[icell];
+                    maximum = std::max(maximum, std::abs(conjugate_gradient_residual[icell]));
+                }
+                band_maximum[iband] = maximum;
+            });
+            residual_maximum = *std::max_element(band_maximum.begin(), band_maximum.end());
+
+            if(residual_maximum <= residual_tolerance || cycles == multigrid_max_cycles){
+                break;
+            }
+
+            precondition();
+            const double next_residual_dot_preconditioned = dot(conjugate_gradient_residual, conjugate_gradient_preconditioned);
+            const float beta = (float)(next_residual_dot_preconditioned / residual_dot_preconditioned);
+            residual_dot_preconditioned = next_residual_dot_preconditioned;
+            ++cycles;
+
+            parallel_bands(thread_pool, number_of_bands, height, [this, beta](const int, const int row_begin, const int row_end){
+                for(int icell = row_begin * width; icell != row_end * width; ++icell){
+                    conjugate_gradient_direction[icell] = conjugate_gradient_preconditioned[icell]
+                        + beta * conjugate_gradient_direction[icell];
+                }
+            });
+        }
+    }
+
+    finest.solution = solution;
+    finest.right_hand_side = right_hand_side;
+
+    current_state = !current_state;
+    set_tiles_changed(0, width, 0, height);
+
+    return cycles;
+}
@@ -0,0 +1,142 @@
+#ifndef H_DIFFUSION_CPU
+#define H_DIFFUSION_CPU
+
+#include "ParallelBands.h"
+
+#include <vector>
+
+// CPU implementation of Diffusion with the same interface that does not
+// require an OpenGL context
+// The update is the one of Diffusion::code_step_forward ie a 9-point laplacian
+// where the cells marked in /source_sink/ override the state value, and the
+// borders of the grid are clamped like GL_CLAMP_TO_EDGE
+// The operations are evaluated in the same order as the shader so the results
+// only differ from the GPU by the floating point contractions (fma) allowed
+// to the GLSL compiler ie less than 1e-6 per step for values within [0;1]
+struct DiffusionCPU{
+
+    // number_of_threads = 0 uses one thread per hardware thread
+    DiffusionCPU(const unsigned int number_of_threads = 0);
+    ~DiffusionCPU();
+
+    void start(const int simulation_width, const int simulation_height);
+    void reset();
+
+    enum InteractionType {SINK = 0, CLEAR = 1, SOURCE = 2};
+    // center_x, center_y and radius must be given in OpenGL screen coordinates ie [-1;1]
+    void interaction(const float center_x, const float center_y,
+            const float radius, InteractionType interaction_value_id);
+
+    void step(const float R);
+
+    // Same result as calling step(R) /number_of_steps/ times
+    // The grid is split in tiles that are advanced by up to /max_fused_steps/
+    // steps while they are in cache, each tile being loaded with a halo of one
+    // cell per fused step that shrinks after every step (trapezoidal tiling)
+    void step(const float R, const int number_of_steps);
+
+    // Unconditionally stable step that solves
+    // (I - theta * R * L) next = (I + (1 - theta) * R * L) current
+    // where L is the 9-point laplacian of step(R) and the source / sink cells
+    // are Dirichlet cells ie theta = 1 is backward Euler and theta = 0.5 is
+    // Crank-Nicolson
+    // The system is solved with a conjugate gradient preconditioned by a
+    // geometric multigrid V-cycle until the Jacobi correction of every cell
+    // is below /multigrid_tolerance/ and the number of V-cycles is returned
+    int step_implicit(const float R, const float theta = 1.f);
+
+    // Splits the tiles [0; number_of_tiles[ between the bands and calls
+    // tile_function(tile_index, tile_buffers) for each tile in parallel
+    template<typename TileFunction>
+    void parallel_tiles(const int number_of_tiles, const TileFunction& tile_function);
+
+    // step(R) when /track_activity/ is true ie only the tiles where a
+    // neighbor tile changed by more than /activity_epsilon/ during the
+    // previous step are updated
+    void step_active_tiles(const float R);
+
+    // Marks the tiles overlapping the cells [x_begin; x_end[ x [y_begin; y_end[
+    // as changed so that they are updated by the next step
+    void set_tiles_changed(const int x_begin, const int x_end, const int y_begin, const int y_end);
+
+    // Updates the rows [row_begin; row_end[ of the next state using
+    // /band_rows/ as storage for three padded rows
+    void step_band(const int row_begin, const int row_end, const float R, float* band_rows);
+
+    // Advances the tile [tile_x * tile_width; (tile_x + 1) * tile_width[ x
+    // [tile_y * tile_height; (tile_y + 1) * tile_height[ by /number_of_steps/
+    // and writes it to the next state using /tile_buffers/ as storage
+    void step_tile(const int tile_x, const int tile_y, const float R,
+            const int number_of_steps, float* tile_buffers);
+
+    // ---- Data ---- //
+
+    int width = 0;
+    int height = 0;
+
+    float min_initial_max[3] = {0.f, 0.5f, 1.f};
+
+    // Row-major grids with the row 0 at the bottom ie the layout of the
+    // textures used by Diffusion
+    bool current_state = false;
+    float* state[2] = {nullptr, nullptr};
+    float* source_sink = nullptr;
+
+    // Each band of rows is updated by a single task
+    ThreadPool thread_pool;
+    int number_of_bands = 0;
+    int row_pitch = 0;
+    float* band_storage = nullptr;
+
+    // Tiles used by the fused steps, the sizes are read by start()
+    // A tile with its halo uses 2 * (tile_height + 2 * max_fused_steps) *
+    // (tile_width + 2 * max_fused_steps) floats and should fit in L2
+    int tile_width = 256;
+    int tile_height = 64;
+    int max_fused_steps = 8;
+    int tile_pitch = 0;
+    float* tile_storage = nullptr;
+
+    // Activity of the tiles used by step(R) when /track_activity/ is true
+    // With activity_epsilon = 0 the skipped tiles are the ones that would not
+    // change ie the result is the same as without tracking
+    bool track_activity = false;
+    float activity_epsilon = 0.f;
+    std::vector<unsigned char> tile_changed;
+    std::vector<unsigned char> tile_synchronized; // same values in both states
+    int active_tiles = 0; // during the last step
+
+    // Levels used by step_implicit, the level 0 has the size of the grid and
+    // each coarser level halves the resolution
+    // The level 0 /solution/ and /right_hand_side/ point to the states
+    struct MultigridLevel{
+        int width = 0;
+        int height = 0;
+        float coefficient = 0.f; // theta * R scaled by the grid spacing
+        float* solution = nullptr;
+        float* right_hand_side = nullptr;
+        float* residual = nullptr;
+        unsigned char* fixed = nullptr; // Dirichlet cells
+    };
+    void multigrid_build();
+    // output = A input on the free cells and 0 on the Dirichlet cells
+    void multigrid_operator(const MultigridLevel& level, const float* input, float* output);
+    void multigrid_smooth(MultigridLevel& level, const int iterations);
+    float multigrid_residual(MultigridLevel& level);
+    void multigrid_vcycle(const int ilevel);
+
+    std::vector<MultigridLevel> multigrid_levels;
+    float* multigrid_storage = nullptr;
+    float* conjugate_gradient_residual = nullptr;
+    float* conjugate_gradient_direction = nullptr;
+    float* conjugate_gradient_operator_direction = nullptr;
+    float* conjugate_gradient_preconditioned = nullptr;
+
+    int multigrid_max_cycles = 20;
+    float multigrid_tolerance = 1e-6f;
+    int multigrid_smoothing_steps = 2;
+    int multigrid_coarsest_steps = 64;
+    float multigrid_jacobi_weight = 0.8f;
+};
+
+#endif
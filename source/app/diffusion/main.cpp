@@ -4,6 +4,7 @@
 #include "OpenGLWindow.h"
 
 #include "Diffusion.h"
+#include "DiffusionCPU.h"
 #include "TextureRenderer.h"
 
 //#include "print.h"
@@ -25,6 +26,14 @@ int main(){
 
     constexpr float interaction_radius = 0.1f;
 
+    // The simulation runs on the CPU and the state is uploaded to a texture
+    // every frame for rendering
+    constexpr bool use_cpu_backend = false;
+
+    // With the CPU backend, a single unconditionally stable step with
+    // R = sim_maxR * steps_per_render replaces the explicit steps of a frame
+    constexpr bool use_implicit_step = false;
+
     // ---------- END PARAMETERS ---------- //
 
     OpenGLWindow window;
@@ -37,6 +46,24 @@ int main(){
     simulation.min_initial_max[2] = sim_maxT;
     simulation.start(sim_width, sim_height);
 
+    DiffusionCPU simulation_cpu;
+    ogl::Texture texture_cpu;
+    if(use_cpu_backend){
+        simulation_cpu.min_initial_max[0] = simulation.min_initial_max[0];
+        simulation_cpu.min_initial_max[1] = simulation.min_initial_max[1];
+        simulation_cpu.min_initial_max[2] = simulation.min_initial_max[2];
+        simulation_cpu.track_activity = true;
+        simulation_cpu.start(sim_width, sim_height);
+
+        glBindTexture(GL_TEXTURE_2D, texture_cpu.handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, sim_width, sim_height, 0, GL_RED, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
     TextureRenderer renderer(TextureRenderer::R);
 
     // Dynamic Parameter
@@ -72,7 +99,12 @@ int main(){
             float pos_x, pos_y;
             window.cursor_screen_coordinates(pos_x, pos_y);
 
-            simulation.interaction(pos_x, pos_y, interaction_radius, interaction_type);
+            if(use_cpu_backend){
+                simulation_cpu.interaction(pos_x, pos_y, interaction_radius,
+                        (DiffusionCPU::InteractionType)interaction_type);
+            }else{
+                simulation.interaction(pos_x, pos_y, interaction_radius, interaction_type);
+            }
         }
 
         bool step_this_frame = false;
@@ -88,18 +120,38 @@ int main(){
         // ---- Running Simulation ---- //
 
         if(reset_this_frame){
-            simulation.reset();
+            if(use_cpu_backend){
+                simulation_cpu.reset();
+            }else{
+                simulation.reset();
+            }
         }
 
         if(step_this_frame){
-            for(int istep = 0; istep != steps_per_render; ++istep){
-                simulation.step(sim_maxR);
+            if(use_cpu_backend && use_implicit_step){
+                simulation_cpu.step_implicit(sim_maxR * steps_per_render);
+            }else if(use_cpu_backend){
+                simulation_cpu.step(sim_maxR, steps_per_render);
+            }else{
+                for(int istep = 0; istep != steps_per_render; ++istep){
+                    simulation.step(sim_maxR);
+                }
             }
         }
 
         // ---- Render Simulation ---- //
 
-        if(show_source_sink_texture){
+        if(use_cpu_backend){
+            const float* displayed_data = show_source_sink_texture ? simulation_cpu.source_sink
+                : simulation_cpu.state[(int)simulation_cpu.current_state];
+
+            glBindTexture(GL_TEXTURE_2D, texture_cpu.handle);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sim_width, sim_height, GL_RED, GL_FLOAT, displayed_data);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            renderer.render(window, texture_cpu);
+
+        }else if(show_source_sink_texture){
             renderer.render(window, simulation.texture_source_sink);
         }else{
             renderer.render(window, simulation.texture_state[(int)simulation.current_state]);
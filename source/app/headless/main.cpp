@@ -0,0 +1,485 @@
+#include "DiffusionCPU.h"
+#include "ReactionDiffusionCPU.h"
+#include "ReactionDiffusionBatch.h"
+#include "Timer.h"
+
+#include "print.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Headless batch runner of the CPU simulations
+//
+// Headless.exe diffusion|reaction_diffusion|sweep [--option value ...]
+//
+// Options shared by the simulations
+//   --width, --height      grid size, of each instance for a sweep (default 512 x 512)
+//   --steps                number of steps, at least 1 (default 1000)
+//   --threads              worker threads, 0 for one per hardware thread (default 0)
+//   --script               initial condition script (default none)
+//   --snapshot-interval    steps between two snapshots, 0 to disable (default 0)
+//   --output               prefix of the snapshot files (default "snapshot")
+//
+// Diffusion options
+//   --R                    diffusion rate, < 0.5 unless implicit (default 0.35)
+//   --fused                steps fused per pass of DiffusionCPU::step(R, steps) (default 8)
+//   --track-activity       0 or 1, only update the tiles that can change (default 0)
+//   --implicit             theta of DiffusionCPU::step_implicit, 0 for explicit steps (default 0)
+//
+// Reaction-Diffusion options
+//   --F, --k               feed and kill rates (default 0.026, 0.053)
+//   --Ru, --Rv             diffusion rates of u and v (default 0.125, 0.0625)
+//
+// Sweep options, Reaction-Diffusion instances started from ReactionDiffusionBatch::reset
+//   --F-min, --F-max       range of the feed rates (default 0.01, 0.08)
+//   --k-min, --k-max       range of the kill rates (default 0.04, 0.07)
+//   --F-count, --k-count   number of feed and kill rates (default 256, 256)
+//   --instances            instances stepped at a time (default 4096)
+//
+// Script commands, one per line with the coordinates in [-1;1] and # for comments
+//   Diffusion              source|sink|clear center_x center_y radius
+//   Reaction-Diffusion     point center_x center_y radius value_u value_v
+//                          square center_x center_y size value_u value_v
+//
+// Snapshots are written as PFM images named <output>_<step>.pfm with the rows
+// from bottom to top
+// A sweep writes the statistics of each instance to <output>_sweep.csv and
+// the map of the mean u, mean v and standard deviation of v to <output>_sweep.pfm
+// with k along the rows and F along the columns
+
+struct Parameters{
+    std::string simulation;
+
+    int width = 512;
+    int height = 512;
+    int steps = 1000;
+    int threads = 0;
+    std::string script;
+    int snapshot_interval = 0;
+    std::string output = "snapshot";
+
+    float R = 0.35f;
+    int fused = 8;
+    bool track_activity = false;
+    float implicit = 0.f;
+
+    float F = 0.0260f;
+    float k = 0.0530f;
+    float Ru = 0.125f;
+    float Rv = 0.0625f;
+
+    float F_min = 0.01f;
+    float F_max = 0.08f;
+    int F_count = 256;
+    float k_min = 0.04f;
+    float k_max = 0.07f;
+    int k_count = 256;
+    int instances = 4096;
+};
+
+bool parse_arguments(const int argc, char* argv[], Parameters& parameters){
+
+    if(argc < 2){
+        return false;
+    }
+
+    parameters.simulation = argv[1];
+    if(parameters.simulation != "diffusion" && parameters.simulation != "reaction_diffusion"
+            && parameters.simulation != "sweep"){
+        print("Headless error : unknown simulation", argv[1]);
+        return false;
+    }
+
+    for(int iarg = 2; iarg < argc; iarg += 2){
+        if(iarg + 1 == argc){
+            print("Headless error : missing value for", argv[iarg]);
+            return false;
+        }
+
+        const char* const option = argv[iarg];
+        const char* const value = argv[iarg + 1];
+
+        if(!strcmp(option, "--width")){
+            parameters.width = atoi(value);
+        }else if(!strcmp(option, "--height")){
+            parameters.height = atoi(value);
+        }else if(!strcmp(option, "--steps")){
+            parameters.steps = atoi(value);
+        }else if(!strcmp(option, "--threads")){
+            parameters.threads = atoi(value);
+        }else if(!strcmp(option, "--script")){
+            parameters.script = value;
+        }else if(!strcmp(option, "--snapshot-interval")){
+            parameters.snapshot_interval = atoi(value);
+        }else if(!strcmp(option, "--output")){
+            parameters.output = value;
+        }else if(!strcmp(option, "--R")){
+            parameters.R = atof(value);
+        }else if(!strcmp(option, "--fused")){
+            parameters.fused = atoi(value);
+        }else if(!strcmp(option, "--track-activity")){
+            parameters.track_activity = atoi(value);
+        }else if(!strcmp(option, "--implicit")){
+            parameters.implicit = atof(value);
+        }else if(!strcmp(option, "--F")){
+            parameters.F = atof(value);
+        }else if(!strcmp(option, "--k")){
+            parameters.k = atof(value);
+        }else if(!strcmp(option, "--Ru")){
+            parameters.Ru = atof(value);
+        }else if(!strcmp(option, "--Rv")){
+            parameters.Rv = atof(value);
+        }else if(!strcmp(option, "--F-min")){
+            parameters.F_min = atof(value);
+        }else if(!strcmp(option, "--F-max")){
+            parameters.F_max = atof(value);
+        }else if(!strcmp(option, "--F-count")){
+            parameters.F_count = atoi(value);
+        }else if(!strcmp(option, "--k-min")){
+            parameters.k_min = atof(value);
+        }else if(!strcmp(option, "--k-max")){
+            parameters.k_max = atof(value);
+        }else if(!strcmp(option, "--k-count")){
+            parameters.k_count = atoi(value);
+        }else if(!strcmp(option, "--instances")){
+            parameters.instances = atoi(value);
+        }else{
+            print("Headless error : unknown option", option);
+            return false;
+        }
+    }
+
+    if(parameters.width <= 0 || parameters.height <= 0 || parameters.steps < 1 || parameters.fused < 1){
+        print("Headless error : invalid grid size, number of steps or fused steps");
+        return false;
+    }
+
+    if(parameters.threads < 0){
+        print("Headless error : invalid number of threads");
+        return false;
+    }
+
+    if(parameters.F_count < 1 || parameters.k_count < 1 || parameters.instances < 1){
+        print("Headless error : invalid number of feed rates, kill rates or instances");
+        return false;
+    }
+
+    return true;
+}
+
+// ---- Snapshots ---- //
+
+// /channels/ interleaved floats per cell ie 1 for a greyscale image and 2 for
+// an image with u in red, v in green and 0.5 in blue like TextureRenderer::RG
+void write_snapshot(const std::string& prefix, const int step, const int width, const int height,
+        const float* data, const int channels){
+
+    const std::string file_path = concatenate(prefix, "_", step, ".pfm");
+    std::ofstream file(file_path, std::ios::out | std::ios::binary);
+
+    if(!file.is_open()){
+        print("Headless error : cannot write", file_path);
+        return;
+    }
+
+    // negative scale for little endian floats
+    file << (channels == 1 ? "Pf" : "PF") << "\n" << width << " " << height << "\n-1.0\n";
+
+    for(int icell = 0; icell != width * height; ++icell){
+        if(channels == 1){
+            put_bytes(file, data[icell]);
+        }else{
+            put_bytes(file, data[2 * icell]);
+            put_bytes(file, data[2 * icell + 1]);
+            put_bytes(file, 0.5f);
+        }
+    }
+}
+
+// ---- Initial conditions ---- //
+
+bool apply_script(const std::string& script_path, DiffusionCPU& simulation){
+
+    std::ifstream file(script_path);
+    if(!file.is_open()){
+        print("Headless error : cannot open", script_path);
+        return false;
+    }
+
+    std::string line;
+    int iline = 0;
+    while(std::getline(file, line)){
+        ++iline;
+
+        std::istringstream stream(line.substr(0, line.find('#')));
+        std::string command;
+        if(!(stream >> command)){
+            continue;
+        }
+
+        float center_x, center_y, radius;
+        if(!(stream >> center_x >> center_y >> radius)){
+            print("Headless error : invalid arguments at line", iline, "of", script_path);
+            return false;
+        }
+
+        if(command == "source"){
+            simulation.interaction(center_x, center_y, radius, DiffusionCPU::SOURCE);
+        }else if(command == "sink"){
+            simulation.interaction(center_x, center_y, radius, DiffusionCPU::SINK);
+        }else if(command == "clear"){
+            simulation.interaction(center_x, center_y, radius, DiffusionCPU::CLEAR);
+        }else{
+            print("Headless error : unknown command", command, "at line", iline, "of", script_path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool apply_script(const std::string& script_path, ReactionDiffusionCPU& simulation){
+
+    std::ifstream file(script_path);
+    if(!file.is_open()){
+        print("Headless error : cannot open", script_path);
+        return false;
+    }
+
+    std::string line;
+    int iline = 0;
+    while(std::getline(file, line)){
+        ++iline;
+
+        std::istringstream stream(line.substr(0, line.find('#')));
+        std::string command;
+        if(!(stream >> command)){
+            continue;
+        }
+
+        float center_x, center_y, size, value_u, value_v;
+        if(!(stream >> center_x >> center_y >> size >> value_u >> value_v)){
+            print("Headless error : invalid arguments at line", iline, "of", script_path);
+            return false;
+        }
+
+        if(command == "point"){
+            simulation.point(center_x, center_y, size, value_u, value_v);
+        }else if(command == "square"){
+            simulation.square(center_x, center_y, size, value_u, value_v);
+        }else{
+            print("Headless error : unknown command", command, "at line", iline, "of", script_path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---- Simulations ---- //
+
+// Runs /parameters.steps/ steps with step_function(number_of_steps) between
+// the snapshots and returns the time spent stepping in seconds
+template<typename StepFunction, typename SnapshotFunction>
+double run(const Parameters& parameters, const StepFunction& step_function, const SnapshotFunction& snapshot_function){
+
+    const int interval = parameters.snapshot_interval > 0 ? parameters.snapshot_interval : parameters.steps;
+
+    double seconds = 0.;
+    int current_step = 0;
+
+    if(parameters.snapshot_interval > 0){
+        snapshot_function(current_step);
+    }
+
+    while(current_step != parameters.steps){
+        const int number_of_steps = std::min(interval, parameters.steps - current_step);
+
+        Timer timer;
+        timer.start();
+        step_function(number_of_steps);
+        seconds += timer.get<double, Timer::seconds>();
+
+        current_step += number_of_steps;
+
+        if(parameters.snapshot_interval > 0){
+            snapshot_function(current_step);
+        }
+    }
+
+    return seconds;
+}
+
+double run_diffusion(const Parameters& parameters){
+
+    DiffusionCPU simulation(parameters.threads);
+    simulation.max_fused_steps = parameters.fused;
+    simulation.track_activity = parameters.track_activity;
+    simulation.start(parameters.width, parameters.height);
+
+    if(!parameters.script.empty() && !apply_script(parameters.script, simulation)){
+        return -1.;
+    }
+
+    auto step_function = [&](const int number_of_steps){
+        if(parameters.implicit > 0.f){
+            for(int istep = 0; istep != number_of_steps; ++istep){
+                simulation.step_implicit(parameters.R, parameters.implicit);
+            }
+        }else if(parameters.fused > 1 && !parameters.track_activity){
+            simulation.step(parameters.R, number_of_steps);
+        }else{
+            for(int istep = 0; istep != number_of_steps; ++istep){
+                simulation.step(parameters.R);
+            }
+        }
+    };
+
+    auto snapshot_function = [&](const int current_step){
+        write_snapshot(parameters.output, current_step, simulation.width, simulation.height,
+                simulation.state[(int)simulation.current_state], 1);
+    };
+
+    return run(parameters, step_function, snapshot_function);
+}
+
+double run_reaction_diffusion(const Parameters& parameters){
+
+    ReactionDiffusionCPU simulation(parameters.threads);
+    simulation.sim_F = parameters.F;
+    simulation.sim_R = parameters.k;
+    simulation.sim_Ru = parameters.Ru;
+    simulation.sim_Rv = parameters.Rv;
+    simulation.start(parameters.width, parameters.height);
+
+    if(!parameters.script.empty() && !apply_script(parameters.script, simulation)){
+        return -1.;
+    }
+
+    auto step_function = [&](const int number_of_steps){
+        for(int istep = 0; istep != number_of_steps; ++istep){
+            simulation.step();
+        }
+    };
+
+    std::vector<float> snapshot_uv(2 * simulation.width * simulation.height);
+    auto snapshot_function = [&](const int current_step){
+        simulation.get_state(snapshot_uv.data());
+        write_snapshot(parameters.output, current_step, simulation.width, simulation.height,
+                snapshot_uv.data(), 2);
+    };
+
+    return run(parameters, step_function, snapshot_function);
+}
+
+// Returns the time spent in ReactionDiffusionBatch::sweep ie stepping the
+// instances and computing their statistics
+double run_sweep(const Parameters& parameters){
+
+    ReactionDiffusionBatch simulation(parameters.threads);
+    simulation.sim_Ru = parameters.Ru;
+    simulation.sim_Rv = parameters.Rv;
+    simulation.start(parameters.width, parameters.height,
+            std::min(parameters.instances, parameters.F_count * parameters.k_count));
+
+    std::vector<ReactionDiffusionBatch::Statistics> statistics(parameters.F_count * parameters.k_count);
+
+    Timer timer;
+    timer.start();
+    simulation.sweep(parameters.F_min, parameters.F_max, parameters.F_count,
+            parameters.k_min, parameters.k_max, parameters.k_count, parameters.steps,
+            [&](const int iF, const int ik, const float, const float,
+                const ReactionDiffusionBatch::Statistics& instance_statistics){
+
+        statistics[ik * parameters.F_count + iF] = instance_statistics;
+    });
+    const double seconds = timer.get<double, Timer::seconds>();
+
+    // ---- Output ---- //
+
+    const std::string csv_path = concatenate(parameters.output, "_sweep.csv");
+    std::ofstream csv_file(csv_path);
+    if(!csv_file.is_open()){
+        print("Headless error : cannot write", csv_path);
+        return -1.;
+    }
+
+    csv_file << "F,k,mean_u,mean_v,min_v,max_v,variance_v,change_v\n";
+
+    std::vector<float> map(3 * statistics.size());
+    for(int ik = 0; ik != parameters.k_count; ++ik){
+        for(int iF = 0; iF != parameters.F_count; ++iF){
+            const ReactionDiffusionBatch::Statistics& instance_statistics = statistics[ik * parameters.F_count + iF];
+            const float F = (parameters.F_count > 1) ?
+                parameters.F_min + (parameters.F_max - parameters.F_min) * iF / (parameters.F_count - 1) : parameters.F_min;
+            const float k = (parameters.k_count > 1) ?
+                parameters.k_min + (parameters.k_max - parameters.k_min) * ik / (parameters.k_count - 1) : parameters.k_min;
+
+            csv_file << F << "," << k << "," << instance_statistics.mean_u << "," << instance_statistics.mean_v
+                << "," << instance_statistics.min_v << "," << instance_statistics.max_v
+                << "," << instance_statistics.variance_v << "," << instance_statistics.change_v << "\n";
+
+            map[3 * (ik * parameters.F_count + iF)] = instance_statistics.mean_u;
+            map[3 * (ik * parameters.F_count + iF) + 1] = instance_statistics.mean_v;
+            map[3 * (ik * parameters.F_count + iF) + 2] = std::sqrt(instance_statistics.variance_v);
+        }
+    }
+
+    const std::string map_path = concatenate(parameters.output, "_sweep.pfm");
+    std::ofstream map_file(map_path, std::ios::out | std::ios::binary);
+    if(!map_file.is_open()){
+        print("Headless error : cannot write", map_path);
+        return -1.;
+    }
+
+    map_file << "PF\n" << parameters.F_count << " " << parameters.k_count << "\n-1.0\n";
+    for(const float value : map){
+        put_bytes(map_file, value);
+    }
+
+    return seconds;
+}
+
+int main(int argc, char* argv[]){
+
+    Parameters parameters;
+    if(!parse_arguments(argc, argv, parameters)){
+        print("usage :", argv[0], "diffusion|reaction_diffusion|sweep [--option value ...]");
+        return 1;
+    }
+
+    double seconds = 0.;
+    double cells = (double)parameters.width * parameters.height;
+
+    if(parameters.simulation == "diffusion"){
+        seconds = run_diffusion(parameters);
+    }else if(parameters.simulation == "reaction_diffusion"){
+        seconds = run_reaction_diffusion(parameters);
+    }else{
+        seconds = run_sweep(parameters);
+        cells *= (double)parameters.F_count * parameters.k_count;
+    }
+
+    if(seconds < 0.){
+        return 1;
+    }
+
+    print("simulation", parameters.simulation, "grid", parameters.width, "x", parameters.height,
+            "steps", parameters.steps);
+    if(parameters.simulation == "sweep"){
+        print("instances", parameters.F_count * parameters.k_count);
+        print("instances/s", parameters.F_count * parameters.k_count / seconds);
+    }
+    print("seconds", seconds);
+    print("steps/s", parameters.steps / seconds);
+    print("ns/cell/step", seconds * 1e9 / (cells * parameters.steps));
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#define NOMINMAX
+
+#include "CellList.h"
+
+#include <algorithm>
+#include <cmath>
+
+void CellList::start(const float radius){
+
+    // the domain is 2 wide and the cells at least /radius/ wide
+    cells_per_side = std::max(1, (int)(2.f / radius));
+    cell_size = 2.f / cells_per_side;
+
+    cell_start.assign(cells_per_side * cells_per_side + 1, 0);
+}
+
+void CellList::build(const float* position_x, const float* position_y, const int count, const int stride){
+
+    sorted_particles.resize(count);
+    particle_cell.resize(count);
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+
+    // ---- Counting the particles per cell ---- //
+
+    for(int ipart = 0; ipart != count; ++ipart){
+        const int cell = cell_coordinate(position_y[ipart * stride]) * cells_per_side
+            + cell_coordinate(position_x[ipart * stride]);
+
+        particle_cell[ipart] = cell;
+        ++cell_start[cell + 1];
+    }
+
+    // ---- Prefix sum ---- //
+
+    for(int cell = 0; cell != cells_per_side * cells_per_side; ++cell){
+        cell_start[cell + 1] += cell_start[cell];
+    }
+
+    // ---- Scattering the particles in the order of the cells ---- //
+
+    // cell_start[cell] is used as the insertion cursor of the cell and ends up
+    // at the start of the next cell, hence the shift afterwards
+    for(int ipart = 0; ipart != count; ++ipart){
+        sorted_particles[cell_start[particle_cell[ipart]]++] = ipart;
+    }
+
+    for(int cell = cells_per_side * cells_per_side; cell != 0; --cell){
+        cell_start[cell] = cell_start[cell - 1];
+    }
+    cell_start[0] = 0;
+}
+
+int CellList::cell_coordinate(const float position) const{
+
+    // the positions can be slightly outside of [-1;1] before being wrapped
+    const int coordinate = (int)std::floor((position + 1.f) / cell_size);
+    return ((coordinate % cells_per_side) + cells_per_side) % cells_per_side;
+}
+
+int CellList::candidate_ranges(const float position_x, const float position_y, int* ranges) const{
+
+    const int cell_x = cell_coordinate(position_x);
+    const int cell_y = cell_coordinate(position_y);
+
+    // with less than 3 cells per side the 3 x 3 cells would visit a cell twice
+    // so the rows are visited completely
+    if(cells_per_side < 3){
+        ranges[0] = 0;
+        ranges[1] = cell_start[cells_per_side * cells_per_side];
+        return 1;
+    }
+
+    int number_of_ranges = 0;
+    auto add_range = [&](const int row, const int column_begin, const int column_end){
+        ranges[2 * number_of_ranges] = cell_start[row * cells_per_side + column_begin];
+        ranges[2 * number_of_ranges + 1] = cell_start[row * cells_per_side + column_end];
+        ++number_of_ranges;
+    };
+
+    for(int offset_y = -1; offset_y <= 1; ++offset_y){
+        const int row = (cell_y + offset_y + cells_per_side) % cells_per_side;
+
+        if(cell_x == 0){
+            add_range(row, 0, 2);
+            add_range(row, cells_per_side - 1, cells_per_side);
+        }else if(cell_x == cells_per_side - 1){
+            add_range(row, 0, 1);
+            add_range(row, cells_per_side - 2, cells_per_side);
+        }else{
+            add_range(row, cell_x - 1, cell_x + 2);
+        }
+    }
+
+    return number_of_ranges;
+}
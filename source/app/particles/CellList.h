@@ -0,0 +1,52 @@
+#ifndef H_CELL_LIST
+#define H_CELL_LIST
+
+#include <vector>
+
+// Uniform grid over the periodic domain [-1;1] x [-1;1] of the Particles
+// where the particles are sorted by cell with a counting sort
+// The cells are at least /radius/ wide so the neighbors within /radius/ of a
+// particle are in the 3 x 3 cells around it
+struct CellList{
+
+    // ---- Build ---- //
+
+    void start(const float radius);
+
+    // Sorts the /count/ particles whose positions are at position_x[i * stride]
+    // and position_y[i * stride] ie stride = 1 for arrays of positions and
+    // stride = 4 for ParticleData
+    void build(const float* position_x, const float* position_y, const int count, const int stride);
+
+    // ---- Queries ---- //
+
+    int cell_coordinate(const float position) const;
+
+    // Calls neighbor_function(particle) for each particle of the 3 x 3 cells
+    // around (position_x, position_y) ie a superset of the neighbors within radius
+    template<typename NeighborFunction>
+    void for_each_candidate(const float position_x, const float position_y,
+            const NeighborFunction& neighbor_function) const;
+
+    // Writes the ranges [ranges[2 * i]; ranges[2 * i + 1][ of sorted_particles
+    // covering the 3 x 3 cells around (position_x, position_y) and returns
+    // their number, at most 9, where the cells adjacent in a row are merged
+    // ie particles gathered in the order of sorted_particles can be read as
+    // contiguous ranges
+    int candidate_ranges(const float position_x, const float position_y, int* ranges) const;
+
+    // ---- Data ---- //
+
+    int cells_per_side = 0;
+    float cell_size = 0.f;
+
+    // The particles of the cell c are sorted_particles[cell_start[c]; cell_start[c + 1][
+    // with the cells in row-major order
+    std::vector<int> cell_start;
+    std::vector<int> sorted_particles;
+    std::vector<int> particle_cell;
+};
+
+#include "CellList.inl"
+
+#endif
@@ -0,0 +1,24 @@
+template<typename NeighborFunction>
+void CellList::for_each_candidate(const float position_x, const float position_y,
+        const NeighborFunction& neighbor_function) const{
+
+    const int cell_x = cell_coordinate(position_x);
+    const int cell_y = cell_coordinate(position_y);
+
+    // with less than 3 cells per side the 3 x 3 cells would visit a cell twice
+    const int offset_min = (cells_per_side < 3) ? 0 : -1;
+    const int offset_max = (cells_per_side < 3) ? cells_per_side - 1 : 1;
+
+    for(int offset_y = offset_min; offset_y <= offset_max; ++offset_y){
+        const int neighbor_y = (cells_per_side < 3) ? offset_y : (cell_y + offset_y + cells_per_side) % cells_per_side;
+
+        for(int offset_x = offset_min; offset_x <= offset_max; ++offset_x){
+            const int neighbor_x = (cells_per_side < 3) ? offset_x : (cell_x + offset_x + cells_per_side) % cells_per_side;
+            const int cell = neighbor_y * cells_per_side + neighbor_x;
+
+            for(int isorted = cell_start[cell]; isorted != cell_start[cell + 1]; ++isorted){
+                neighbor_function(sorted_particles[isorted]);
+            }
+        }
+    }
+}
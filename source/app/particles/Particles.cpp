@@ -1,5 +1,7 @@
 #include "Particles.h"
 
+#include "LinearAllocator.h"
+#include "MemoryStatistics.h"
 #include "utils.h"
 
 Particles::Particles(){
@@ -222,7 +224,10 @@ void Particles::start(){
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, position.handle);
 
-    ParticleData* particle_positions = new ParticleData[number_of_particles];
+    MemoryTag memory_tag("Particles::start");
+    LinearAllocator& scratch = scratch_allocator();
+    const LinearAllocator::Marker scratch_marker = scratch.mark();
+    ParticleData* particle_positions = scratch.get_array<ParticleData>(number_of_particles);
     for(unsigned int ipos = 0; ipos != number_of_particles; ++ipos){
         particle_positions[ipos].position_x = rand_normalized() * 2.f - 1.f;
         particle_positions[ipos].position_y = rand_normalized() * 2.f - 1.f;
@@ -232,7 +237,7 @@ void Particles::start(){
 
     glBufferData(GL_SHADER_STORAGE_BUFFER, number_of_particles * sizeof(ParticleData), particle_positions, GL_STATIC_DRAW);
 
-    delete[] particle_positions;
+    scratch.rewind(scratch_marker);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
@@ -258,6 +263,20 @@ void Particles::step(){
     previous_step_time = current_time;
 }
 
+void Particles::upload(const ParticleData* data, const int particles){
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, position.handle);
+
+    if(particles == number_of_particles){
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particles * sizeof(ParticleData), data);
+    }else{
+        glBufferData(GL_SHADER_STORAGE_BUFFER, particles * sizeof(ParticleData), data, GL_DYNAMIC_DRAW);
+        number_of_particles = particles;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
 void Particles::render(){
 
     glBindVertexArray(position_format.handle);
@@ -19,6 +19,10 @@ struct Particles{
     void step();
     void render();
 
+    // Replaces the particles with /particles/ ParticleData ie the state of a
+    // CPU simulation rendered with this one
+    void upload(const ParticleData* data, const int particles);
+
     ogl::Buffer position;
     ogl::VertexArray position_format;
 
@@ -35,7 +39,7 @@ struct Particles{
 
     const int particles_per_group = 64; // local_size_x in compute shaders
     const int number_of_groups = 1;
-    const int number_of_particles = number_of_groups * particles_per_group;
+    int number_of_particles = number_of_groups * particles_per_group;
 };
 
 #endif
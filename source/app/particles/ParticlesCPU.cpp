@@ -0,0 +1,320 @@
+#define NOMINMAX
+
+#include "ParticlesCPU.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// ---- Neighbor kernel ---- //
+
+// Sums over the particles [begin; end[ within /neighbor_radius/ of the particle
+// ie the particle itself is included
+struct NeighborSums{
+    float offset_x = 0.f;
+    float offset_y = 0.f;
+    float velocity_x = 0.f;
+    float velocity_y = 0.f;
+    float repulsion_x = 0.f;
+    float repulsion_y = 0.f;
+    float count = 0.f;
+};
+
+static void accumulate_neighbors(const ParticlesCPU::State& neighbors, const int begin, const int end,
+        const float position_x, const float position_y,
+        const float squared_neighbor_radius, const float squared_repulsion_radius, NeighborSums& sums){
+
+    int ineighbor = begin;
+
+#if defined(__AVX512F__)
+    const __m512 position_x_512 = _mm512_set1_ps(position_x);
+    const __m512 position_y_512 = _mm512_set1_ps(position_y);
+    const __m512 neighbor_radius_512 = _mm512_set1_ps(squared_neighbor_radius);
+    const __m512 repulsion_radius_512 = _mm512_set1_ps(squared_repulsion_radius);
+    const __m512 one_512 = _mm512_set1_ps(1.f);
+    const __m512 half_512 = _mm512_set1_ps(0.5f);
+    const __m512 two_512 = _mm512_set1_ps(2.f);
+
+    __m512 offset_x_sum = _mm512_setzero_ps();
+    __m512 offset_y_sum = _mm512_setzero_ps();
+    __m512 velocity_x_sum = _mm512_setzero_ps();
+    __m512 velocity_y_sum = _mm512_setzero_ps();
+    __m512 repulsion_x_sum = _mm512_setzero_ps();
+    __m512 repulsion_y_sum = _mm512_setzero_ps();
+    __m512 count_sum = _mm512_setzero_ps();
+
+    // the last vector is partial and masked
+    for(; ineighbor < end; ineighbor += 16){
+        const __mmask16 valid = (end - ineighbor >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (end - ineighbor)) - 1u);
+
+        __m512 offset_x = _mm512_sub_ps(_mm512_maskz_loadu_ps(valid, neighbors.position_x + ineighbor), position_x_512);
+        __m512 offset_y = _mm512_sub_ps(_mm512_maskz_loadu_ps(valid, neighbors.position_y + ineighbor), position_y_512);
+        offset_x = _mm512_sub_ps(offset_x, _mm512_mul_ps(two_512, _mm512_roundscale_ps(
+                        _mm512_mul_ps(_mm512_add_ps(offset_x, one_512), half_512), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)));
+        offset_y = _mm512_sub_ps(offset_y, _mm512_mul_ps(two_512, _mm512_roundscale_ps(
+                        _mm512_mul_ps(_mm512_add_ps(offset_y, one_512), half_512), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)));
+
+        const __m512 squared_distance = _mm512_add_ps(_mm512_mul_ps(offset_x, offset_x), _mm512_mul_ps(offset_y, offset_y));
+        const __mmask16 within = _mm512_mask_cmp_ps_mask(valid, squared_distance, neighbor_radius_512, _CMP_LT_OQ);
+        const __mmask16 repulsed = _mm512_mask_cmp_ps_mask(within, squared_distance, repulsion_radius_512, _CMP_LT_OQ);
+
+        offset_x_sum = _mm512_mask_add_ps(offset_x_sum, within, offset_x_sum, offset_x);
+        offset_y_sum = _mm512_mask_add_ps(offset_y_sum, within, offset_y_sum, offset_y);
+        velocity_x_sum = _mm512_mask_add_ps(velocity_x_sum, within, velocity_x_sum,
+                _mm512_maskz_loadu_ps(valid, neighbors.velocity_x + ineighbor));
+        velocity_y_sum = _mm512_mask_add_ps(velocity_y_sum, within, velocity_y_sum,
+                _mm512_maskz_loadu_ps(valid, neighbors.velocity_y + ineighbor));
+        repulsion_x_sum = _mm512_mask_sub_ps(repulsion_x_sum, repulsed, repulsion_x_sum, offset_x);
+        repulsion_y_sum = _mm512_mask_sub_ps(repulsion_y_sum, repulsed, repulsion_y_sum, offset_y);
+        count_sum = _mm512_mask_add_ps(count_sum, within, count_sum, one_512);
+    }
+
+    sums.offset_x += _mm512_reduce_add_ps(offset_x_sum);
+    sums.offset_y += _mm512_reduce_add_ps(offset_y_sum);
+    sums.velocity_x += _mm512_reduce_add_ps(velocity_x_sum);
+    sums.velocity_y += _mm512_reduce_add_ps(velocity_y_sum);
+    sums.repulsion_x += _mm512_reduce_add_ps(repulsion_x_sum);
+    sums.repulsion_y += _mm512_reduce_add_ps(repulsion_y_sum);
+    sums.count += _mm512_reduce_add_ps(count_sum);
+
+#elif defined(__AVX__)
+    const __m256 position_x_256 = _mm256_set1_ps(position_x);
+    const __m256 position_y_256 = _mm256_set1_ps(position_y);
+    const __m256 neighbor_radius_256 = _mm256_set1_ps(squared_neighbor_radius);
+    const __m256 repulsion_radius_256 = _mm256_set1_ps(squared_repulsion_radius);
+    const __m256 one_256 = _mm256_set1_ps(1.f);
+    const __m256 half_256 = _mm256_set1_ps(0.5f);
+    const __m256 two_256 = _mm256_set1_ps(2.f);
+    const __m256 lane_256 = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+
+    __m256 offset_x_sum = _mm256_setzero_ps();
+    __m256 offset_y_sum = _mm256_setzero_ps();
+    __m256 velocity_x_sum = _mm256_setzero_ps();
+    __m256 velocity_y_sum = _mm256_setzero_ps();
+    __m256 repulsion_x_sum = _mm256_setzero_ps();
+    __m256 repulsion_y_sum = _mm256_setzero_ps();
+    __m256 count_sum = _mm256_setzero_ps();
+
+    // the last vector is partial and masked
+    for(; ineighbor < end; ineighbor += 8){
+        const __m256 valid = _mm256_cmp_ps(lane_256, _mm256_set1_ps((float)(end - ineighbor)), _CMP_LT_OQ);
+        const __m256i valid_load = _mm256_castps_si256(valid);
+
+        __m256 offset_x = _mm256_sub_ps(_mm256_maskload_ps(neighbors.position_x + ineighbor, valid_load), position_x_256);
+        __m256 offset_y = _mm256_sub_ps(_mm256_maskload_ps(neighbors.position_y + ineighbor, valid_load), position_y_256);
+        offset_x = _mm256_sub_ps(offset_x, _mm256_mul_ps(two_256,
+                    _mm256_floor_ps(_mm256_mul_ps(_mm256_add_ps(offset_x, one_256), half_256))));
+        offset_y = _mm256_sub_ps(offset_y, _mm256_mul_ps(two_256,
+                    _mm256_floor_ps(_mm256_mul_ps(_mm256_add_ps(offset_y, one_256), half_256))));
+
+        const __m256 squared_distance = _mm256_add_ps(_mm256_mul_ps(offset_x, offset_x), _mm256_mul_ps(offset_y, offset_y));
+        const __m256 within = _mm256_and_ps(valid, _mm256_cmp_ps(squared_distance, neighbor_radius_256, _CMP_LT_OQ));
+        const __m256 repulsed = _mm256_and_ps(within, _mm256_cmp_ps(squared_distance, repulsion_radius_256, _CMP_LT_OQ));
+
+        offset_x_sum = _mm256_add_ps(offset_x_sum, _mm256_and_ps(within, offset_x));
+        offset_y_sum = _mm256_add_ps(offset_y_sum, _mm256_and_ps(within, offset_y));
+        velocity_x_sum = _mm256_add_ps(velocity_x_sum, _mm256_and_ps(within,
+                    _mm256_maskload_ps(neighbors.velocity_x + ineighbor, valid_load)));
+        velocity_y_sum = _mm256_add_ps(velocity_y_sum, _mm256_and_ps(within,
+                    _mm256_maskload_ps(neighbors.velocity_y + ineighbor, valid_load)));
+        repulsion_x_sum = _mm256_sub_ps(repulsion_x_sum, _mm256_and_ps(repulsed, offset_x));
+        repulsion_y_sum = _mm256_sub_ps(repulsion_y_sum, _mm256_and_ps(repulsed, offset_y));
+        count_sum = _mm256_add_ps(count_sum, _mm256_and_ps(within, one_256));
+    }
+
+    auto reduce_add = [](const __m256 value){
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    };
+
+    sums.offset_x += reduce_add(offset_x_sum);
+    sums.offset_y += reduce_add(offset_y_sum);
+    sums.velocity_x += reduce_add(velocity_x_sum);
+    sums.velocity_y += reduce_add(velocity_y_sum);
+    sums.repulsion_x += reduce_add(repulsion_x_sum);
+    sums.repulsion_y += reduce_add(repulsion_y_sum);
+    sums.count += reduce_add(count_sum);
+
+#else
+    // Difference b - a in the periodic domain ie within [-1;1[
+    auto periodic_difference = [](const float a, const float b){
+        const float difference = b - a;
+        return difference - 2.f * std::floor((difference + 1.f) * 0.5f);
+    };
+
+    for(; ineighbor < end; ++ineighbor){
+        const float offset_x = periodic_difference(position_x, neighbors.position_x[ineighbor]);
+        const float offset_y = periodic_difference(position_y, neighbors.position_y[ineighbor]);
+        const float squared_distance = offset_x * offset_x + offset_y * offset_y;
+
+        if(squared_distance < squared_neighbor_radius){
+            sums.offset_x += offset_x;
+            sums.offset_y += offset_y;
+            sums.velocity_x += neighbors.velocity_x[ineighbor];
+            sums.velocity_y += neighbors.velocity_y[ineighbor];
+            sums.count += 1.f;
+
+            if(squared_distance < squared_repulsion_radius){
+                sums.repulsion_x -= offset_x;
+                sums.repulsion_y -= offset_y;
+            }
+        }
+    }
+#endif
+}
+
+// ---- ParticlesCPU ---- //
+
+ParticlesCPU::ParticlesCPU(const unsigned int number_of_threads)
+    : thread_pool(number_of_threads){
+}
+
+ParticlesCPU::~ParticlesCPU(){
+    ::operator delete(state_storage, std::align_val_t(64));
+}
+
+void ParticlesCPU::start(const int particles){
+
+    number_of_particles = particles;
+
+    // ---- Allocating the arrays ---- //
+
+    // multiple of 16 values ie 64 bytes so that every array is aligned
+    const size_t array_size = ((size_t)number_of_particles + 15) / 16 * 16;
+
+    ::operator delete(state_storage, std::align_val_t(64));
+    state_storage = ::operator new(2 * 5 * array_size * sizeof(float), std::align_val_t(64));
+
+    float* arrays = (float*)state_storage;
+    for(int istate = 0; istate != 2; ++istate){
+        state[istate].position_x = arrays;
+        state[istate].position_y = arrays + array_size;
+        state[istate].velocity_x = arrays + 2 * array_size;
+        state[istate].velocity_y = arrays + 3 * array_size;
+        state[istate].identifier = (int*)(arrays + 4 * array_size);
+        arrays += 5 * array_size;
+    }
+    current_state = false;
+
+    // ---- Initial state ---- //
+
+    State& current = state[(int)current_state];
+    for(int ipart = 0; ipart != number_of_particles; ++ipart){
+        current.position_x[ipart] = rand_normalized() * 2.f - 1.f;
+        current.position_y[ipart] = rand_normalized() * 2.f - 1.f;
+        current.velocity_x[ipart] = rand_normalized() / 10.f + 0.001f;
+        current.velocity_y[ipart] = rand_normalized() / 10.f + 0.001f;
+        current.identifier[ipart] = ipart;
+    }
+
+    cell_list.start(neighbor_radius);
+}
+
+void ParticlesCPU::step(const float delta_time){
+
+    const State& current = state[(int)current_state];
+    const State& gathered = state[(int)!current_state];
+
+    cell_list.build(current.position_x, current.position_y, number_of_particles, 1);
+
+    // ---- Gathering in the order of the cells ---- //
+
+    thread_pool.parallel_for(0, number_of_particles, chunk_size, [this, &current, &gathered](const int begin, const int end){
+        for(int isorted = begin; isorted != end; ++isorted){
+            const int ipart = cell_list.sorted_particles[isorted];
+            gathered.position_x[isorted] = current.position_x[ipart];
+            gathered.position_y[isorted] = current.position_y[ipart];
+            gathered.velocity_x[isorted] = current.velocity_x[ipart];
+            gathered.velocity_y[isorted] = current.velocity_y[ipart];
+            gathered.identifier[isorted] = current.identifier[ipart];
+        }
+    });
+
+    // ---- Simulation from the gathered state ---- //
+
+    thread_pool.parallel_for(0, number_of_particles, chunk_size, [this, delta_time](const int begin, const int end){
+        simulate_chunk(begin, end, delta_time);
+    });
+}
+
+void ParticlesCPU::simulate_chunk(const int begin, const int end, const float delta_time){
+
+    const State& gathered = state[(int)!current_state];
+    const State& output = state[(int)current_state];
+
+    const float squared_neighbor_radius = neighbor_radius * neighbor_radius;
+    const float squared_repulsion_radius = repulsion_radius * repulsion_radius;
+
+    for(int ipart = begin; ipart != end; ++ipart){
+        const float position_x = gathered.position_x[ipart];
+        const float position_y = gathered.position_y[ipart];
+        float velocity_x = gathered.velocity_x[ipart];
+        float velocity_y = gathered.velocity_y[ipart];
+
+        int ranges[18];
+        const int number_of_ranges = cell_list.candidate_ranges(position_x, position_y, ranges);
+
+        NeighborSums sums;
+        for(int irange = 0; irange != number_of_ranges; ++irange){
+            accumulate_neighbors(gathered, ranges[2 * irange], ranges[2 * irange + 1],
+                    position_x, position_y, squared_neighbor_radius, squared_repulsion_radius, sums);
+        }
+
+        // the particle is its own neighbor with a null offset
+        const float neighbors = sums.count - 1.f;
+        sums.velocity_x -= velocity_x;
+        sums.velocity_y -= velocity_y;
+
+        if(neighbors > 0.f){
+            // cohesion and alignment
+            const float previous_velocity_x = velocity_x;
+            const float previous_velocity_y = velocity_y;
+            velocity_x += sums.offset_x / neighbors * cohesion_factor;
+            velocity_y += sums.offset_y / neighbors * cohesion_factor;
+            velocity_x += (sums.velocity_x / neighbors - previous_velocity_x) * alignment_factor;
+            velocity_y += (sums.velocity_y / neighbors - previous_velocity_y) * alignment_factor;
+
+            // separation
+            velocity_x += sums.repulsion_x;
+            velocity_y += sums.repulsion_y;
+        }
+
+        const float speed = std::sqrt(velocity_x * velocity_x + velocity_y * velocity_y);
+        if(speed > max_speed){
+            velocity_x *= max_speed / speed;
+            velocity_y *= max_speed / speed;
+        }
+
+        // Same integration and wrapping as Particles::code_compute_step
+        float next_position_x = position_x + velocity_x * delta_time;
+        float next_position_y = position_y + velocity_y * delta_time;
+        next_position_x += ((float)(next_position_x < -1.f) - (float)(next_position_x > 1.f)) * 2.f;
+        next_position_y += ((float)(next_position_y < -1.f) - (float)(next_position_y > 1.f)) * 2.f;
+
+        output.position_x[ipart] = next_position_x;
+        output.position_y[ipart] = next_position_y;
+        output.velocity_x[ipart] = velocity_x;
+        output.velocity_y[ipart] = velocity_y;
+        output.identifier[ipart] = gathered.identifier[ipart];
+    }
+}
+
+void ParticlesCPU::get_state(ParticleData* output) const{
+
+    const State& current = state[(int)current_state];
+    for(int ipart = 0; ipart != number_of_particles; ++ipart){
+        ParticleData& particle = output[current.identifier[ipart]];
+        particle.position_x = current.position_x[ipart];
+        particle.position_y = current.position_y[ipart];
+        particle.velocity_x = current.velocity_x[ipart];
+        particle.velocity_y = current.velocity_y[ipart];
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef H_PARTICLES_CPU
+#define H_PARTICLES_CPU
+
+#include "CellList.h"
+#include "WorkStealingPool.h"
+
+// CPU implementation of the boids of Particles where the cohesion, alignment
+// and separation only use the neighbors within /neighbor_radius/, found with
+// a CellList, instead of all the particles of the work group
+// The domain [-1;1] x [-1;1] is periodic like the wrapping of Particles so the
+// neighbors are found across the borders
+// The particles are stored as a structure of arrays that is gathered in the
+// order of the cells at every step so that the candidates of a particle are
+// contiguous and compared with vector instructions
+struct ParticlesCPU{
+
+    // Same layout as Particles::ParticleData
+    struct ParticleData{
+        float position_x;
+        float position_y;
+        float velocity_x;
+        float velocity_y;
+    };
+
+    // number_of_threads = 0 uses one thread per hardware thread
+    ParticlesCPU(const unsigned int number_of_threads = 0);
+    ~ParticlesCPU();
+
+    // Random positions and velocities like Particles::start
+    void start(const int particles);
+    void step(const float delta_time);
+
+    // Writes the current state in the order of the particles given to start()
+    // ie the layout of Particles::position
+    void get_state(ParticleData* output) const;
+
+    // Updates the particles [begin; end[ of the state gathered in the order
+    // of the cells and writes them to the current state
+    void simulate_chunk(const int begin, const int end, const float delta_time);
+
+    // ---- Data ---- //
+
+    int number_of_particles = 0;
+
+    float neighbor_radius = 0.1f;
+    float repulsion_radius = 0.01f;
+    float max_speed = 0.25f;
+    float cohesion_factor = 1.f / 100.f;
+    float alignment_factor = 1.f / 100.f;
+
+    // Arrays aligned on 64 bytes with /identifier/ the index of the particle
+    // given to start()
+    // A step gathers the current state in the order of the cells into the
+    // other state and computes the current state from it ie the arrays that
+    // are read and written never alias
+    struct State{
+        float* position_x = nullptr;
+        float* position_y = nullptr;
+        float* velocity_x = nullptr;
+        float* velocity_y = nullptr;
+        int* identifier = nullptr;
+    };
+    bool current_state = false;
+    State state[2];
+    void* state_storage = nullptr;
+
+    CellList cell_list;
+
+    // The particles are processed in chunks of at most /chunk_size/ particles
+    WorkStealingPool thread_pool;
+    int chunk_size = 1024;
+};
+
+#endif
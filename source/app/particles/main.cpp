@@ -2,14 +2,24 @@
 #include "OpenGLWindow.h"
 
 #include "Particles.h"
+#include "ParticlesCPU.h"
 
 //#include "print.h"
 
+#include <vector>
+
 int main(){
 
     constexpr int width = 1080;
     constexpr int height = 1080;
 
+    // The boids are simulated on the CPU with radius-limited neighbors and
+    // uploaded every frame for rendering
+    constexpr bool use_cpu_backend = false;
+    constexpr int cpu_particles = 4096;
+    constexpr float cpu_neighbor_radius = 0.05f;
+    constexpr float cpu_delta_time = 1.f / 60.f;
+
     OpenGLWindow window;
     window.gl_version_major = 4;
     window.gl_version_minor = 3;
@@ -24,6 +34,17 @@ int main(){
     simulation.start();
     simulation.step(); // update the velocities
 
+    ParticlesCPU simulation_cpu;
+    std::vector<ParticlesCPU::ParticleData> simulation_cpu_data;
+    if(use_cpu_backend){
+        simulation_cpu.neighbor_radius = cpu_neighbor_radius;
+        simulation_cpu.start(cpu_particles);
+
+        simulation_cpu_data.resize(cpu_particles);
+        simulation_cpu.get_state(simulation_cpu_data.data());
+        simulation.upload((const Particles::ParticleData*)simulation_cpu_data.data(), cpu_particles);
+    }
+
     while(!glfwWindowShouldClose(window.window)){
 
         glfwPollEvents();
@@ -45,7 +66,11 @@ int main(){
 
         // ---- Simulate ---- //
 
-        if(run_step){
+        if(run_step && use_cpu_backend){
+            simulation_cpu.step(cpu_delta_time);
+            simulation_cpu.get_state(simulation_cpu_data.data());
+            simulation.upload((const Particles::ParticleData*)simulation_cpu_data.data(), cpu_particles);
+        }else if(run_step){
             simulation.step();
         }
 
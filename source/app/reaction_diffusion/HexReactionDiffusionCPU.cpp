@@ -0,0 +1,344 @@
+#define NOMINMAX
+
+#include "HexReactionDiffusionCPU.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// ---- Row kernels ---- //
+
+void HexReactionDiffusionCPU::step_row(const float* u_down, const float* u_row, const float* u_up,
+        const float* v_down, const float* v_row, const float* v_up,
+        const float Ru, const float Rv, const float F, const float k,
+        const int column_begin, const int column_end, float* u_output, float* v_output){
+
+    int c = column_begin;
+
+#if defined(__AVX512F__)
+    const __m512 Ru_512 = _mm512_set1_ps(Ru);
+    const __m512 Rv_512 = _mm512_set1_ps(Rv);
+    const __m512 F_512 = _mm512_set1_ps(F);
+    const __m512 Fk_512 = _mm512_set1_ps(F + k);
+    const __m512 one_512 = _mm512_set1_ps(1.f);
+    const __m512 six_512 = _mm512_set1_ps(6.f);
+    const __m512 two_thirds_512 = _mm512_set1_ps(2.f / 3.f);
+
+    auto laplacian_512 = [&](const float* down, const float* row, const float* up, const __m512 current){
+        __m512 sum = _mm512_add_ps(_mm512_loadu_ps(row + c - 1), _mm512_loadu_ps(row + c + 1));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(up + c));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(up + c + 1));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(down + c));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(down + c + 1));
+        sum = _mm512_sub_ps(sum, _mm512_mul_ps(six_512, current));
+
+        return _mm512_mul_ps(two_thirds_512, sum);
+    };
+
+    for(; c + 16 <= column_end; c += 16){
+        const __m512 u = _mm512_loadu_ps(u_row + c);
+        const __m512 v = _mm512_loadu_ps(v_row + c);
+        const __m512 uvv = _mm512_mul_ps(_mm512_mul_ps(u, v), v);
+
+        __m512 next_u = _mm512_add_ps(u, _mm512_mul_ps(Ru_512, laplacian_512(u_down, u_row, u_up, u)));
+        __m512 next_v = _mm512_add_ps(v, _mm512_mul_ps(Rv_512, laplacian_512(v_down, v_row, v_up, v)));
+
+        next_u = _mm512_add_ps(next_u, _mm512_add_ps(_mm512_sub_ps(_mm512_setzero_ps(), uvv),
+                _mm512_mul_ps(F_512, _mm512_sub_ps(one_512, u))));
+        next_v = _mm512_add_ps(next_v, _mm512_sub_ps(uvv, _mm512_mul_ps(Fk_512, v)));
+
+        _mm512_storeu_ps(u_output + c, next_u);
+        _mm512_storeu_ps(v_output + c, next_v);
+    }
+#endif
+
+#if defined(__AVX__)
+    const __m256 Ru_256 = _mm256_set1_ps(Ru);
+    const __m256 Rv_256 = _mm256_set1_ps(Rv);
+    const __m256 F_256 = _mm256_set1_ps(F);
+    const __m256 Fk_256 = _mm256_set1_ps(F + k);
+    const __m256 one_256 = _mm256_set1_ps(1.f);
+    const __m256 six_256 = _mm256_set1_ps(6.f);
+    const __m256 two_thirds_256 = _mm256_set1_ps(2.f / 3.f);
+
+    auto laplacian_256 = [&](const float* down, const float* row, const float* up, const __m256 current){
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(row + c - 1), _mm256_loadu_ps(row + c + 1));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(up + c));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(up + c + 1));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(down + c));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(down + c + 1));
+        sum = _mm256_sub_ps(sum, _mm256_mul_ps(six_256, current));
+
+        return _mm256_mul_ps(two_thirds_256, sum);
+    };
+
+    for(; c + 8 <= column_end; c += 8){
+        const __m256 u = _mm256_loadu_ps(u_row + c);
+        const __m256 v = _mm256_loadu_ps(v_row + c);
+        const __m256 uvv = _mm256_mul_ps(_mm256_mul_ps(u, v), v);
+
+        __m256 next_u = _mm256_add_ps(u, _mm256_mul_ps(Ru_256, laplacian_256(u_down, u_row, u_up, u)));
+        __m256 next_v = _mm256_add_ps(v, _mm256_mul_ps(Rv_256, laplacian_256(v_down, v_row, v_up, v)));
+
+        next_u = _mm256_add_ps(next_u, _mm256_add_ps(_mm256_sub_ps(_mm256_setzero_ps(), uvv),
+                _mm256_mul_ps(F_256, _mm256_sub_ps(one_256, u))));
+        next_v = _mm256_add_ps(next_v, _mm256_sub_ps(uvv, _mm256_mul_ps(Fk_256, v)));
+
+        _mm256_storeu_ps(u_output + c, next_u);
+        _mm256_storeu_ps(v_output + c, next_v);
+    }
+#endif
+
+    auto laplacian = [&](const float* down, const float* row, const float* up, const float current){
+        return (2.f / 3.f) * (row[c - 1] + row[c + 1] + up[c] + up[c + 1] + down[c] + down[c + 1]
+                - 6.f * current);
+    };
+
+    for(; c < column_end; ++c){
+        const float u = u_row[c];
+        const float v = v_row[c];
+        const float uvv = u * v * v;
+
+        u_output[c] = (u + Ru * laplacian(u_down, u_row, u_up, u)) + (- uvv + F * (1.f - u));
+        v_output[c] = (v + Rv * laplacian(v_down, v_row, v_up, v)) + (uvv - (F + k) * v);
+    }
+}
+
+void HexReactionDiffusionCPU::diffuse_row(const float* down, const float* row, const float* up,
+        const float R, const int column_begin, const int column_end, float* output){
+
+    int c = column_begin;
+
+#if defined(__AVX512F__)
+    const __m512 R_512 = _mm512_set1_ps(R);
+    const __m512 six_512 = _mm512_set1_ps(6.f);
+    const __m512 two_thirds_512 = _mm512_set1_ps(2.f / 3.f);
+
+    for(; c + 16 <= column_end; c += 16){
+        const __m512 current = _mm512_loadu_ps(row + c);
+
+        __m512 sum = _mm512_add_ps(_mm512_loadu_ps(row + c - 1), _mm512_loadu_ps(row + c + 1));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(up + c));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(up + c + 1));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(down + c));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(down + c + 1));
+        sum = _mm512_sub_ps(sum, _mm512_mul_ps(six_512, current));
+
+        _mm512_storeu_ps(output + c, _mm512_add_ps(current, _mm512_mul_ps(R_512, _mm512_mul_ps(two_thirds_512, sum))));
+    }
+#endif
+
+#if defined(__AVX__)
+    const __m256 R_256 = _mm256_set1_ps(R);
+    const __m256 six_256 = _mm256_set1_ps(6.f);
+    const __m256 two_thirds_256 = _mm256_set1_ps(2.f / 3.f);
+
+    for(; c + 8 <= column_end; c += 8){
+        const __m256 current = _mm256_loadu_ps(row + c);
+
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(row + c - 1), _mm256_loadu_ps(row + c + 1));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(up + c));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(up + c + 1));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(down + c));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(down + c + 1));
+        sum = _mm256_sub_ps(sum, _mm256_mul_ps(six_256, current));
+
+        _mm256_storeu_ps(output + c, _mm256_add_ps(current, _mm256_mul_ps(R_256, _mm256_mul_ps(two_thirds_256, sum))));
+    }
+#endif
+
+    for(; c < column_end; ++c){
+        const float current = row[c];
+        output[c] = current + R * ((2.f / 3.f) * (row[c - 1] + row[c + 1] + up[c] + up[c + 1]
+                + down[c] + down[c + 1] - 6.f * current));
+    }
+}
+
+// ---- HexReactionDiffusionCPU ---- //
+
+HexReactionDiffusionCPU::HexReactionDiffusionCPU(const unsigned int number_of_threads)
+    : thread_pool(number_of_threads){
+}
+
+HexReactionDiffusionCPU::~HexReactionDiffusionCPU(){
+    free(state_u[0]);
+    free(state_u[1]);
+    free(state_v[0]);
+    free(state_v[1]);
+}
+
+void HexReactionDiffusionCPU::start(const int simulation_width, const int simulation_height){
+
+    grid.buildGridScanline(simulation_width, simulation_height);
+    number_of_rows = simulation_height;
+
+    for(int istate = 0; istate != 2; ++istate){
+        free(state_u[istate]);
+        free(state_v[istate]);
+
+        state_u[istate] = (float*)malloc(grid.number_of_cells * sizeof(float));
+        state_v[istate] = (float*)malloc(grid.number_of_cells * sizeof(float));
+    }
+    current_state = false;
+
+    reset();
+}
+
+void HexReactionDiffusionCPU::start_layered(const int number_of_layers){
+
+    grid.buildLayered(number_of_layers);
+    number_of_rows = (grid.number_of_cells + row_cells - 1) / row_cells;
+
+    for(int istate = 0; istate != 2; ++istate){
+        free(state_u[istate]);
+        free(state_v[istate]);
+
+        state_u[istate] = (float*)malloc(grid.number_of_cells * sizeof(float));
+        state_v[istate] = (float*)malloc(grid.number_of_cells * sizeof(float));
+    }
+    current_state = false;
+
+    reset();
+}
+
+void HexReactionDiffusionCPU::reset(){
+    std::fill(state_u[(int)current_state], state_u[(int)current_state] + grid.number_of_cells, default_value_u);
+    std::fill(state_v[(int)current_state], state_v[(int)current_state] + grid.number_of_cells, default_value_v);
+}
+
+void HexReactionDiffusionCPU::point(const glm::ivec3 center, const int radius,
+        const float value_u, const float value_v){
+
+    float* current_u = state_u[(int)current_state];
+    float* current_v = state_v[(int)current_state];
+
+    for(int dx = -radius; dx <= radius; ++dx){
+        for(int dy = std::max(-radius, - dx - radius); dy <= std::min(radius, - dx + radius); ++dy){
+            const int icell = grid.cell_index(center + glm::ivec3(dx, dy, - dx - dy));
+
+            if(icell != -1){
+                current_u[icell] = value_u;
+                current_v[icell] = value_v;
+            }
+        }
+    }
+}
+
+void HexReactionDiffusionCPU::step(){
+
+    // rows of about 16K cells per task
+    const int row_length = grid.layout == HexGrid<float>::SCANLINE ? grid.layout_width : row_cells;
+    const int grain = std::max(1, 16384 / std::max(1, row_length));
+
+    thread_pool.parallel_for(0, number_of_rows, grain, [this](const int row_begin, const int row_end){
+        step_band(row_begin, row_end, true, 0.f);
+    });
+
+    current_state = !current_state;
+}
+
+void HexReactionDiffusionCPU::step_diffusion(const float R){
+
+    const int row_length = grid.layout == HexGrid<float>::SCANLINE ? grid.layout_width : row_cells;
+    const int grain = std::max(1, 16384 / std::max(1, row_length));
+
+    thread_pool.parallel_for(0, number_of_rows, grain, [this, R](const int row_begin, const int row_end){
+        step_band(row_begin, row_end, false, R);
+    });
+
+    // v is not updated so it stays in the same buffer
+    current_state = !current_state;
+    std::swap(state_v[0], state_v[1]);
+}
+
+void HexReactionDiffusionCPU::step_band(const int row_begin, const int row_end,
+        const bool reaction, const float R){
+
+    if(grid.layout != HexGrid<float>::SCANLINE){
+        step_cells(row_begin * row_cells, std::min(grid.number_of_cells, (unsigned int)(row_end * row_cells)),
+                reaction, R);
+        return;
+    }
+
+    const int width = grid.layout_width;
+    const int height = grid.layout_height;
+
+    const float* current_u = state_u[(int)current_state];
+    const float* current_v = state_v[(int)current_state];
+    float* next_u = state_u[(int)!current_state];
+    float* next_v = state_v[(int)!current_state];
+
+    for(int row = row_begin; row != row_end; ++row){
+        const unsigned int row_cell = row * width;
+
+        // the first and last rows and columns have missing neighbors
+        if(row == 0 || row == height - 1 || width < 3){
+            step_cells(row_cell, row_cell + width, reaction, R);
+            continue;
+        }
+
+        step_cells(row_cell, row_cell + 1, reaction, R);
+
+        // the neighbors above and below the column c are at c - 1 and c on the
+        // even rows and at c and c + 1 on the odd rows
+        const int offset_up = (row + 1) * width + row % 2 - 1;
+        const int offset_down = (row - 1) * width + row % 2 - 1;
+
+        if(reaction){
+            step_row(current_u + offset_down, current_u + row_cell, current_u + offset_up,
+                    current_v + offset_down, current_v + row_cell, current_v + offset_up,
+                    sim_Ru, sim_Rv, sim_F, sim_R, 1, width - 1, next_u + row_cell, next_v + row_cell);
+        }else{
+            diffuse_row(current_u + offset_down, current_u + row_cell, current_u + offset_up,
+                    R, 1, width - 1, next_u + row_cell);
+        }
+
+        step_cells(row_cell + width - 1, row_cell + width, reaction, R);
+    }
+}
+
+void HexReactionDiffusionCPU::step_cells(const unsigned int cell_begin, const unsigned int cell_end,
+        const bool reaction, const float R){
+
+    const float* current_u = state_u[(int)current_state];
+    const float* current_v = state_v[(int)current_state];
+    float* next_u = state_u[(int)!current_state];
+    float* next_v = state_v[(int)!current_state];
+
+    auto laplacian = [](const float* state, const uint32_t* neighbors, const float current){
+        float sum = 0.f;
+        for(int ineighbor = 0; ineighbor != 6; ++ineighbor){
+            sum += neighbors[ineighbor] != HexGrid<float>::invalid_cell ? state[neighbors[ineighbor]] : current;
+        }
+        return (2.f / 3.f) * (sum - 6.f * current);
+    };
+
+    for(unsigned int icell = cell_begin; icell != cell_end; ++icell){
+        const uint32_t* neighbors = grid.neighbor_indices + 6 * icell;
+        const float u = current_u[icell];
+
+        if(reaction){
+            const float v = current_v[icell];
+            const float uvv = u * v * v;
+
+            next_u[icell] = (u + sim_Ru * laplacian(current_u, neighbors, u)) + (- uvv + sim_F * (1.f - u));
+            next_v[icell] = (v + sim_Rv * laplacian(current_v, neighbors, v)) + (uvv - (sim_F + sim_R) * v);
+        }else{
+            next_u[icell] = u + R * laplacian(current_u, neighbors, u);
+        }
+    }
+}
+
+void HexReactionDiffusionCPU::get_state(float* output_uv) const{
+
+    const float* current_u = state_u[(int)current_state];
+    const float* current_v = state_v[(int)current_state];
+    for(unsigned int icell = 0; icell != grid.number_of_cells; ++icell){
+        output_uv[2 * icell] = current_u[icell];
+        output_uv[2 * icell + 1] = current_v[icell];
+    }
+}
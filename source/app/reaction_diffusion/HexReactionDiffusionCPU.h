@@ -0,0 +1,88 @@
+#ifndef H_HEX_REACTION_DIFFUSION_CPU
+#define H_HEX_REACTION_DIFFUSION_CPU
+
+#include "HexGrid.h"
+#include "WorkStealingPool.h"
+
+#include <cstdint>
+
+// Gray-Scott reaction and scalar diffusion on the cells of a HexGrid with the
+// isotropic 6-neighbor laplacian
+// laplacian(c) = 2 / 3 * (sum of the 6 neighbors - 6 * c)
+// ie h^2 times the laplacian for a distance h between cell centers, the same
+// scaling as the 9-point laplacian of ReactionDiffusionCPU so that both
+// backends use the same rates
+// A missing neighbor replicates the cell value ie the borders are clamped
+// like GL_CLAMP_TO_EDGE
+// The neighbors are read from HexGrid::neighbor_indices, except for the
+// interior cells of a scanline grid whose neighbors are at constant offsets
+// within the rows above and below and are updated with vector instructions
+struct HexReactionDiffusionCPU{
+
+    // number_of_threads = 0 uses one thread per hardware thread
+    HexReactionDiffusionCPU(const unsigned int number_of_threads = 0);
+    ~HexReactionDiffusionCPU();
+
+    // Scanline grid of simulation_width x simulation_height cells
+    void start(const int simulation_width, const int simulation_height);
+    // Hexagon of /number_of_layers/ layers around the cell {0, 0, 0}
+    void start_layered(const int number_of_layers);
+    void reset();
+
+    // Sets the cells at a distance of at most /radius/ cells from /center/
+    void point(const glm::ivec3 center, const int radius, const float value_u, const float value_v);
+
+    // Gray-Scott step of u and v
+    void step();
+
+    // Diffusion step of u only with the rate /R/, v is left unchanged
+    void step_diffusion(const float R);
+
+    // Updates the rows [row_begin; row_end[ of the next state, a row being a
+    // scanline of the grid or /row_cells/ consecutive cells for the other
+    // layouts
+    // reaction = false updates u with step_diffusion(R)
+    void step_band(const int row_begin, const int row_end, const bool reaction, const float R);
+
+    // Update of the cells [cell_begin; cell_end[ through the neighbor table
+    void step_cells(const unsigned int cell_begin, const unsigned int cell_end,
+            const bool reaction, const float R);
+
+    // Update of the cells [column_begin; column_end[ of an interior scanline
+    // The neighbors of the column c are row[c - 1], row[c + 1], up[c], up[c + 1],
+    // down[c] and down[c + 1] ie /up/ and /down/ are offset by the parity of
+    // the row
+    static void step_row(const float* u_down, const float* u_row, const float* u_up,
+            const float* v_down, const float* v_row, const float* v_up,
+            const float Ru, const float Rv, const float F, const float k,
+            const int column_begin, const int column_end, float* u_output, float* v_output);
+    static void diffuse_row(const float* down, const float* row, const float* up,
+            const float R, const int column_begin, const int column_end, float* output);
+
+    // Writes the current state as {u, v} pairs in the order of the cells
+    void get_state(float* output_uv) const;
+
+    // ---- Data ---- //
+
+    HexGrid<float> grid;
+
+    float default_value_u = 0.4201f;
+    float default_value_v = 0.2878f;
+
+    float sim_Ru = 0.125;
+    float sim_Rv = 0.0625; // sim_Ru / 2.f
+    float sim_F = 0.0380;
+    float sim_R = 0.0610;
+
+    // Values of the cells in the order of the grid
+    bool current_state = false;
+    float* state_u[2] = {nullptr, nullptr};
+    float* state_v[2] = {nullptr, nullptr};
+
+    int number_of_rows = 0;
+    static constexpr int row_cells = 1024;
+
+    WorkStealingPool thread_pool;
+};
+
+#endif
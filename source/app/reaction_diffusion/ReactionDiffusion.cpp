@@ -2,6 +2,9 @@
 
 #include "ReactionDiffusion.h"
 
+#include "LinearAllocator.h"
+#include "MemoryStatistics.h"
+
 #include <cmath>
 #include "print.h"
 
@@ -171,7 +174,10 @@ void ReactionDiffusion::start(const int simulation_width, const int simulation_h
 
     // ---- Initializing state textures and framebuffer ---- //
 
-    float* initial_data = (float*)malloc(width * height * 2 * sizeof(float));
+    MemoryTag memory_tag("ReactionDiffusion::start");
+    LinearAllocator& scratch = scratch_allocator();
+    const LinearAllocator::Marker scratch_marker = scratch.mark();
+    float* initial_data = scratch.get_array<float>(width * height * 2);
     for(int idata = 0; idata != width * height; ++idata){
         initial_data[2 * idata] = default_value_u;
         initial_data[2 * idata + 1] = default_value_v;
@@ -194,7 +200,7 @@ void ReactionDiffusion::start(const int simulation_width, const int simulation_h
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    free(initial_data);
+    scratch.rewind(scratch_marker);
 }
 
 void ReactionDiffusion::reset(){
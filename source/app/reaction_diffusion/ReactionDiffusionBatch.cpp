@@ -0,0 +1,181 @@
+#define NOMINMAX
+
+#include "ReactionDiffusionBatch.h"
+#include "ReactionDiffusionCPU.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+ReactionDiffusionBatch::ReactionDiffusionBatch(const unsigned int number_of_threads)
+    : thread_pool(std::max(2u, number_of_threads ? number_of_threads : std::thread::hardware_concurrency()) - 1){
+
+    // the calling thread is also a worker
+    number_of_workers = number_of_threads ? number_of_threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+ReactionDiffusionBatch::~ReactionDiffusionBatch(){
+    free(storage);
+}
+
+void ReactionDiffusionBatch::start(const int instance_width, const int instance_height, const int instances){
+
+    width = instance_width;
+    height = instance_height;
+    number_of_instances = instances;
+
+    // multiple of 8 floats ie 32 bytes, smaller than for a single large grid
+    // to limit the padding of small grids
+    pitch = ((width + 2) + 7) / 8 * 8;
+    instance_size = 4 * (height + 2) * pitch + 2 * pitch;
+
+    free(storage);
+    storage = (float*)malloc((size_t)number_of_instances * instance_size * sizeof(float));
+
+    current_state = false;
+    statistics.assign(number_of_instances, Statistics());
+
+    parallel_instances(number_of_instances, [this](const int instance){
+        set_parameters(instance, 0.f, 0.f);
+        reset(instance);
+
+        float* instance_storage = storage + (size_t)instance * instance_size;
+        std::copy(instance_storage, instance_storage + 2 * (height + 2) * pitch,
+                instance_storage + 2 * (height + 2) * pitch);
+    });
+}
+
+void ReactionDiffusionBatch::reset(const int instance){
+
+    const int grid_size = (height + 2) * pitch;
+    float* current_u = instance_u(instance);
+    float* current_v = instance_v(instance);
+
+    std::fill(current_u, current_u + grid_size, default_value_u);
+    std::fill(current_v, current_v + grid_size, default_value_v);
+
+    // cells whose center is within [-seed_size; seed_size] like ReactionDiffusionCPU::square
+    const int min_x = std::max(0, (int)std::ceil((1.f - seed_size) * 0.5f * width - 0.5f));
+    const int max_x = std::min(width, (int)std::ceil((1.f + seed_size) * 0.5f * width - 0.5f));
+    const int min_y = std::max(0, (int)std::ceil((1.f - seed_size) * 0.5f * height - 0.5f));
+    const int max_y = std::min(height, (int)std::ceil((1.f + seed_size) * 0.5f * height - 0.5f));
+
+    for(int y = min_y; y < max_y; ++y){
+        std::fill(current_u + (y + 1) * pitch + min_x + 1, current_u + (y + 1) * pitch + max_x + 1, seed_value_u);
+        std::fill(current_v + (y + 1) * pitch + min_x + 1, current_v + (y + 1) * pitch + max_x + 1, seed_value_v);
+    }
+}
+
+void ReactionDiffusionBatch::set_parameters(const int instance, const float F, const float k){
+
+    float* instance_F = storage + (size_t)instance * instance_size + 4 * (height + 2) * pitch;
+    std::fill(instance_F, instance_F + width, F);
+    std::fill(instance_F + pitch, instance_F + pitch + width, k);
+}
+
+void ReactionDiffusionBatch::set_parameters(const int instance, const float* F, const float* k){
+
+    float* instance_F = storage + (size_t)instance * instance_size + 4 * (height + 2) * pitch;
+    std::copy(F, F + width, instance_F);
+    std::copy(k, k + width, instance_F + pitch);
+}
+
+void ReactionDiffusionBatch::step(const int number_of_steps){
+
+    const bool final_state = (number_of_steps % 2) ? !current_state : current_state;
+
+    parallel_instances(number_of_instances, [this, number_of_steps, final_state](const int instance){
+        step_instance(instance, number_of_steps);
+        update_statistics(instance, final_state);
+    });
+
+    current_state = final_state;
+}
+
+void ReactionDiffusionBatch::step_instance(const int instance, const int number_of_steps){
+
+    const int grid_size = (height + 2) * pitch;
+    float* instance_storage = storage + (size_t)instance * instance_size;
+    const float* F = instance_storage + 4 * grid_size;
+    const float* k = F + pitch;
+
+    bool state = current_state;
+    for(int istep = 0; istep != number_of_steps; ++istep){
+        const float* previous_u = instance_storage + (int)state * 2 * grid_size;
+        const float* previous_v = previous_u + grid_size;
+        float* next_u = instance_storage + (int)!state * 2 * grid_size;
+        float* next_v = next_u + grid_size;
+
+        for(int y = 1; y != height + 1; ++y){
+            const float* u_row = previous_u + y * pitch;
+            const float* v_row = previous_v + y * pitch;
+            float* u_output = next_u + y * pitch;
+            float* v_output = next_v + y * pitch;
+
+            ReactionDiffusionCPU::step_row(u_row - pitch, u_row, u_row + pitch,
+                    v_row - pitch, v_row, v_row + pitch,
+                    sim_Ru, sim_Rv, F, k,
+                    width, u_output + 1, v_output + 1);
+
+            u_output[0] = u_output[1];
+            u_output[width + 1] = u_output[width];
+            v_output[0] = v_output[1];
+            v_output[width + 1] = v_output[width];
+        }
+
+        std::copy(next_u + pitch, next_u + 2 * pitch, next_u);
+        std::copy(next_v + pitch, next_v + 2 * pitch, next_v);
+        std::copy(next_u + height * pitch, next_u + (height + 1) * pitch, next_u + (height + 1) * pitch);
+        std::copy(next_v + height * pitch, next_v + (height + 1) * pitch, next_v + (height + 1) * pitch);
+
+        state = !state;
+    }
+}
+
+void ReactionDiffusionBatch::update_statistics(const int instance, const bool state){
+
+    const int grid_size = (height + 2) * pitch;
+    const float* instance_storage = storage + (size_t)instance * instance_size;
+    const float* u = instance_storage + (int)state * 2 * grid_size;
+    const float* v = u + grid_size;
+    const float* previous_v = instance_storage + (int)!state * 2 * grid_size + grid_size;
+
+    double sum_u = 0.;
+    double sum_v = 0.;
+    double sum_v_squared = 0.;
+    double sum_change_v = 0.;
+    float min_v = v[pitch + 1];
+    float max_v = v[pitch + 1];
+
+    for(int y = 1; y != height + 1; ++y){
+        for(int x = 1; x != width + 1; ++x){
+            const float value_v = v[y * pitch + x];
+
+            sum_u += u[y * pitch + x];
+            sum_v += value_v;
+            sum_v_squared += value_v * value_v;
+            sum_change_v += std::abs(value_v - previous_v[y * pitch + x]);
+            min_v = std::min(min_v, value_v);
+            max_v = std::max(max_v, value_v);
+        }
+    }
+
+    const double cells = (double)width * height;
+
+    Statistics& instance_statistics = statistics[instance];
+    instance_statistics.mean_u = sum_u / cells;
+    instance_statistics.mean_v = sum_v / cells;
+    instance_statistics.min_v = min_v;
+    instance_statistics.max_v = max_v;
+    instance_statistics.variance_v = std::max(0., sum_v_squared / cells - (sum_v / cells) * (sum_v / cells));
+    instance_statistics.change_v = sum_change_v / cells;
+}
+
+float* ReactionDiffusionBatch::instance_u(const int instance){
+    return storage + (size_t)instance * instance_size + (int)current_state * 2 * (height + 2) * pitch;
+}
+
+float* ReactionDiffusionBatch::instance_v(const int instance){
+    return instance_u(instance) + (height + 2) * pitch;
+}
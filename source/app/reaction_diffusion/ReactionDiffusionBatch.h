@@ -0,0 +1,101 @@
+#ifndef H_REACTION_DIFFUSION_BATCH
+#define H_REACTION_DIFFUSION_BATCH
+
+#include "ThreadPool.hpp"
+
+#include <vector>
+
+// Many small independent Gray-Scott simulations stepped together ie the
+// instances of a parameter sweep such as the maps of
+// https://mrob.com/pub/comp/xmorphia/
+// Each instance has its own feed and kill rates, either one value per grid
+// or one value per column, and the update is the one of ReactionDiffusionCPU
+// An instance is small enough to stay in cache so a worker advances it by all
+// the requested steps before moving to the next instance
+struct ReactionDiffusionBatch{
+
+    // number_of_threads = 0 uses one thread per hardware thread
+    ReactionDiffusionBatch(const unsigned int number_of_threads = 0);
+    ~ReactionDiffusionBatch();
+
+    void start(const int instance_width, const int instance_height, const int instances);
+
+    // Fills the instance with default_value_u and default_value_v and adds a
+    // square of seed_value_u and seed_value_v of side seed_size * grid size
+    // at the center of the grid
+    void reset(const int instance);
+
+    void set_parameters(const int instance, const float F, const float k);
+    // /F/ and /k/ contain one value per column of the grid
+    void set_parameters(const int instance, const float* F, const float* k);
+
+    // Advances every instance by /number_of_steps/ and updates its statistics
+    void step(const int number_of_steps);
+
+    // Calls instance_function(instance) for the instances [0; instances[ in
+    // parallel, each worker taking the next instance when it is done
+    template<typename InstanceFunction>
+    void parallel_instances(const int instances, const InstanceFunction& instance_function);
+
+    // Advances the instance by /number_of_steps/ from the current state, the
+    // result is in the current state when /number_of_steps/ is even and in
+    // the other state otherwise
+    void step_instance(const int instance, const int number_of_steps);
+    void update_statistics(const int instance, const bool state);
+
+    struct Statistics{
+        float mean_u = 0.f;
+        float mean_v = 0.f;
+        float min_v = 0.f;
+        float max_v = 0.f;
+        float variance_v = 0.f;
+        float change_v = 0.f; // mean of |v| variation during the last step
+    };
+
+    // Runs the F_count x k_count instances of
+    // F = F_min + (F_max - F_min) * iF / (F_count - 1) and
+    // k = k_min + (k_max - k_min) * ik / (k_count - 1)
+    // for /number_of_steps/ from the state of reset(), processing /instances/
+    // of them at a time, and calls statistics_function(iF, ik, F, k, statistics)
+    // on the calling thread for each of them in the order of the sweep
+    template<typename StatisticsFunction>
+    void sweep(const float F_min, const float F_max, const int F_count,
+            const float k_min, const float k_max, const int k_count,
+            const int number_of_steps, const StatisticsFunction& statistics_function);
+
+    // Padded grids of the instance ie the cell (x, y) is at index
+    // (y + 1) * pitch + x + 1 and the row 0 is at the bottom
+    float* instance_u(const int instance);
+    float* instance_v(const int instance);
+
+    // ---- Data ---- //
+
+    int width = 0;
+    int height = 0;
+    int number_of_instances = 0;
+
+    float default_value_u = 1.f;
+    float default_value_v = 0.f;
+    float seed_value_u = 0.5f;
+    float seed_value_v = 0.25f;
+    float seed_size = 0.2f;
+
+    float sim_Ru = 0.125;
+    float sim_Rv = 0.0625;
+
+    // Each instance stores u and v of both states followed by the F and k of
+    // each column ie 4 * (height + 2) * pitch + 2 * pitch floats
+    bool current_state = false;
+    int pitch = 0;
+    int instance_size = 0;
+    float* storage = nullptr;
+
+    std::vector<Statistics> statistics;
+
+    ThreadPool thread_pool;
+    int number_of_workers = 0;
+};
+
+#include "ReactionDiffusionBatch.inl"
+
+#endif
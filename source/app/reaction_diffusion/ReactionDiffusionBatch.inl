@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <atomic>
+#include <future>
+
+template<typename InstanceFunction>
+void ReactionDiffusionBatch::parallel_instances(const int instances, const InstanceFunction& instance_function){
+
+    std::atomic<int> next_instance(0);
+    auto worker_function = [&next_instance, instances, &instance_function](){
+        for(int instance = next_instance++; instance < instances; instance = next_instance++){
+            instance_function(instance);
+        }
+    };
+
+    // the calling thread is also a worker
+    std::vector<std::future<void>> worker_tasks;
+    worker_tasks.reserve(number_of_workers);
+    for(int iworker = 0; iworker != std::min(number_of_workers, instances) - 1; ++iworker){
+        worker_tasks.push_back(thread_pool.Enqueue(worker_function));
+    }
+
+    worker_function();
+
+    for(std::future<void>& task : worker_tasks){
+        task.wait();
+    }
+}
+
+template<typename StatisticsFunction>
+void ReactionDiffusionBatch::sweep(const float F_min, const float F_max, const int F_count,
+        const float k_min, const float k_max, const int k_count,
+        const int number_of_steps, const StatisticsFunction& statistics_function){
+
+    const int sweep_instances = F_count * k_count;
+
+    auto get_F = [&](const int isweep){
+        const int iF = isweep / k_count;
+        return (F_count > 1) ? F_min + (F_max - F_min) * iF / (F_count - 1) : F_min;
+    };
+    auto get_k = [&](const int isweep){
+        const int ik = isweep % k_count;
+        return (k_count > 1) ? k_min + (k_max - k_min) * ik / (k_count - 1) : k_min;
+    };
+
+    // every instance is initialized, stepped and summarized by the same
+    // worker ie it is only loaded once in cache
+    const bool final_state = (number_of_steps % 2) ? !current_state : current_state;
+
+    for(int batch_begin = 0; batch_begin < sweep_instances; batch_begin += number_of_instances){
+        const int batch_instances = std::min(number_of_instances, sweep_instances - batch_begin);
+
+        parallel_instances(batch_instances, [&](const int instance){
+            set_parameters(instance, get_F(batch_begin + instance), get_k(batch_begin + instance));
+            reset(instance);
+            step_instance(instance, number_of_steps);
+            update_statistics(instance, final_state);
+        });
+
+        for(int instance = 0; instance != batch_instances; ++instance){
+            const int isweep = batch_begin + instance;
+            statistics_function(isweep / k_count, isweep % k_count, get_F(isweep), get_k(isweep),
+                    statistics[instance]);
+        }
+    }
+
+    current_state = final_state;
+}
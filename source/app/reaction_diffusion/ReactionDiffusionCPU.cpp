@@ -0,0 +1,324 @@
+#define NOMINMAX
+
+#include "ReactionDiffusionCPU.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// ---- Row kernel ---- //
+
+// step_row with the rates of each column when /per_column/ or with the rates
+// *F and *k for the whole row otherwise
+template<bool per_column>
+static void step_row_kernel(const float* u_down, const float* u_row, const float* u_up,
+        const float* v_down, const float* v_row, const float* v_up,
+        const float Ru, const float Rv, const float* F, const float* k,
+        const int width, float* u_output, float* v_output){
+
+    int x = 0;
+
+#if defined(__AVX512F__)
+    const __m512 Ru_512 = _mm512_set1_ps(Ru);
+    const __m512 Rv_512 = _mm512_set1_ps(Rv);
+    const __m512 one_512 = _mm512_set1_ps(1.f);
+    const __m512 four_512 = _mm512_set1_ps(4.f);
+    const __m512 twenty_512 = _mm512_set1_ps(20.f);
+    const __m512 sixth_512 = _mm512_set1_ps(1.f / 6.f);
+    const __m512 row_F_512 = _mm512_set1_ps(F[0]);
+    const __m512 row_Fk_512 = _mm512_set1_ps(F[0] + k[0]);
+
+    auto laplacian_512 = [&](const float* down, const float* row, const float* up, const __m512 current){
+        __m512 cross = _mm512_add_ps(_mm512_loadu_ps(row + x + 2), _mm512_loadu_ps(row + x));
+        cross = _mm512_add_ps(cross, _mm512_loadu_ps(up + x + 1));
+        cross = _mm512_add_ps(cross, _mm512_loadu_ps(down + x + 1));
+
+        __m512 sum = _mm512_mul_ps(four_512, cross);
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(down + x));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(down + x + 2));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(up + x));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(up + x + 2));
+        sum = _mm512_sub_ps(sum, _mm512_mul_ps(twenty_512, current));
+
+        return _mm512_mul_ps(sixth_512, sum);
+    };
+
+    for(; x + 16 <= width; x += 16){
+        const __m512 u = _mm512_loadu_ps(u_row + x + 1);
+        const __m512 v = _mm512_loadu_ps(v_row + x + 1);
+        const __m512 uvv = _mm512_mul_ps(_mm512_mul_ps(u, v), v);
+        const __m512 F_512 = per_column ? _mm512_loadu_ps(F + x) : row_F_512;
+        const __m512 Fk_512 = per_column ? _mm512_add_ps(F_512, _mm512_loadu_ps(k + x)) : row_Fk_512;
+
+        __m512 next_u = _mm512_add_ps(u, _mm512_mul_ps(Ru_512, laplacian_512(u_down, u_row, u_up, u)));
+        __m512 next_v = _mm512_add_ps(v, _mm512_mul_ps(Rv_512, laplacian_512(v_down, v_row, v_up, v)));
+
+        next_u = _mm512_add_ps(next_u, _mm512_add_ps(_mm512_sub_ps(_mm512_setzero_ps(), uvv),
+                _mm512_mul_ps(F_512, _mm512_sub_ps(one_512, u))));
+        next_v = _mm512_add_ps(next_v, _mm512_sub_ps(uvv, _mm512_mul_ps(Fk_512, v)));
+
+        _mm512_storeu_ps(u_output + x, next_u);
+        _mm512_storeu_ps(v_output + x, next_v);
+    }
+#endif
+
+#if defined(__AVX__)
+    const __m256 Ru_256 = _mm256_set1_ps(Ru);
+    const __m256 Rv_256 = _mm256_set1_ps(Rv);
+    const __m256 one_256 = _mm256_set1_ps(1.f);
+    const __m256 four_256 = _mm256_set1_ps(4.f);
+    const __m256 twenty_256 = _mm256_set1_ps(20.f);
+    const __m256 sixth_256 = _mm256_set1_ps(1.f / 6.f);
+    const __m256 row_F_256 = _mm256_set1_ps(F[0]);
+    const __m256 row_Fk_256 = _mm256_set1_ps(F[0] + k[0]);
+
+    auto laplacian_256 = [&](const float* down, const float* row, const float* up, const __m256 current){
+        __m256 cross = _mm256_add_ps(_mm256_loadu_ps(row + x + 2), _mm256_loadu_ps(row + x));
+        cross = _mm256_add_ps(cross, _mm256_loadu_ps(up + x + 1));
+        cross = _mm256_add_ps(cross, _mm256_loadu_ps(down + x + 1));
+
+        __m256 sum = _mm256_mul_ps(four_256, cross);
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(down + x));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(down + x + 2));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(up + x));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(up + x + 2));
+        sum = _mm256_sub_ps(sum, _mm256_mul_ps(twenty_256, current));
+
+        return _mm256_mul_ps(sixth_256, sum);
+    };
+
+    for(; x + 8 <= width; x += 8){
+        const __m256 u = _mm256_loadu_ps(u_row + x + 1);
+        const __m256 v = _mm256_loadu_ps(v_row + x + 1);
+        const __m256 uvv = _mm256_mul_ps(_mm256_mul_ps(u, v), v);
+        const __m256 F_256 = per_column ? _mm256_loadu_ps(F + x) : row_F_256;
+        const __m256 Fk_256 = per_column ? _mm256_add_ps(F_256, _mm256_loadu_ps(k + x)) : row_Fk_256;
+
+        __m256 next_u = _mm256_add_ps(u, _mm256_mul_ps(Ru_256, laplacian_256(u_down, u_row, u_up, u)));
+        __m256 next_v = _mm256_add_ps(v, _mm256_mul_ps(Rv_256, laplacian_256(v_down, v_row, v_up, v)));
+
+        next_u = _mm256_add_ps(next_u, _mm256_add_ps(_mm256_sub_ps(_mm256_setzero_ps(), uvv),
+                _mm256_mul_ps(F_256, _mm256_sub_ps(one_256, u))));
+        next_v = _mm256_add_ps(next_v, _mm256_sub_ps(uvv, _mm256_mul_ps(Fk_256, v)));
+
+        _mm256_storeu_ps(u_output + x, next_u);
+        _mm256_storeu_ps(v_output + x, next_v);
+    }
+#endif
+
+    auto laplacian = [&](const float* down, const float* row, const float* up, const float current){
+        return (1.f / 6.f) *
+
+                (4.f * (row[x + 2] + row[x] + up[x + 1] + down[x + 1])
+
+                + down[x]
+                + down[x + 2]
+                + up[x]
+                + up[x + 2]
+
+                - 20.f * current);
+    };
+
+    for(; x != width; ++x){
+        const float u = u_row[x + 1];
+        const float v = v_row[x + 1];
+        const float uvv = u * v * v;
+
+        const float column_F = F[per_column ? x : 0];
+        const float column_k = k[per_column ? x : 0];
+
+        u_output[x] = (u + Ru * laplacian(u_down, u_row, u_up, u)) + (- uvv + column_F * (1.f - u));
+        v_output[x] = (v + Rv * laplacian(v_down, v_row, v_up, v)) + (uvv - (column_F + column_k) * v);
+    }
+}
+
+void ReactionDiffusionCPU::step_row(const float* u_down, const float* u_row, const float* u_up,
+        const float* v_down, const float* v_row, const float* v_up,
+        const float Ru, const float Rv, const float* F, const float* k,
+        const int width, float* u_output, float* v_output){
+
+    step_row_kernel<true>(u_down, u_row, u_up, v_down, v_row, v_up, Ru, Rv, F, k, width, u_output, v_output);
+}
+
+void ReactionDiffusionCPU::step_row(const float* u_down, const float* u_row, const float* u_up,
+        const float* v_down, const float* v_row, const float* v_up,
+        const float Ru, const float Rv, const float F, const float k,
+        const int width, float* u_output, float* v_output){
+
+    step_row_kernel<false>(u_down, u_row, u_up, v_down, v_row, v_up, Ru, Rv, &F, &k, width, u_output, v_output);
+}
+
+// ---- ReactionDiffusionCPU ---- //
+
+ReactionDiffusionCPU::ReactionDiffusionCPU(const unsigned int number_of_threads)
+    : thread_pool(std::max(1, band_count(number_of_threads) - 1)){
+
+    // the calling thread processes the last band
+    number_of_bands = band_count(number_of_threads);
+}
+
+ReactionDiffusionCPU::~ReactionDiffusionCPU(){
+    free(state_u[0]);
+    free(state_u[1]);
+    free(state_v[0]);
+    free(state_v[1]);
+}
+
+void ReactionDiffusionCPU::start(const int simulation_width, const int simulation_height){
+
+    width = simulation_width;
+    height = simulation_height;
+
+    // multiple of 16 floats ie 64 bytes to keep the rows on separate cache lines
+    pitch = ((width + 2) + 15) / 16 * 16;
+    const int grid_size = (height + 2) * pitch;
+
+    for(int istate = 0; istate != 2; ++istate){
+        free(state_u[istate]);
+        free(state_v[istate]);
+
+        state_u[istate] = (float*)malloc(grid_size * sizeof(float));
+        state_v[istate] = (float*)malloc(grid_size * sizeof(float));
+
+        std::fill(state_u[istate], state_u[istate] + grid_size, default_value_u);
+        std::fill(state_v[istate], state_v[istate] + grid_size, default_value_v);
+    }
+    current_state = false;
+}
+
+void ReactionDiffusionCPU::reset(){
+
+    const int grid_size = (height + 2) * pitch;
+    std::fill(state_u[(int)current_state], state_u[(int)current_state] + grid_size, default_value_u);
+    std::fill(state_v[(int)current_state], state_v[(int)current_state] + grid_size, default_value_v);
+}
+
+void ReactionDiffusionCPU::point(const float center_x, const float center_y, const float radius,
+        const float value_u, const float value_v){
+
+    // Same coverage as the rasterization of ReactionDiffusion::code_disc_set_value
+    // ie the cells whose center is within the disc
+    const int min_x = std::max(0, (int)std::floor((center_x - radius + 1.f) * 0.5f * width));
+    const int max_x = std::min(width, (int)std::ceil((center_x + radius + 1.f) * 0.5f * width));
+    const int min_y = std::max(0, (int)std::floor((center_y - radius + 1.f) * 0.5f * height));
+    const int max_y = std::min(height, (int)std::ceil((center_y + radius + 1.f) * 0.5f * height));
+
+    float* current_u = state_u[(int)current_state];
+    float* current_v = state_v[(int)current_state];
+    for(int y = min_y; y < max_y; ++y){
+        const float distance_y = (-1.f + (2 * y + 1) / (float)height) - center_y;
+
+        for(int x = min_x; x < max_x; ++x){
+            const float distance_x = (-1.f + (2 * x + 1) / (float)width) - center_x;
+
+            if(distance_x * distance_x + distance_y * distance_y <= radius * radius){
+                current_u[cell_index(x, y)] = value_u;
+                current_v[cell_index(x, y)] = value_v;
+            }
+        }
+    }
+
+    update_padding(current_u);
+    update_padding(current_v);
+}
+
+void ReactionDiffusionCPU::square(const float center_x, const float center_y, const float size,
+        const float value_u, const float value_v){
+
+    // cells whose center is within [center - size; center + size]
+    const float min_coord_x = std::max(center_x - size, -1.f);
+    const float max_coord_x = std::min(center_x + size, 1.f);
+    const float min_coord_y = std::max(center_y - size, -1.f);
+    const float max_coord_y = std::min(center_y + size, 1.f);
+
+    const int min_x = std::max(0, (int)std::ceil((min_coord_x + 1.f) * 0.5f * width - 0.5f));
+    const int max_x = std::min(width, (int)std::ceil((max_coord_x + 1.f) * 0.5f * width - 0.5f));
+    const int min_y = std::max(0, (int)std::ceil((min_coord_y + 1.f) * 0.5f * height - 0.5f));
+    const int max_y = std::min(height, (int)std::ceil((max_coord_y + 1.f) * 0.5f * height - 0.5f));
+
+    float* current_u = state_u[(int)current_state];
+    float* current_v = state_v[(int)current_state];
+    for(int y = min_y; y < max_y; ++y){
+        for(int x = min_x; x < max_x; ++x){
+            current_u[cell_index(x, y)] = value_u;
+            current_v[cell_index(x, y)] = value_v;
+        }
+    }
+
+    update_padding(current_u);
+    update_padding(current_v);
+}
+
+void ReactionDiffusionCPU::step(){
+
+    parallel_bands(thread_pool, number_of_bands, height, [this](const int, const int row_begin, const int row_end){
+        step_band(row_begin, row_end);
+    });
+
+    // the padding rows replicate the rows 0 and height - 1 once they are complete
+    float* next_u = state_u[(int)!current_state];
+    float* next_v = state_v[(int)!current_state];
+    std::copy(next_u + pitch, next_u + 2 * pitch, next_u);
+    std::copy(next_v + pitch, next_v + 2 * pitch, next_v);
+    std::copy(next_u + height * pitch, next_u + (height + 1) * pitch, next_u + (height + 1) * pitch);
+    std::copy(next_v + height * pitch, next_v + (height + 1) * pitch, next_v + (height + 1) * pitch);
+
+    current_state = !current_state;
+}
+
+void ReactionDiffusionCPU::step_band(const int row_begin, const int row_end){
+
+    const float* previous_u = state_u[(int)current_state];
+    const float* previous_v = state_v[(int)current_state];
+    float* next_u = state_u[(int)!current_state];
+    float* next_v = state_v[(int)!current_state];
+
+    for(int y = row_begin; y != row_end; ++y){
+        const float* u_row = previous_u + (y + 1) * pitch;
+        const float* v_row = previous_v + (y + 1) * pitch;
+        float* u_output = next_u + (y + 1) * pitch;
+        float* v_output = next_v + (y + 1) * pitch;
+
+        step_row(u_row - pitch, u_row, u_row + pitch,
+                v_row - pitch, v_row, v_row + pitch,
+                sim_Ru, sim_Rv, sim_F, sim_R,
+                width, u_output + 1, v_output + 1);
+
+        u_output[0] = u_output[1];
+        u_output[width + 1] = u_output[width];
+        v_output[0] = v_output[1];
+        v_output[width + 1] = v_output[width];
+    }
+}
+
+void ReactionDiffusionCPU::update_padding(float* grid){
+
+    for(int y = 1; y != height + 1; ++y){
+        grid[y * pitch] = grid[y * pitch + 1];
+        grid[y * pitch + width + 1] = grid[y * pitch + width];
+    }
+
+    std::copy(grid + pitch, grid + 2 * pitch, grid);
+    std::copy(grid + height * pitch, grid + (height + 1) * pitch, grid + (height + 1) * pitch);
+}
+
+void ReactionDiffusionCPU::get_state(float* output_uv) const{
+
+    const float* current_u = state_u[(int)current_state];
+    const float* current_v = state_v[(int)current_state];
+    for(int y = 0; y != height; ++y){
+        for(int x = 0; x != width; ++x){
+            output_uv[2 * (y * width + x)] = current_u[cell_index(x, y)];
+            output_uv[2 * (y * width + x) + 1] = current_v[cell_index(x, y)];
+        }
+    }
+}
+
+int ReactionDiffusionCPU::cell_index(const int x, const int y) const{
+    return (y + 1) * pitch + x + 1;
+}
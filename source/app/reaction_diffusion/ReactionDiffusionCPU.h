@@ -0,0 +1,81 @@
+#ifndef H_REACTION_DIFFUSION_CPU
+#define H_REACTION_DIFFUSION_CPU
+
+#include "ParallelBands.h"
+
+// CPU implementation of ReactionDiffusion with the same interface that does
+// not require an OpenGL context
+// The update is the one of ReactionDiffusion::code_step_forward ie a Gray-Scott
+// reaction with a 9-point laplacian and borders clamped like GL_CLAMP_TO_EDGE
+// u and v are stored in separate grids so that both laplacians and the
+// reaction of consecutive cells are computed together with vector instructions
+struct ReactionDiffusionCPU{
+
+    // number_of_threads = 0 uses one thread per hardware thread
+    ReactionDiffusionCPU(const unsigned int number_of_threads = 0);
+    ~ReactionDiffusionCPU();
+
+    void start(const int simulation_width, const int simulation_height);
+    void reset();
+
+    // The variables center_x, center_y and radius must be given in OpenGL
+    // screen coordinates ie within [-1;1]
+    void point(const float center_x, const float center_y, const float radius,
+            const float value_u, const float value_v);
+    void square(const float center_x, const float center_y, const float size,
+            const float value_u, const float value_v);
+
+    void step();
+
+    // Updates the rows [row_begin; row_end[ of the next state
+    void step_band(const int row_begin, const int row_end);
+
+    // Same expressions as ReactionDiffusion::code_step_forward for the cells
+    // [0; width[ of one row with the feed and kill rates /F/ and /k/ of each column
+    // The rows are padded ie the value of the cell x is at index x + 1
+    static void step_row(const float* u_down, const float* u_row, const float* u_up,
+            const float* v_down, const float* v_row, const float* v_up,
+            const float Ru, const float Rv, const float* F, const float* k,
+            const int width, float* u_output, float* v_output);
+    // step_row with the same rates /F/ and /k/ for the whole row
+    static void step_row(const float* u_down, const float* u_row, const float* u_up,
+            const float* v_down, const float* v_row, const float* v_up,
+            const float Ru, const float Rv, const float F, const float k,
+            const int width, float* u_output, float* v_output);
+
+    // Copies the border cells of /grid/ to its padding
+    void update_padding(float* grid);
+
+    // Writes the current state as {u, v} pairs ie the layout of the RG32F
+    // textures used by ReactionDiffusion
+    void get_state(float* output_uv) const;
+
+    // Index of the cell (x, y) in the grids
+    int cell_index(const int x, const int y) const;
+
+    // ---- Data ---- //
+
+    int width = 0;
+    int height = 0;
+
+    float default_value_u = 0.4201f;
+    float default_value_v = 0.2878f;
+
+    float sim_Ru = 0.125;
+    float sim_Rv = 0.0625; // sim_Ru / 2.f
+    float sim_F = 0.0380;
+    float sim_R = 0.0610;
+
+    // Row-major grids with the row 0 at the bottom and one cell of padding
+    // around the grid that replicates the borders ie GL_CLAMP_TO_EDGE
+    // The cell (x, y) is at index (y + 1) * pitch + x + 1
+    bool current_state = false;
+    float* state_u[2] = {nullptr, nullptr};
+    float* state_v[2] = {nullptr, nullptr};
+    int pitch = 0;
+
+    ThreadPool thread_pool;
+    int number_of_bands = 0;
+};
+
+#endif
@@ -2,11 +2,14 @@
 #include "OpenGLWindow.h"
 
 #include "ReactionDiffusion.h"
+#include "ReactionDiffusionCPU.h"
 #include "TextureRenderer.h"
 
 #include "utils.h"
 //#include "print.h"
 
+#include <vector>
+
 // Reference for reaction-diffusion and the simulation parameters
 // https://mrob.com/pub/comp/xmorphia/
 
@@ -29,6 +32,10 @@ int main(){
 
     constexpr int steps_per_render = 5;
 
+    // The simulation runs on the CPU and the state is uploaded to a texture
+    // every frame for rendering
+    constexpr bool use_cpu_backend = false;
+
     // ---------- END PARAMETERS ---------- //
 
     OpenGLWindow window;
@@ -40,6 +47,25 @@ int main(){
     simulation.sim_R = sim_R;
     simulation.start(sim_width, sim_height);
 
+    ReactionDiffusionCPU simulation_cpu;
+    ogl::Texture texture_cpu;
+    std::vector<float> texture_cpu_data;
+    if(use_cpu_backend){
+        texture_cpu_data.resize(2 * sim_width * sim_height);
+
+        simulation_cpu.sim_F = sim_F;
+        simulation_cpu.sim_R = sim_R;
+        simulation_cpu.start(sim_width, sim_height);
+
+        glBindTexture(GL_TEXTURE_2D, texture_cpu.handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, sim_width, sim_height, 0, GL_RG, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
     TextureRenderer renderer(TextureRenderer::RG);
 
     // Dynamic Parameters
@@ -73,16 +99,26 @@ int main(){
             float pos_x, pos_y;
             window.cursor_screen_coordinates(pos_x, pos_y);
 
-            simulation.point(pos_x, pos_y, interaction_radius,
-                    interaction_value_uv[0], interaction_value_uv[1]);
+            if(use_cpu_backend){
+                simulation_cpu.point(pos_x, pos_y, interaction_radius,
+                        interaction_value_uv[0], interaction_value_uv[1]);
+            }else{
+                simulation.point(pos_x, pos_y, interaction_radius,
+                        interaction_value_uv[0], interaction_value_uv[1]);
+            }
         }
 
         if(glfwGetMouseButton(window.window, GLFW_MOUSE_BUTTON_RIGHT)){
             float pos_x, pos_y;
             window.cursor_screen_coordinates(pos_x, pos_y);
 
-            simulation.square(pos_x, pos_y, interaction_radius,
-                    interaction_value_uv[0], interaction_value_uv[1]);
+            if(use_cpu_backend){
+                simulation_cpu.square(pos_x, pos_y, interaction_radius,
+                        interaction_value_uv[0], interaction_value_uv[1]);
+            }else{
+                simulation.square(pos_x, pos_y, interaction_radius,
+                        interaction_value_uv[0], interaction_value_uv[1]);
+            }
         }
 
         bool step_this_frame = false;
@@ -98,18 +134,38 @@ int main(){
         // ---- Running Simulation ---- //
 
         if(reset_this_frame){
-            simulation.reset();
+            if(use_cpu_backend){
+                simulation_cpu.reset();
+            }else{
+                simulation.reset();
+            }
         }
 
         if(step_this_frame){
             for(int istep = 0; istep != steps_per_render; ++istep){
-                simulation.step();
+                if(use_cpu_backend){
+                    simulation_cpu.step();
+                }else{
+                    simulation.step();
+                }
             }
         }
 
         // ---- Render Simulation ---- //
 
-        renderer.render(window, simulation.texture_state[(int)simulation.current_state]);
+        if(use_cpu_backend){
+            simulation_cpu.get_state(texture_cpu_data.data());
+
+            glBindTexture(GL_TEXTURE_2D, texture_cpu.handle);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sim_width, sim_height, GL_RG, GL_FLOAT,
+                    texture_cpu_data.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            renderer.render(window, texture_cpu);
+
+        }else{
+            renderer.render(window, simulation.texture_state[(int)simulation.current_state]);
+        }
 
         // -------- End of Frame -------- //
 
@@ -2,8 +2,37 @@
 #include "OpenGLWindow.h"
 
 #include "MemoryPool.h"
+#include "ConcurrentMemoryPool.h"
+#include "HexGrid.h"
+#include "DynamicKDTree.h"
+#include "FlatKDTree.h"
+#include "FreeList.h"
+#include "LinearAllocator.h"
+#include "MemoryStatistics.h"
+#include "SizeClassAllocator.h"
+#include "VirtualArena.h"
+#include "DiffusionCPU.h"
+#include "ReactionDiffusionCPU.h"
+#include "ReactionDiffusionBatch.h"
+#include "HexReactionDiffusionCPU.h"
+#include "ParticlesCPU.h"
+#include "WorkStealingPool.h"
 
 #include "print.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <glm/common.hpp>
 
 void memory_allocator(){
     MemoryPool<sizeof(int)> pool;
@@ -29,8 +58,1217 @@ void memory_allocator(){
     //pool.give(F);
 }
 
+void memory_pool_growable(){
+    MemoryPool<sizeof(int)> pool;
+    pool.growable = true;
+    pool.allocate(4);
+
+    // the first 4 blocks come from the initial slab and the others from the
+    // slabs added by get
+    std::vector<int*> blocks;
+    for(int iblock = 0; iblock != 1000; ++iblock){
+        blocks.push_back(pool.get<int>(iblock));
+    }
+
+    bool values = true;
+    for(int iblock = 0; iblock != 1000; ++iblock){
+        values = values && blocks[iblock] && *blocks[iblock] == iblock;
+    }
+    print("MemoryPool growable values", values, "slabs", pool.slabs.size(), "blocks", pool.memory_blocks);
+
+    for(int iblock = 4; iblock != 1000; ++iblock){
+        pool.give(blocks[iblock]);
+    }
+
+    const size_t released = pool.shrink();
+    values = true;
+    for(int iblock = 0; iblock != 4; ++iblock){
+        values = values && *blocks[iblock] == iblock;
+    }
+    print("MemoryPool shrink released", released, "remaining", pool.memory_blocks, "values", values);
+}
+
+void size_class_allocator(){
+    SizeClassAllocator allocator;
+
+    const bool classes = SizeClassAllocator::size_class(1) == 0
+        && SizeClassAllocator::size_class(8) == 0
+        && SizeClassAllocator::size_class(9) == 1
+        && SizeClassAllocator::size_class(64) == 3
+        && SizeClassAllocator::size_class(65) == 4
+        && SizeClassAllocator::size_class(1024) == 7;
+
+    // every block is aligned and the blocks do not overlap
+    struct Block{
+        char* ptr;
+        size_t bytes;
+        size_t alignment;
+    };
+    std::vector<Block> blocks;
+    bool aligned = true;
+    for(const size_t bytes : {1, 7, 8, 12, 16, 24, 100, 500, 1000, 1024, 1025, 5000}){
+        for(const size_t alignment : {1, 2, 4, 8, 16, 64}){
+            char* ptr = (char*)allocator.allocate(bytes, alignment);
+            aligned = aligned && ((uintptr_t)ptr % alignment) == 0;
+            std::fill(ptr, ptr + bytes, (char)blocks.size());
+            blocks.push_back({ptr, bytes, alignment});
+        }
+    }
+
+    bool values = true;
+    for(size_t iblock = 0; iblock != blocks.size(); ++iblock){
+        values = values && std::all_of(blocks[iblock].ptr, blocks[iblock].ptr + blocks[iblock].bytes,
+            [iblock](const char value){return value == (char)iblock;});
+        allocator.deallocate(blocks[iblock].ptr, blocks[iblock].bytes, blocks[iblock].alignment);
+    }
+
+    // node based containers
+    std::pmr::map<int, double> map(&allocator);
+    for(int ivalue = 0; ivalue != 10000; ++ivalue){
+        map[(ivalue * 7919) % 10000] = ivalue;
+    }
+    const bool map_values = map.size() == 10000 && map.begin()->first == 0 && map.rbegin()->first == 9999;
+    map.clear();
+
+    print("SizeClassAllocator classes", classes, "aligned", aligned, "values", values,
+            "map", map_values, "shrink bytes", allocator.shrink());
+}
+
+void linear_allocator(){
+    LinearAllocator allocator;
+    allocator.allocate(64);
+
+    char* A = allocator.get<char>('a');
+    double* B = allocator.get<double>(2.0);
+    const bool aligned = ((uintptr_t)B % alignof(double)) == 0 && (char*)B - A == alignof(double);
+
+    // the memory allocated after the marker is reused after the rewind
+    const LinearAllocator::Marker marker = allocator.mark();
+    int* C = allocator.get_array<int>(4);
+    allocator.rewind(marker);
+    int* D = allocator.get_array<int>(4);
+
+    // a full allocator returns nullptr unless it is growable
+    float* E = allocator.get_array<float>(100);
+    allocator.growable = true;
+    float* F = allocator.get_array<float>(100);
+
+    print("LinearAllocator aligned", aligned, "rewind", C == D, "full", E == nullptr,
+            "growable", F != nullptr, "chunks", allocator.chunks.size(), "values", *A == 'a' && *B == 2.0);
+
+    // the allocations of a frame are valid during the next frame
+    FrameAllocator frame_allocator;
+    frame_allocator.allocate(64);
+    int* frame_0 = frame_allocator.get<int>(0);
+    frame_allocator.next_frame();
+    int* frame_1 = frame_allocator.get<int>(1);
+    frame_allocator.next_frame();
+    int* frame_2 = frame_allocator.get<int>(2);
+
+    print("FrameAllocator", frame_0 != frame_1 && frame_0 == frame_2 && *frame_1 == 1);
+}
+
+void free_list(){
+    constexpr size_t arena_bytes = 1 << 20;
+
+    FreeList allocator;
+    allocator.allocate(arena_bytes);
+    const uint32_t initial_bitmap = allocator.first_level_bitmap;
+
+    struct Block{
+        unsigned char* ptr;
+        size_t bytes;
+        unsigned char value;
+    };
+    std::vector<Block> blocks;
+
+    // random gets and gives, each block is filled with a value checked when
+    // it is given back
+    unsigned int random = 12345;
+    bool aligned = true;
+    bool values = true;
+    int failed_gets = 0;
+    for(int ioperation = 0; ioperation != 100000; ++ioperation){
+        random = random * 1664525u + 1013904223u;
+
+        if(blocks.empty() || (random >> 16) % 2 != 0){
+            const size_t bytes = 1 + (random >> 8) % ((random & 1) ? 64 : 4096);
+            const size_t alignment = (size_t)1 << ((random >> 4) % 8);
+            unsigned char* ptr = (unsigned char*)allocator.get_bytes(bytes, alignment);
+            if(!ptr){
+                ++failed_gets;
+                continue;
+            }
+            aligned = aligned && ((uintptr_t)ptr % alignment) == 0;
+            std::fill(ptr, ptr + bytes, (unsigned char)ioperation);
+            blocks.push_back({ptr, bytes, (unsigned char)ioperation});
+
+        }else{
+            const size_t iblock = (random >> 8) % blocks.size();
+            values = values && std::all_of(blocks[iblock].ptr, blocks[iblock].ptr + blocks[iblock].bytes,
+                [&](const unsigned char value){return value == blocks[iblock].value;});
+            allocator.give_bytes(blocks[iblock].ptr);
+            blocks[iblock] = blocks.back();
+            blocks.pop_back();
+        }
+    }
+
+    for(const Block& block : blocks){
+        allocator.give_bytes(block.ptr);
+    }
+
+    // every block has been merged back ie the arena is a single free block
+    const bool coalesced = allocator.first_level_bitmap == initial_bitmap
+        && allocator.get_bytes(arena_bytes / 2) != nullptr;
+
+    print("FreeList aligned", aligned, "values", values, "failed gets", failed_gets,
+            "coalesced", coalesced);
+}
+
+void virtual_arena(){
+    VirtualArena arena;
+    const bool reserved = arena.reserve((size_t)1 << 34, VirtualArena::TRANSPARENT);
+
+    // only the used part of the reservation is committed
+    char* A = (char*)arena.get_bytes(1000);
+    std::fill(A, A + 1000, 1);
+    char* B = (char*)arena.get_bytes(1 << 20, 4096);
+    std::fill(B, B + (1 << 20), 2);
+    const bool committed = arena.committed_bytes >= arena.used_bytes && arena.committed_bytes < ((size_t)8 << 20);
+
+    // the memory reads as zero after a reset
+    arena.reset();
+    char* C = (char*)arena.get_bytes(1000);
+    const bool zero = C == A && std::all_of(C, C + 1000, [](const char value){return value == 0;});
+
+    // allocators backed by the arena
+    LinearAllocator linear_allocator;
+    linear_allocator.arena = &arena;
+    linear_allocator.allocate((size_t)1 << 30);
+    float* D = linear_allocator.get_array<float>(1000);
+
+    MemoryPool<sizeof(double)> pool;
+    pool.arena = &arena;
+    pool.growable = true;
+    pool.allocate(16);
+    std::vector<double*> blocks;
+    for(int iblock = 0; iblock != 1000; ++iblock){
+        blocks.push_back(pool.get<double>(iblock));
+    }
+
+    const bool allocators = D && (char*)D >= arena.memory && (char*)D < arena.memory + arena.reserved_bytes
+        && pool.owns(blocks.back()) && *blocks.back() == 999.;
+
+    print("VirtualArena reserved", reserved, "huge pages", arena.huge_pages, "committed", committed,
+            "zero after reset", zero, "allocators", allocators);
+}
+
+void memory_statistics(){
+    AllocatorStatistics* statistics = allocator_statistics("test");
+
+    {
+        MemoryTag tag("outer");
+        statistics->record_get(100);
+        {
+            MemoryTag nested_tag("inner");
+            statistics->record_get(5000);
+            statistics->record_failed_get(1 << 20);
+        }
+        statistics->record_give(5000);
+    }
+    statistics->record_get(8);
+
+    const bool values = statistics->live_bytes == 108 && statistics->high_water_bytes == 5100
+        && statistics->gets == 3 && statistics->gives == 1 && statistics->failed_gets == 1
+        && statistics->size_class_gets[0] == 1 && statistics->size_class_gets[4] == 1 && statistics->size_class_gets[10] == 1
+        && statistics->tags["outer"].gets == 1 && statistics->tags["inner"].bytes == 5000
+        && allocator_statistics("test") == statistics;
+
+    // threads sharing a record, with distinct tags per thread
+    AllocatorStatistics* shared = allocator_statistics("test threads");
+    std::vector<std::thread> threads;
+    const char* thread_tags[4] = {"thread 0", "thread 1", "thread 2", "thread 3"};
+    for(int ithread = 0; ithread != 4; ++ithread){
+        threads.emplace_back([shared, &thread_tags, ithread](){
+            MemoryTag tag(thread_tags[ithread]);
+            for(int iget = 0; iget != 10000; ++iget){
+                shared->record_get(16);
+                shared->record_give(16);
+            }
+        });
+    }
+    for(std::thread& thread : threads){
+        thread.join();
+    }
+    const bool shared_values = shared->gets == 40000 && shared->gives == 40000 && shared->live_bytes == 0
+        && shared->high_water_bytes <= 64 && shared->tags.size() == 4 && shared->tags["thread 2"].gets == 10000;
+
+    // the records of the allocators only exist when MEMORY_STATISTICS is defined
+#if defined(MEMORY_STATISTICS)
+    MemoryPool<64> pool;
+    pool.statistics = allocator_statistics("test pool");
+    pool.allocate(1);
+    pool.give(pool.get<double>());
+    pool.get<double>();
+    pool.get<double>();
+    const bool pool_values = pool.statistics->gets == 2 && pool.statistics->failed_gets == 1
+        && pool.statistics->live_bytes == 64 && pool.statistics->high_water_bytes == 64;
+#else
+    const bool pool_values = true;
+#endif
+
+    const char* path = "test_memory_statistics.json";
+    const bool written = write_memory_statistics(path);
+    std::ifstream file(path);
+    std::stringstream json;
+    json << file.rdbuf();
+    file.close();
+    std::remove(path);
+    const bool named = json.str().find("\"name\": \"test\"") != std::string::npos;
+
+    print("MemoryStatistics values", values, "threads", shared_values, "pool", pool_values, "json", written && named);
+}
+
+void concurrent_memory_pool(){
+
+    constexpr int number_of_blocks = 1000;
+    constexpr int number_of_threads = 4;
+    constexpr int rounds = 1000;
+    constexpr int blocks_per_round = 100;
+
+    ConcurrentMemoryPool<sizeof(int)> pool;
+    pool.allocate(number_of_blocks);
+
+    // each thread writes its index in the blocks it owns and checks that no
+    // other thread received them
+    std::atomic<int> errors(0);
+    std::vector<std::thread> threads;
+    for(int ithread = 0; ithread != number_of_threads; ++ithread){
+        threads.emplace_back([&pool, &errors, ithread](){
+            ConcurrentMemoryPool<sizeof(int)>::Cache cache(pool);
+            int* blocks[blocks_per_round];
+
+            for(int iround = 0; iround != rounds; ++iround){
+                const int count = 1 + (iround * 7 + ithread) % blocks_per_round;
+                for(int iblock = 0; iblock != count; ++iblock){
+                    blocks[iblock] = cache.get<int>(ithread);
+                }
+                for(int iblock = 0; iblock != count; ++iblock){
+                    if(!blocks[iblock] || *blocks[iblock] != ithread){
+                        errors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                for(int iblock = 0; iblock != count; ++iblock){
+                    cache.give(blocks[iblock]);
+                }
+            }
+        });
+    }
+    for(std::thread& thread : threads){
+        thread.join();
+    }
+
+    // every block is back in the global list once the caches are destroyed
+    ConcurrentMemoryPool<sizeof(int)>::Cache cache(pool);
+    std::vector<int*> blocks;
+    while(int* block = cache.get<int>()){
+        blocks.push_back(block);
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    print("ConcurrentMemoryPool errors", errors.load(),
+            "blocks", blocks.size(), "of", number_of_blocks,
+            "unique", std::unique(blocks.begin(), blocks.end()) == blocks.end());
+
+    for(int* block : blocks){
+        cache.give(block);
+    }
+}
+
+void hexgrid(){
+
+    // the closed form index of each cell is its position in the grid and the
+    // neighbors are the cells at distance 1
+    auto check_grid = [](HexGrid<float>& grid){
+        bool indices = true;
+        bool neighbors = true;
+        for(unsigned int icell = 0; icell != grid.number_of_cells; ++icell){
+            const glm::ivec3 cube_coord = grid.cell_coord(icell);
+            indices = indices && grid.cell_index(cube_coord) == (int)icell
+                && grid.searchCell(cube_coord) == grid.grid_values + icell;
+
+            for(int ineighbor = 0; ineighbor != 6; ++ineighbor){
+                const glm::ivec3 neighbor_coord = cube_coord + ::neighbor_coord[ineighbor];
+                const uint32_t neighbor = grid.neighbor(icell, ineighbor);
+
+                uint32_t expected = HexGrid<float>::invalid_cell;
+                for(unsigned int iother = 0; iother != grid.number_of_cells; ++iother){
+                    if(grid.cell_coord(iother) == neighbor_coord){
+                        expected = iother;
+                    }
+                }
+                neighbors = neighbors && neighbor == expected;
+            }
+        }
+        return indices && neighbors;
+    };
+
+    HexGrid<float> layered;
+    layered.buildLayered(6);
+
+    HexGrid<float> scanline;
+    scanline.buildGridScanline(13, 9);
+
+    // same cells as the layered grid in reverse order
+    std::vector<glm::ivec3> coords;
+    for(unsigned int icell = layered.number_of_cells; icell-- != 0;){
+        coords.push_back(layered.cell_coord(icell));
+    }
+    HexGrid<float> custom;
+    custom.buildCustom(coords);
+
+    // coordinates outside of the plane x + y + z = 0, {1, 1, 1} would be the
+    // cell after the last one of a single layer and {1, 5, 0} has the x and z
+    // of the cell {1, -1, 0}
+    HexGrid<float> single_layer;
+    single_layer.buildLayered(1);
+    const bool invalid_coordinates = single_layer.searchCell(1, 1, 1) == nullptr
+        && layered.cell_index(glm::ivec3(1, 5, 0)) == -1 && custom.cell_index(glm::ivec3(1, 5, 0)) == -1
+        && scanline.cell_index(glm::ivec3(0, 0, 1)) == -1;
+
+    print("HexGrid layered", layered.number_of_cells, check_grid(layered),
+            "scanline", check_grid(scanline),
+            "custom", check_grid(custom),
+            "outside", layered.searchCell(7, -7, 0) == nullptr && scanline.searchCell(0, 1, -1) == nullptr
+                && custom.searchCell(7, 0, -7) == nullptr,
+            "invalid", invalid_coordinates);
+}
+
+void diffusion_cpu(){
+    constexpr int width = 37;
+    constexpr int height = 23;
+    constexpr float R = 0.35f;
+
+    DiffusionCPU simulation(3);
+    simulation.start(width, height);
+    simulation.interaction(0.2f, 0.1f, 0.3f, DiffusionCPU::SOURCE);
+    simulation.interaction(-0.5f, -0.4f, 0.2f, DiffusionCPU::SINK);
+
+    // scalar version of Diffusion::code_step_forward with clamped texel fetches
+    std::vector<float> state(simulation.state[0], simulation.state[0] + width * height);
+    std::vector<float> next(width * height);
+    const std::vector<float> source_sink(simulation.source_sink, simulation.source_sink + width * height);
+
+    auto get_value = [&](int x, int y){
+        x = std::min(std::max(x, 0), width - 1);
+        y = std::min(std::max(y, 0), height - 1);
+        const float source_sink_value = source_sink[y * width + x];
+        return (source_sink_value != simulation.min_initial_max[DiffusionCPU::CLEAR]) ? source_sink_value : state[y * width + x];
+    };
+
+    for(int istep = 0; istep != 50; ++istep){
+        for(int y = 0; y != height; ++y){
+            for(int x = 0; x != width; ++x){
+                const float current_value = get_value(x, y);
+                const float laplacian = (1.f / 6.f) *
+                    (4.f * (get_value(x + 1, y) + get_value(x - 1, y) + get_value(x, y + 1) + get_value(x, y - 1))
+                    + get_value(x - 1, y - 1) + get_value(x + 1, y - 1)
+                    + get_value(x - 1, y + 1) + get_value(x + 1, y + 1)
+                    - 20.f * current_value);
+                next[y * width + x] = current_value + R * laplacian;
+            }
+        }
+        state.swap(next);
+
+        simulation.step(R);
+    }
+
+    float max_difference = 0.f;
+    for(int icell = 0; icell != width * height; ++icell){
+        max_difference = std::max(max_difference,
+                std::abs(state[icell] - simulation.state[(int)simulation.current_state][icell]));
+    }
+
+    print("DiffusionCPU max difference with the reference:", max_difference);
+}
+
+void diffusion_cpu_fused(){
+
+    // step(R, n) advances tiles by several steps with their halo, the result
+    // is the same as n calls to step(R), including the counts that are not
+    // multiples of max_fused_steps and tiles smaller than the grid
+    constexpr int width = 70;
+    constexpr int height = 45;
+    constexpr float R = 0.35f;
+
+    DiffusionCPU reference(3);
+    DiffusionCPU fused(3);
+    fused.tile_width = 32;
+    fused.tile_height = 16;
+    for(DiffusionCPU* simulation : {&reference, &fused}){
+        simulation->start(width, height);
+        simulation->interaction(0.6f, 0.5f, 0.2f, DiffusionCPU::SOURCE);
+        simulation->interaction(-0.5f, -0.4f, 0.2f, DiffusionCPU::SINK);
+    }
+
+    float max_difference = 0.f;
+    for(const int number_of_steps : {1, 3, 8, 13, 40}){
+        for(int istep = 0; istep != number_of_steps; ++istep){
+            reference.step(R);
+        }
+        fused.step(R, number_of_steps);
+
+        for(int icell = 0; icell != width * height; ++icell){
+            max_difference = std::max(max_difference, std::abs(fused.state[(int)fused.current_state][icell]
+                - reference.state[(int)reference.current_state][icell]));
+        }
+    }
+
+    print("DiffusionCPU fused steps max difference:", max_difference);
+}
+
+void diffusion_cpu_implicit(){
+
+    // backward Euler (theta = 1) and Crank-Nicolson (theta = 0.5) steps
+    // converge to the steady state of the explicit steps, compared on the
+    // cells that are neither sources nor sinks
+    // The explicit steps stop at a fixed point of the float computations
+    // around 1e-5 from the exact steady state
+    constexpr int width = 40;
+    constexpr int height = 30;
+
+    DiffusionCPU explicit_simulation(3);
+    DiffusionCPU backward_euler(3);
+    DiffusionCPU crank_nicolson(3);
+    for(DiffusionCPU* simulation : {&explicit_simulation, &backward_euler, &crank_nicolson}){
+        simulation->start(width, height);
+        simulation->interaction(0.5f, 0.4f, 0.2f, DiffusionCPU::SOURCE);
+        simulation->interaction(-0.5f, -0.4f, 0.2f, DiffusionCPU::SINK);
+        simulation->multigrid_tolerance = 1e-7f;
+    }
+
+    explicit_simulation.step(0.35f, 20000);
+
+    int max_cycles = 0;
+    for(int istep = 0; istep != 300; ++istep){
+        max_cycles = std::max(max_cycles, backward_euler.step_implicit(5.f, 1.f));
+        max_cycles = std::max(max_cycles, crank_nicolson.step_implicit(5.f, 0.5f));
+    }
+
+    float backward_euler_difference = 0.f;
+    float crank_nicolson_difference = 0.f;
+    const float* steady_state = explicit_simulation.state[(int)explicit_simulation.current_state];
+    for(int icell = 0; icell != width * height; ++icell){
+        if(explicit_simulation.source_sink[icell] == explicit_simulation.min_initial_max[DiffusionCPU::CLEAR]){
+            backward_euler_difference = std::max(backward_euler_difference,
+                std::abs(backward_euler.state[(int)backward_euler.current_state][icell] - steady_state[icell]));
+            crank_nicolson_difference = std::max(crank_nicolson_difference,
+                std::abs(crank_nicolson.state[(int)crank_nicolson.current_state][icell] - steady_state[icell]));
+        }
+    }
+
+    print("DiffusionCPU implicit steady state max difference backward Euler:", backward_euler_difference,
+        "Crank-Nicolson:", crank_nicolson_difference, "max V-cycles:", max_cycles);
+}
+
+void diffusion_cpu_activity(){
+
+    // step(R) with the activity tracking toggled during the run compared
+    // with step(R) without tracking, the tiles skipped with activity_epsilon
+    // = 0 are the ones that would not change so the states are the same
+    // The untracked steps spread the source over several small tiles before
+    // the tracking starts
+    constexpr int width = 150;
+    constexpr int height = 100;
+    constexpr float R = 0.35f;
+
+    DiffusionCPU reference(3);
+    DiffusionCPU tracked(3);
+    tracked.tile_width = 16;
+    tracked.tile_height = 8;
+    for(DiffusionCPU* simulation : {&reference, &tracked}){
+        simulation->start(width, height);
+        simulation->interaction(0.f, 0.f, 0.05f, DiffusionCPU::SOURCE);
+    }
+
+    for(int istep = 0; istep != 400; ++istep){
+        tracked.track_activity = istep >= 100 && (istep < 200 || istep >= 300);
+        if(istep == 250){
+            for(DiffusionCPU* simulation : {&reference, &tracked}){
+                simulation->interaction(-0.7f, -0.6f, 0.1f, DiffusionCPU::SINK);
+            }
+        }
+        reference.step(R);
+        tracked.step(R);
+    }
+
+    float max_difference = 0.f;
+    for(int icell = 0; icell != width * height; ++icell){
+        max_difference = std::max(max_difference, std::abs(tracked.state[(int)tracked.current_state][icell]
+            - reference.state[(int)reference.current_state][icell]));
+    }
+
+    print("DiffusionCPU activity tracking max difference:", max_difference);
+}
+
+void reaction_diffusion_cpu(){
+    constexpr int width = 45;
+    constexpr int height = 31;
+
+    ReactionDiffusionCPU simulation(3);
+    simulation.start(width, height);
+    simulation.point(0.2f, 0.1f, 0.3f, 0.f, 1.f);
+    simulation.square(-0.9f, -0.8f, 0.3f, 1.f, 0.f);
+
+    // scalar version of ReactionDiffusion::code_step_forward with clamped texel fetches
+    std::vector<float> state(2 * width * height);
+    std::vector<float> next(2 * width * height);
+    simulation.get_state(state.data());
+
+    auto get_value = [&](int x, int y, const int channel){
+        x = std::min(std::max(x, 0), width - 1);
+        y = std::min(std::max(y, 0), height - 1);
+        return state[2 * (y * width + x) + channel];
+    };
+
+    for(int istep = 0; istep != 200; ++istep){
+        for(int y = 0; y != height; ++y){
+            for(int x = 0; x != width; ++x){
+                for(int channel = 0; channel != 2; ++channel){
+                    const float current_value = get_value(x, y, channel);
+                    const float laplacian = (1.f / 6.f) *
+                        (4.f * (get_value(x + 1, y, channel) + get_value(x - 1, y, channel)
+                            + get_value(x, y + 1, channel) + get_value(x, y - 1, channel))
+                        + get_value(x - 1, y - 1, channel) + get_value(x + 1, y - 1, channel)
+                        + get_value(x - 1, y + 1, channel) + get_value(x + 1, y + 1, channel)
+                        - 20.f * current_value);
+                    next[2 * (y * width + x) + channel] = current_value
+                        + (channel == 0 ? simulation.sim_Ru : simulation.sim_Rv) * laplacian;
+                }
+
+                const float u = get_value(x, y, 0);
+                const float v = get_value(x, y, 1);
+                next[2 * (y * width + x)] += - u * v * v + simulation.sim_F * (1.f - u);
+                next[2 * (y * width + x) + 1] += u * v * v - (simulation.sim_F + simulation.sim_R) * v;
+            }
+        }
+        state.swap(next);
+
+        simulation.step();
+    }
+
+    std::vector<float> simulation_state(2 * width * height);
+    simulation.get_state(simulation_state.data());
+
+    float max_difference = 0.f;
+    for(int ivalue = 0; ivalue != 2 * width * height; ++ivalue){
+        max_difference = std::max(max_difference, std::abs(state[ivalue] - simulation_state[ivalue]));
+    }
+
+    print("ReactionDiffusionCPU max difference with the reference:", max_difference);
+}
+
+void reaction_diffusion_batch(){
+    constexpr int width = 37;
+    constexpr int height = 29;
+    constexpr int instances = 5;
+
+    ReactionDiffusionBatch batch(3);
+    batch.start(width, height, instances);
+
+    // the instance i uses the same parameters as the simulation i
+    std::vector<ReactionDiffusionCPU> simulations(instances);
+    for(int instance = 0; instance != instances; ++instance){
+        ReactionDiffusionCPU& simulation = simulations[instance];
+        simulation.default_value_u = batch.default_value_u;
+        simulation.default_value_v = batch.default_value_v;
+        simulation.sim_F = 0.02f + 0.01f * instance;
+        simulation.sim_R = 0.06f;
+        simulation.start(width, height);
+        simulation.square(0.f, 0.f, batch.seed_size, batch.seed_value_u, batch.seed_value_v);
+
+        batch.set_parameters(instance, simulation.sim_F, simulation.sim_R);
+        batch.reset(instance);
+    }
+
+    batch.step(7);
+    batch.step(10);
+
+    float max_difference = 0.f;
+    for(int instance = 0; instance != instances; ++instance){
+        ReactionDiffusionCPU& simulation = simulations[instance];
+        for(int istep = 0; istep != 17; ++istep){
+            simulation.step();
+        }
+
+        for(int y = 0; y != height; ++y){
+            for(int x = 0; x != width; ++x){
+                const int batch_index = (y + 1) * batch.pitch + x + 1;
+                const int simulation_index = simulation.cell_index(x, y);
+                max_difference = std::max(max_difference, std::abs(batch.instance_u(instance)[batch_index]
+                            - simulation.state_u[(int)simulation.current_state][simulation_index]));
+                max_difference = std::max(max_difference, std::abs(batch.instance_v(instance)[batch_index]
+                            - simulation.state_v[(int)simulation.current_state][simulation_index]));
+            }
+        }
+    }
+
+    print("ReactionDiffusionBatch max difference with ReactionDiffusionCPU:", max_difference);
+}
+
+void hex_reaction_diffusion_cpu(){
+
+    // scalar reference through the cube coordinates of the cells, a missing
+    // neighbor replicating the cell
+    auto compare = [](HexReactionDiffusionCPU& simulation, const int number_of_steps){
+        const HexGrid<float>& grid = simulation.grid;
+        const unsigned int cells = grid.number_of_cells;
+
+        std::vector<float> state(2 * cells);
+        std::vector<float> next(2 * cells);
+        simulation.get_state(state.data());
+
+        for(int istep = 0; istep != number_of_steps; ++istep){
+            for(unsigned int icell = 0; icell != cells; ++icell){
+                const glm::ivec3 cube_coord = grid.cell_coord(icell);
+
+                for(int channel = 0; channel != 2; ++channel){
+                    const float current_value = state[2 * icell + channel];
+
+                    float sum = 0.f;
+                    for(int ineighbor = 0; ineighbor != 6; ++ineighbor){
+                        const int neighbor = grid.cell_index(cube_coord + neighbor_coord[ineighbor]);
+                        sum += neighbor == -1 ? current_value : state[2 * neighbor + channel];
+                    }
+                    next[2 * icell + channel] = current_value
+                        + (channel == 0 ? simulation.sim_Ru : simulation.sim_Rv) * (2.f / 3.f) * (sum - 6.f * current_value);
+                }
+
+                const float u = state[2 * icell];
+                const float v = state[2 * icell + 1];
+                next[2 * icell] += - u * v * v + simulation.sim_F * (1.f - u);
+                next[2 * icell + 1] += u * v * v - (simulation.sim_F + simulation.sim_R) * v;
+            }
+            state.swap(next);
+
+            simulation.step();
+        }
+
+        std::vector<float> simulation_state(2 * cells);
+        simulation.get_state(simulation_state.data());
+
+        float max_difference = 0.f;
+        for(unsigned int ivalue = 0; ivalue != 2 * cells; ++ivalue){
+            max_difference = std::max(max_difference, std::abs(state[ivalue] - simulation_state[ivalue]));
+        }
+        return max_difference;
+    };
+
+    HexReactionDiffusionCPU scanline(3);
+    scanline.start(45, 31);
+    scanline.point(glm::ivec3(20, -5, -15), 6, 0.f, 1.f);
+    scanline.point(glm::ivec3(2, 1, -3), 4, 1.f, 0.f);
+    print("HexReactionDiffusionCPU scanline max difference with the reference:", compare(scanline, 200));
+
+    HexReactionDiffusionCPU layered(3);
+    layered.start_layered(20);
+    layered.point(glm::ivec3(3, -1, -2), 5, 0.f, 1.f);
+    print("HexReactionDiffusionCPU layered max difference with the reference:", compare(layered, 200));
+
+    // the clamped borders have no flux so the diffusion keeps the total of u
+    // and the field tends to a constant
+    HexReactionDiffusionCPU diffusion(3);
+    diffusion.start(64, 48);
+    diffusion.default_value_u = 0.f;
+    diffusion.reset();
+    diffusion.point(glm::ivec3(10, -2, -8), 3, 1.f, 0.f);
+
+    auto total_u = [&](){
+        double total = 0.;
+        for(unsigned int icell = 0; icell != diffusion.grid.number_of_cells; ++icell){
+            total += diffusion.state_u[(int)diffusion.current_state][icell];
+        }
+        return total;
+    };
+
+    const double initial_total = total_u();
+    for(int istep = 0; istep != 20000; ++istep){
+        diffusion.step_diffusion(0.2f);
+    }
+
+    const float* final_u = diffusion.state_u[(int)diffusion.current_state];
+    const auto minmax = std::minmax_element(final_u, final_u + diffusion.grid.number_of_cells);
+    print("HexReactionDiffusionCPU diffusion relative mass change:", std::abs(total_u() - initial_total) / initial_total,
+        "spread:", *minmax.second - *minmax.first);
+}
+
+// Squared distances of the trees, computed with vector instructions, can
+// differ from the reference by the contractions (fma) of the compiler
+static bool same_distance(const float A, const float B){
+    return std::abs(A - B) <= 1e-6f;
+}
+
+// Point in [0;1]^3
+static glm::vec3 random_point(){
+    const float x = rand_normalized();
+    const float y = rand_normalized();
+    return glm::vec3(x, y, rand_normalized());
+}
+
+void flat_kdtree(){
+
+    // nearest point, knn, radius and batch queries compared with a linear
+    // search, including duplicated points and trees with a single leaf
+
+    auto check_tree = [&](const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& queries){
+        FlatKDTree tree;
+        tree.build(points.data(), points.size());
+
+        bool valid = true;
+        for(const glm::vec3& query : queries){
+            float best_distance = INFINITY;
+            for(const glm::vec3& point : points){
+                const glm::vec3 difference = point - query;
+                best_distance = std::min(best_distance, difference.x * difference.x
+                    + difference.y * difference.y + difference.z * difference.z);
+            }
+
+            float distance;
+            const uint32_t inearest = tree.nearest(query, &distance);
+            if(points.empty()){
+                valid = valid && inearest == FlatKDTree::invalid_index;
+            }else{
+                const glm::vec3 difference = points[inearest] - query;
+                valid = valid && same_distance(distance, best_distance) && same_distance(distance,
+                    difference.x * difference.x + difference.y * difference.y + difference.z * difference.z);
+            }
+
+            // the k nearest and the points within the radius are the ones of
+            // the sorted distances of all the points
+            std::vector<float> distances;
+            for(const glm::vec3& point : points){
+                const glm::vec3 difference = point - query;
+                distances.push_back(difference.x * difference.x + difference.y * difference.y
+                    + difference.z * difference.z);
+            }
+            std::sort(distances.begin(), distances.end());
+
+            constexpr unsigned int k = 10;
+            FlatKDTree::Neighbor neighbors[k];
+            const unsigned int number_of_neighbors = tree.knn(query, k, neighbors);
+            valid = valid && number_of_neighbors == std::min(k, (unsigned int)points.size());
+            for(unsigned int ineighbor = 0; ineighbor != number_of_neighbors; ++ineighbor){
+                valid = valid && same_distance(neighbors[ineighbor].squared_distance, distances[ineighbor]);
+            }
+
+            constexpr float radius = 0.08f;
+            std::vector<uint32_t> within_radius;
+            tree.radius(query, radius, [&](const uint32_t index, const float squared_distance){
+                const glm::vec3 difference = points[index] - query;
+                valid = valid && squared_distance <= radius * radius && same_distance(squared_distance,
+                    difference.x * difference.x + difference.y * difference.y + difference.z * difference.z);
+                within_radius.push_back(index);
+            });
+            std::sort(within_radius.begin(), within_radius.end());
+            const size_t min_within_radius = std::lower_bound(distances.begin(), distances.end(),
+                radius * radius - 1e-6f) - distances.begin();
+            const size_t max_within_radius = std::upper_bound(distances.begin(), distances.end(),
+                radius * radius + 1e-6f) - distances.begin();
+            valid = valid && std::unique(within_radius.begin(), within_radius.end()) == within_radius.end()
+                && within_radius.size() >= min_within_radius && within_radius.size() <= max_within_radius;
+        }
+
+        std::vector<uint32_t> batch_indices(queries.size());
+        std::vector<float> batch_distances(queries.size());
+        tree.nearest_batch(queries.data(), queries.size(), batch_indices.data(), batch_distances.data());
+        for(unsigned int iquery = 0; iquery != queries.size(); ++iquery){
+            float distance;
+            valid = valid && batch_indices[iquery] == tree.nearest(queries[iquery], &distance)
+                && batch_distances[iquery] == distance;
+        }
+
+        return valid;
+    };
+
+    std::vector<glm::vec3> queries(1000);
+    for(glm::vec3& query : queries){
+        query = random_point() * 1.2f - 0.1f;
+    }
+
+    for(const unsigned int number_of_points : {0u, 1u, 7u, 16u, 17u, 1000u, 20000u}){
+        std::vector<glm::vec3> points(number_of_points);
+        for(glm::vec3& point : points){
+            point = glm::vec3(rand_normalized(), rand_normalized(), 0.1f * rand_normalized());
+        }
+
+        print("FlatKDTree", number_of_points, "points:", check_tree(points, queries));
+    }
+
+    std::vector<glm::vec3> duplicates(5000);
+    for(unsigned int ipoint = 0; ipoint != duplicates.size(); ++ipoint){
+        duplicates[ipoint] = glm::vec3((float)(ipoint % 7) / 7.f, 0.5f, (float)(ipoint % 3) / 3.f);
+    }
+    print("FlatKDTree duplicated points:", check_tree(duplicates, queries));
+
+    // the points equal to a split can be on either side so the leaves are
+    // checked against the splits of their ancestors
+    // Without equal coordinates the medians are order statistics ie the
+    // parallel build has the same nodes as the sequential one
+    WorkStealingPool thread_pool(3);
+    auto check_parallel_build = [&](const std::vector<glm::vec3>& points, const bool distinct){
+        FlatKDTree tree;
+        tree.build(points.data(), points.size());
+        FlatKDTree parallel_tree;
+        parallel_tree.build(points.data(), points.size(), &thread_pool);
+
+        bool valid = tree.number_of_nodes == parallel_tree.number_of_nodes
+            && tree.number_of_blocks == parallel_tree.number_of_blocks;
+        for(unsigned int inode = 0; valid && distinct && inode != tree.number_of_nodes; ++inode){
+            valid = tree.nodes[inode].split == parallel_tree.nodes[inode].split
+                && tree.nodes[inode].dimension == parallel_tree.nodes[inode].dimension;
+        }
+        valid = valid && std::equal(tree.leaf_offsets, tree.leaf_offsets + tree.number_of_leaves + 1,
+            parallel_tree.leaf_offsets);
+
+        std::vector<int> point_count(points.size(), 0);
+        for(unsigned int ileaf = 0; valid && ileaf != parallel_tree.number_of_leaves; ++ileaf){
+            for(uint32_t iblock = parallel_tree.leaf_offsets[ileaf]; iblock != parallel_tree.leaf_offsets[ileaf + 1]; ++iblock){
+                for(const uint32_t index : parallel_tree.blocks[iblock].index){
+                    if(index == FlatKDTree::invalid_index){
+                        continue;
+                    }
+                    ++point_count[index];
+
+                    for(uint32_t inode = parallel_tree.number_of_nodes + ileaf; inode != 0; inode = (inode - 1) / 2){
+                        const FlatKDTree::Node& parent = parallel_tree.nodes[(inode - 1) / 2];
+                        const float coordinate = points[index][parent.dimension];
+                        valid = valid && (inode % 2 ? coordinate <= parent.split : coordinate >= parent.split);
+                    }
+                }
+            }
+        }
+        return valid && std::all_of(point_count.begin(), point_count.end(), [](const int count){ return count == 1; });
+    };
+
+    std::vector<glm::vec3> large(300000);
+    for(unsigned int ipoint = 0; ipoint != large.size(); ++ipoint){
+        large[ipoint] = glm::vec3((float)((ipoint * 7919u) % large.size()),
+            (float)((ipoint * 104729u) % large.size()), (float)((ipoint * 7u) % large.size())) / (float)large.size();
+    }
+    print("FlatKDTree parallel build:", check_parallel_build(large, true));
+
+    for(glm::vec3& point : large){
+        point = glm::vec3(rand_normalized(), 2.f * rand_normalized(), (float)(rand() % 5));
+    }
+    print("FlatKDTree parallel build of equal coordinates:", check_parallel_build(large, false));
+
+    std::fill(large.begin(), large.end(), glm::vec3(1.f, 2.f, 3.f));
+    print("FlatKDTree parallel build of identical points:", check_parallel_build(large, false));
+
+    // the mapped tree answers the same queries as the tree that was written,
+    // files of another format or truncated are rejected
+    std::vector<glm::vec3> file_points(20000);
+    for(glm::vec3& point : file_points){
+        point = random_point();
+    }
+    FlatKDTree file_tree;
+    file_tree.build(file_points.data(), file_points.size());
+
+    const char* path = "test_flat_kdtree.bin";
+    const bool written = file_tree.write(path);
+
+    FlatKDTree mapped_tree;
+    bool mapped = mapped_tree.map(path) && mapped_tree.storage == nullptr
+        && mapped_tree.number_of_points == file_tree.number_of_points;
+    for(const glm::vec3& query : queries){
+        float distance;
+        float mapped_distance;
+        mapped = mapped && file_tree.nearest(query, &distance) == mapped_tree.nearest(query, &mapped_distance)
+            && distance == mapped_distance;
+    }
+
+    // a mapped tree can be written to another file
+    const char* copy_path = "test_flat_kdtree_copy.bin";
+    FlatKDTree copy_tree;
+    const bool rewritten = mapped_tree.write(copy_path) && copy_tree.map(copy_path)
+        && copy_tree.nearest(queries[0]) == file_tree.nearest(queries[0]);
+    copy_tree.clear();
+    std::remove(copy_path);
+
+    std::ofstream(path, std::ios::binary) << "FKDTREE but not a tree";
+    const bool rejected = !mapped_tree.map(path) && !mapped_tree.map("missing_flat_kdtree.bin")
+        && mapped_tree.number_of_points == 0;
+    std::remove(path);
+
+    print("FlatKDTree file written", written, "mapped", mapped, "rewritten", rewritten, "rejected", rejected);
+}
+
+void dynamic_kdtree(){
+
+    // random inserts, erases, small and large moves compared with a linear
+    // search over the points alive, with a small buffer and growth so that
+    // the merges go through several levels
+    auto squared_length = [](const glm::vec3 vector){
+        return vector.x * vector.x + vector.y * vector.y + vector.z * vector.z;
+    };
+
+    WorkStealingPool pool(2);
+    DynamicKDTree tree;
+    tree.buffer_capacity = 16;
+    tree.growth = 3;
+    tree.thread_pool = &pool;
+
+    std::vector<glm::vec3> initial_points(500);
+    for(glm::vec3& point : initial_points){
+        point = random_point();
+    }
+    tree.build(initial_points.data(), initial_points.size());
+
+    // position of each id, alive or not
+    std::vector<glm::vec3> positions = initial_points;
+    std::vector<bool> alive(positions.size(), true);
+
+    bool valid = true;
+    for(int istep = 0; istep != 20000; ++istep){
+        const float operation = rand_normalized();
+        const uint32_t id = (uint32_t)(rand() % positions.size());
+
+        if(operation < 0.3f){
+            const glm::vec3 point = random_point();
+            const uint32_t new_id = tree.insert(point);
+            if(new_id >= positions.size()){
+                positions.resize(new_id + 1);
+                alive.resize(new_id + 1, false);
+            }
+            valid = valid && !alive[new_id];
+            positions[new_id] = point;
+            alive[new_id] = true;
+        }else if(!alive[id]){
+            continue;
+        }else if(operation < 0.5f){
+            tree.erase(id);
+            alive[id] = false;
+        }else if(operation < 0.9f){
+            positions[id] = glm::clamp(positions[id] + 0.01f * (random_point() - 0.5f), 0.f, 1.f);
+            tree.move(id, positions[id]);
+        }else{
+            positions[id] = random_point();
+            tree.move(id, positions[id]);
+        }
+
+        if(istep % 50){
+            continue;
+        }
+
+        unsigned int number_of_points = 0;
+        for(uint32_t ipoint = 0; ipoint != positions.size(); ++ipoint){
+            if(alive[ipoint]){
+                ++number_of_points;
+                valid = valid && tree.position(ipoint) == positions[ipoint];
+            }
+        }
+        valid = valid && tree.number_of_points == number_of_points;
+
+        const glm::vec3 query = random_point();
+        constexpr float radius = 0.1f;
+        float best_distance = INFINITY;
+        unsigned int radius_count = 0;
+        for(uint32_t ipoint = 0; ipoint != positions.size(); ++ipoint){
+            if(alive[ipoint]){
+                const float distance = squared_length(positions[ipoint] - query);
+                best_distance = std::min(best_distance, distance);
+                radius_count += distance <= radius * radius;
+            }
+        }
+
+        float distance;
+        const uint32_t inearest = tree.nearest(query, &distance);
+        valid = valid && inearest < positions.size() && alive[inearest] && same_distance(distance, best_distance)
+            && same_distance(distance, squared_length(positions[inearest] - query));
+
+        unsigned int found = 0;
+        tree.radius(query, radius, [&](const uint32_t index, const float squared_distance){
+            valid = valid && index < positions.size() && alive[index]
+                && same_distance(squared_distance, squared_length(positions[index] - query));
+            ++found;
+        });
+        valid = valid && found == radius_count;
+    }
+
+    unsigned int used_levels = 0;
+    for(unsigned int ilevel = 0; ilevel != DynamicKDTree::max_levels; ++ilevel){
+        used_levels += tree.level_points[ilevel] != 0;
+    }
+
+    // a rebuild keeps the ids and leaves a single level
+    tree.rebuild();
+    unsigned int rebuilt_levels = 0;
+    for(unsigned int ilevel = 0; ilevel != DynamicKDTree::max_levels; ++ilevel){
+        rebuilt_levels += tree.level_points[ilevel] != 0;
+    }
+    for(uint32_t ipoint = 0; ipoint != positions.size(); ++ipoint){
+        if(alive[ipoint]){
+            float distance;
+            valid = valid && tree.nearest(positions[ipoint], &distance) != DynamicKDTree::invalid_index
+                && distance == 0.f && tree.position(ipoint) == positions[ipoint];
+        }
+    }
+
+    print("DynamicKDTree correct:", valid, "points", tree.number_of_points, "levels", used_levels,
+        "levels after rebuild", rebuilt_levels, "buffer", tree.buffer_size);
+}
+
+void particles_cpu(){
+    constexpr int particles = 2000;
+    constexpr float radius = 0.07f;
+    constexpr float delta_time = 0.1f;
+
+    ParticlesCPU simulation(3);
+    simulation.neighbor_radius = radius;
+    simulation.chunk_size = 128;
+    simulation.start(particles);
+    simulation.step(delta_time);
+
+    std::vector<ParticlesCPU::ParticleData> data(particles);
+    simulation.get_state(data.data());
+
+    // periodic difference b - a within [-1;1[
+    auto periodic_difference = [](const float a, const float b){
+        const float difference = b - a;
+        return difference - 2.f * std::floor((difference + 1.f) * 0.5f);
+    };
+
+    // ---- Neighbors within radius found with the cell list and by brute force ---- //
+
+    const ParticlesCPU::State& current = simulation.state[(int)simulation.current_state];
+    simulation.cell_list.build(current.position_x, current.position_y, particles, 1);
+
+    int missing_neighbors = 0;
+    int total_neighbors = 0;
+    for(int ipart = 0; ipart != particles; ++ipart){
+        auto is_neighbor = [&](const int ineighbor){
+            const float offset_x = periodic_difference(current.position_x[ipart], current.position_x[ineighbor]);
+            const float offset_y = periodic_difference(current.position_y[ipart], current.position_y[ineighbor]);
+            return offset_x * offset_x + offset_y * offset_y < radius * radius;
+        };
+
+        int brute_force_neighbors = 0;
+        for(int ineighbor = 0; ineighbor != particles; ++ineighbor){
+            brute_force_neighbors += is_neighbor(ineighbor);
+        }
+
+        int cell_list_neighbors = 0;
+        simulation.cell_list.for_each_candidate(current.position_x[ipart], current.position_y[ipart], [&](const int ineighbor){
+            cell_list_neighbors += is_neighbor(ineighbor);
+        });
+
+        missing_neighbors += std::abs(brute_force_neighbors - cell_list_neighbors);
+        total_neighbors += brute_force_neighbors;
+    }
+
+    print("CellList missing neighbors:", missing_neighbors, "of", total_neighbors);
+
+    // ---- Step compared to a brute force step ---- //
+
+    std::vector<ParticlesCPU::ParticleData> next(data);
+    for(int ipart = 0; ipart != particles; ++ipart){
+        const ParticlesCPU::ParticleData& particle = data[ipart];
+        ParticlesCPU::ParticleData& next_particle = next[ipart];
+
+        float sums[6] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+        int neighbors = 0;
+        for(int ineighbor = 0; ineighbor != particles; ++ineighbor){
+            const float offset_x = periodic_difference(particle.position_x, data[ineighbor].position_x);
+            const float offset_y = periodic_difference(particle.position_y, data[ineighbor].position_y);
+            const float squared_distance = offset_x * offset_x + offset_y * offset_y;
+            if(ineighbor != ipart && squared_distance < radius * radius){
+                sums[0] += offset_x;
+                sums[1] += offset_y;
+                sums[2] += data[ineighbor].velocity_x;
+                sums[3] += data[ineighbor].velocity_y;
+                ++neighbors;
+                if(squared_distance < simulation.repulsion_radius * simulation.repulsion_radius){
+                    sums[4] -= offset_x;
+                    sums[5] -= offset_y;
+                }
+            }
+        }
+
+        if(neighbors){
+            next_particle.velocity_x += sums[0] / neighbors * simulation.cohesion_factor
+                + (sums[2] / neighbors - particle.velocity_x) * simulation.alignment_factor + sums[4];
+            next_particle.velocity_y += sums[1] / neighbors * simulation.cohesion_factor
+                + (sums[3] / neighbors - particle.velocity_y) * simulation.alignment_factor + sums[5];
+        }
+
+        const float speed = std::sqrt(next_particle.velocity_x * next_particle.velocity_x
+                + next_particle.velocity_y * next_particle.velocity_y);
+        if(speed > simulation.max_speed){
+            next_particle.velocity_x *= simulation.max_speed / speed;
+            next_particle.velocity_y *= simulation.max_speed / speed;
+        }
+    }
+
+    simulation.step(delta_time);
+    simulation.get_state(data.data());
+
+    float max_difference = 0.f;
+    for(int ipart = 0; ipart != particles; ++ipart){
+        max_difference = std::max(max_difference, std::abs(next[ipart].velocity_x - data[ipart].velocity_x));
+        max_difference = std::max(max_difference, std::abs(next[ipart].velocity_y - data[ipart].velocity_y));
+    }
+
+    print("ParticlesCPU max velocity difference with the brute force step:", max_difference);
+}
+
+void work_stealing_pool(){
+    WorkStealingPool pool(4);
+
+    std::vector<int> values(100003, 0);
+    for(int irepeat = 0; irepeat != 10; ++irepeat){
+        pool.parallel_for(0, (int)values.size(), 1000, [&values](const int begin, const int end){
+            for(int ivalue = begin; ivalue != end; ++ivalue){
+                ++values[ivalue];
+            }
+        });
+    }
+
+    // parallel_for called from the tasks of a parallel_for
+    std::atomic<int> nested_count(0);
+    pool.parallel_for(0, 16, 1, [&pool, &nested_count](const int begin, const int end){
+        for(int index = begin; index != end; ++index){
+            pool.parallel_for(0, 1000, 10, [&nested_count](const int nested_begin, const int nested_end){
+                nested_count += nested_end - nested_begin;
+            });
+        }
+    });
+
+    print("WorkStealingPool parallel_for correct:",
+            std::all_of(values.begin(), values.end(), [](const int value){ return value == 10; }),
+            nested_count.load() == 16 * 1000);
+}
+
 int main(){
 
     memory_allocator();
+    memory_pool_growable();
+    linear_allocator();
+    free_list();
+    virtual_arena();
+    memory_statistics();
+    concurrent_memory_pool();
+    hexgrid();
+    flat_kdtree();
+    dynamic_kdtree();
+    size_class_allocator();
+    diffusion_cpu();
+    diffusion_cpu_fused();
+    diffusion_cpu_implicit();
+    diffusion_cpu_activity();
+    reaction_diffusion_cpu();
+    reaction_diffusion_batch();
+    hex_reaction_diffusion_cpu();
+    particles_cpu();
+    work_stealing_pool();
 
 }
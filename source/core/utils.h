@@ -4,7 +4,10 @@
 #include <string>
 #include <iostream>
 
+// the value of <cmath> when it is included first
+#ifndef M_PI
 #define M_PI 3.14
+#endif
 #define NO_MIN
 
 // ---- C Random numbers ---- //
@@ -0,0 +1,93 @@
+#ifndef H_CONCURRENTMEMORYPOOL
+#define H_CONCURRENTMEMORYPOOL
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+// MemoryPool that can be used by several threads at once
+// Each thread takes and returns its blocks through its own Cache, which
+// exchanges batches of /batch_size/ blocks with a lock-free global list ie
+// most get / give only touch the cache of the thread
+// The global list is a stack of batches whose head is tagged with a counter
+// incremented by every update so that a head popped and pushed back between
+// the read and the compare-exchange of another thread is detected (ABA)
+//
+// ex:
+// ConcurrentMemoryPool<sizeof(Particle)> pool;
+// pool.allocate(1 << 20);
+// // on each thread
+// ConcurrentMemoryPool<sizeof(Particle)>::Cache cache(pool);
+// Particle* particle = cache.get<Particle>();
+// cache.give(particle);
+template<size_t block_size, size_t batch_size = 32>
+struct ConcurrentMemoryPool{
+
+    // ---- Constructor ---- //
+
+    ConcurrentMemoryPool();
+    ~ConcurrentMemoryPool();
+
+    // ---- Allocation ---- //
+
+    // Not thread safe ie must not be called while blocks are in use
+    void allocate(const size_t blocks);
+    void deallocate();
+
+    // ---- Block get / give ---- //
+
+    // Blocks owned by a thread, must be destroyed before the pool
+    struct Cache{
+        Cache(ConcurrentMemoryPool& cache_pool);
+        ~Cache();
+
+        // Same as MemoryPool::get and MemoryPool::give
+        // Returns nullptr when there are no blocks available in the cache
+        // and in the global list
+        template<typename T, typename ... ConstructorArguments>
+        T* get(const ConstructorArguments& ... arguments);
+
+        template<typename T>
+        void give(T* ptr);
+
+        ConcurrentMemoryPool& pool;
+        uint32_t first_block = 0; // index + 1 of the first block, 0 when empty
+        size_t cached_blocks = 0;
+    };
+
+    // Pops a batch from the global list and returns the index + 1 of its
+    // first block, 0 when the list is empty
+    uint32_t pop_batch();
+
+    // Pushes the blocks linked from first_block as a batch
+    void push_batch(const uint32_t first_block);
+
+    // ---- Data ---- //
+
+    // /next/ links the blocks of a batch and /next_batch/ the batches of the
+    // global list, both as index + 1 with 0 as the end of the list
+    // /next_batch/ is atomic because pop_batch reads it while the thread that
+    // popped the same batch first can push it again
+    union MemoryBlock{
+        char data[block_size];
+        struct{
+            uint32_t next;
+            std::atomic<uint32_t> next_batch;
+        } link;
+        void* alignment;
+    };
+
+    MemoryBlock* block(const uint32_t index_plus_one);
+    uint32_t block_index(const void* ptr) const;
+
+    void* memory = nullptr;
+    size_t memory_blocks = 0;
+
+    // tag in the high 32 bits and index + 1 of the first block of the first
+    // batch in the low 32 bits
+    alignas(64) std::atomic<uint64_t> global_head{0};
+};
+
+#include "ConcurrentMemoryPool.inl"
+
+#endif
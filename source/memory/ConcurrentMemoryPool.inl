@@ -0,0 +1,183 @@
+#ifndef INL_CONCURRENTMEMORYPOOL
+#define INL_CONCURRENTMEMORYPOOL
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+template<size_t block_size, size_t batch_size>
+ConcurrentMemoryPool<block_size, batch_size>::ConcurrentMemoryPool(){
+}
+
+template<size_t block_size, size_t batch_size>
+ConcurrentMemoryPool<block_size, batch_size>::~ConcurrentMemoryPool(){
+    free(memory);
+}
+
+template<size_t block_size, size_t batch_size>
+void ConcurrentMemoryPool<block_size, batch_size>::allocate(const size_t blocks){
+
+    assert(blocks < UINT32_MAX);
+
+    free(memory);
+    memory = malloc(blocks * sizeof(MemoryBlock));
+    memory_blocks = blocks;
+    global_head.store(0, std::memory_order_relaxed);
+
+    // batches of consecutive blocks
+    for(size_t batch_begin = 0; batch_begin < blocks; batch_begin += batch_size){
+        const size_t batch_end = std::min(batch_begin + batch_size, blocks);
+
+        for(size_t iblock = batch_begin; iblock != batch_end; ++iblock){
+            block(iblock + 1)->link.next = (iblock + 1 == batch_end) ? 0 : iblock + 2;
+        }
+
+        push_batch(batch_begin + 1);
+    }
+}
+
+template<size_t block_size, size_t batch_size>
+void ConcurrentMemoryPool<block_size, batch_size>::deallocate(){
+    free(memory);
+    memory = nullptr;
+    memory_blocks = 0;
+    global_head.store(0, std::memory_order_relaxed);
+}
+
+template<size_t block_size, size_t batch_size>
+uint32_t ConcurrentMemoryPool<block_size, batch_size>::pop_batch(){
+
+    uint64_t head = global_head.load(std::memory_order_acquire);
+
+    while(true){
+        const uint32_t first_block = (uint32_t)head;
+        if(!first_block){
+            return 0;
+        }
+
+        // /next_batch/ may be overwritten by the thread that popped this batch
+        // in the meantime but then the tag has changed and the exchange fails
+        const uint32_t next_batch = block(first_block)->link.next_batch.load(std::memory_order_relaxed);
+        const uint64_t new_head = ((head >> 32) + 1) << 32 | next_batch;
+
+        if(global_head.compare_exchange_weak(head, new_head,
+                    std::memory_order_acquire, std::memory_order_acquire)){
+            return first_block;
+        }
+    }
+}
+
+template<size_t block_size, size_t batch_size>
+void ConcurrentMemoryPool<block_size, batch_size>::push_batch(const uint32_t first_block){
+
+    uint64_t head = global_head.load(std::memory_order_relaxed);
+
+    while(true){
+        block(first_block)->link.next_batch.store((uint32_t)head, std::memory_order_relaxed);
+        const uint64_t new_head = ((head >> 32) + 1) << 32 | first_block;
+
+        if(global_head.compare_exchange_weak(head, new_head,
+                    std::memory_order_release, std::memory_order_relaxed)){
+            return;
+        }
+    }
+}
+
+template<size_t block_size, size_t batch_size>
+typename ConcurrentMemoryPool<block_size, batch_size>::MemoryBlock*
+ConcurrentMemoryPool<block_size, batch_size>::block(const uint32_t index_plus_one){
+    return (MemoryBlock*)memory + (index_plus_one - 1);
+}
+
+template<size_t block_size, size_t batch_size>
+uint32_t ConcurrentMemoryPool<block_size, batch_size>::block_index(const void* ptr) const{
+    return (uint32_t)((const MemoryBlock*)ptr - (const MemoryBlock*)memory) + 1;
+}
+
+// ---- Cache ---- //
+
+template<size_t block_size, size_t batch_size>
+ConcurrentMemoryPool<block_size, batch_size>::Cache::Cache(ConcurrentMemoryPool& cache_pool)
+    : pool(cache_pool){
+}
+
+template<size_t block_size, size_t batch_size>
+ConcurrentMemoryPool<block_size, batch_size>::Cache::~Cache(){
+
+    // the remaining blocks are returned as batches of at most batch_size blocks
+    while(first_block){
+        const uint32_t batch_first = first_block;
+        uint32_t batch_last = first_block;
+        for(size_t iblock = 1; iblock != batch_size && pool.block(batch_last)->link.next; ++iblock){
+            batch_last = pool.block(batch_last)->link.next;
+        }
+
+        first_block = pool.block(batch_last)->link.next;
+        pool.block(batch_last)->link.next = 0;
+        pool.push_batch(batch_first);
+    }
+    cached_blocks = 0;
+}
+
+template<size_t block_size, size_t batch_size>
+template<typename T, typename ... ConstructorArguments>
+T* ConcurrentMemoryPool<block_size, batch_size>::Cache::get(const ConstructorArguments& ... arguments){
+
+    static_assert(sizeof(T) <= block_size && (sizeof(MemoryBlock) % alignof(T)) == 0,
+                "The alignment of T is not compatible with the block_size of the ConcurrentMemoryPool");
+
+    if(!first_block){
+        first_block = pool.pop_batch();
+        if(!first_block){
+            return nullptr;
+        }
+
+        // the last batch made by allocate can be smaller than batch_size
+        cached_blocks = 1;
+        for(uint32_t iblock = pool.block(first_block)->link.next; iblock; iblock = pool.block(iblock)->link.next){
+            ++cached_blocks;
+        }
+    }
+
+    MemoryBlock* placement_ptr = pool.block(first_block);
+    first_block = placement_ptr->link.next;
+    --cached_blocks;
+
+    return new (placement_ptr) T(arguments...);
+}
+
+template<size_t block_size, size_t batch_size>
+template<typename T>
+void ConcurrentMemoryPool<block_size, batch_size>::Cache::give(T* ptr){
+
+    if(!ptr){
+        return;
+    }
+
+    assert((void*)ptr >= pool.memory && (void*)ptr < (void*)((MemoryBlock*)(pool.memory) + pool.memory_blocks));
+
+    ptr->~T();
+
+    MemoryBlock* returned_block = (MemoryBlock*)ptr;
+    returned_block->link.next = first_block;
+    first_block = pool.block_index(ptr);
+    ++cached_blocks;
+
+    // keeps batch_size blocks in the cache and returns the others to the
+    // global list so that a thread alternating get and give stays local
+    if(cached_blocks == 2 * batch_size){
+        uint32_t batch_last = first_block;
+        for(size_t iblock = 1; iblock != batch_size; ++iblock){
+            batch_last = pool.block(batch_last)->link.next;
+        }
+
+        const uint32_t batch_first = first_block;
+        first_block = pool.block(batch_last)->link.next;
+        pool.block(batch_last)->link.next = 0;
+        pool.push_batch(batch_first);
+
+        cached_blocks = batch_size;
+    }
+}
+
+#endif
@@ -0,0 +1,288 @@
+#include "FreeList.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static_assert(offsetof(FreeList::BlockHeader, next_free) == FreeList::header_bytes,
+        "The payload of the FreeList blocks must start at next_free");
+
+// Index of the least / most significant set bit of /value/ != 0
+static int find_first_set(const uint32_t value){
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+static int find_last_set(const size_t value){
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 8 * sizeof(unsigned long long) - 1 - __builtin_clzll(value);
+#endif
+}
+
+FreeList::FreeList(){
+}
+
+FreeList::~FreeList(){
+    free(memory);
+}
+
+void FreeList::allocate(const size_t bytes){
+
+    assert(bytes < ((size_t)1 << 32));
+
+    free(memory);
+    memory = malloc(bytes);
+    memory_bytes = bytes;
+
+    reset();
+}
+
+void FreeList::deallocate(){
+    free(memory);
+    memory = nullptr;
+    memory_bytes = 0;
+
+    reset();
+}
+
+void FreeList::reset(){
+
+    first_level_bitmap = 0;
+    memset(second_level_bitmap, 0, sizeof(second_level_bitmap));
+    memset(free_blocks, 0, sizeof(free_blocks));
+
+    if(!memory){
+        return;
+    }
+
+    const uintptr_t begin = ((uintptr_t)memory + alignment_bytes - 1) & ~(uintptr_t)(alignment_bytes - 1);
+    const uintptr_t end = ((uintptr_t)memory + memory_bytes) & ~(uintptr_t)(alignment_bytes - 1);
+    if(end < begin + 2 * header_bytes + min_payload_bytes){
+        return;
+    }
+
+    // a single free block followed by a used block of size 0 that stops the
+    // merges at the end of the arena
+    BlockHeader* block = (BlockHeader*)begin;
+    block->previous_physical = nullptr;
+    block->size = (end - begin - 2 * header_bytes) | flag_free;
+
+    BlockHeader* sentinel = next_physical(block);
+    sentinel->previous_physical = block;
+    sentinel->size = flag_previous_free;
+
+    insert_free_block(block);
+}
+
+void* FreeList::get_bytes(const size_t bytes, const size_t alignment){
+
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+
+    size_t size = (bytes + alignment_bytes - 1) & ~(alignment_bytes - 1);
+    if(size < min_payload_bytes){
+        size = min_payload_bytes;
+    }
+
+    // the over-aligned blocks may need a free block before the aligned payload
+    const bool over_aligned = alignment > alignment_bytes;
+    const size_t search_size = over_aligned ? size + alignment + header_bytes + min_payload_bytes : size;
+
+    BlockHeader* block = take_free_block(search_size);
+    if(!block){
+#if defined(MEMORY_STATISTICS)
+        statistics->record_failed_get(bytes);
+#endif
+        return nullptr;
+    }
+
+    if(over_aligned){
+        char* aligned_payload = (char*)(((uintptr_t)payload(block) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        size_t gap = aligned_payload - payload(block);
+        if(gap && gap < header_bytes + min_payload_bytes){
+            aligned_payload += alignment;
+            gap += alignment;
+        }
+
+        if(gap){
+            BlockHeader* aligned_block = block_of(aligned_payload);
+            aligned_block->previous_physical = block;
+            aligned_block->size = (block_size(block) - gap) | flag_previous_free;
+            next_physical(aligned_block)->previous_physical = aligned_block;
+
+            block->size = (gap - header_bytes) | flag_free | (block->size & flag_previous_free);
+            insert_free_block(block);
+
+            block = aligned_block;
+        }
+    }
+
+    // the end of the block is returned to the free lists when it can hold a block
+    const size_t available = block_size(block);
+    if(available >= size + header_bytes + min_payload_bytes){
+        BlockHeader* remainder = (BlockHeader*)(payload(block) + size);
+        remainder->previous_physical = block;
+        remainder->size = (available - size - header_bytes) | flag_free;
+        next_physical(remainder)->previous_physical = remainder;
+        insert_free_block(remainder);
+
+        block->size = size | (block->size & flag_previous_free);
+    }
+
+    block->size &= ~flag_free;
+    next_physical(block)->size &= ~flag_previous_free;
+
+#if defined(MEMORY_STATISTICS)
+    statistics->record_get(block_size(block));
+#endif
+
+    return payload(block);
+}
+
+void FreeList::give_bytes(void* ptr){
+
+    if(!ptr){
+        return;
+    }
+
+    BlockHeader* block = block_of(ptr);
+    assert(!(block->size & flag_free));
+
+#if defined(MEMORY_STATISTICS)
+    statistics->record_give(block_size(block));
+#endif
+
+    if(block->size & flag_previous_free){
+        BlockHeader* previous = block->previous_physical;
+        remove_free_block(previous);
+        previous->size += block_size(block) + header_bytes;
+        block = previous;
+    }
+
+    BlockHeader* next = next_physical(block);
+    if(next->size & flag_free){
+        remove_free_block(next);
+        block->size += block_size(next) + header_bytes;
+    }
+
+    block->size |= flag_free;
+
+    next = next_physical(block);
+    next->previous_physical = block;
+    next->size |= flag_previous_free;
+
+    insert_free_block(block);
+}
+
+// ---- Blocks ---- //
+
+size_t FreeList::block_size(const BlockHeader* block){
+    return block->size & ~(flag_free | flag_previous_free);
+}
+
+char* FreeList::payload(BlockHeader* block){
+    return (char*)block + header_bytes;
+}
+
+FreeList::BlockHeader* FreeList::block_of(void* ptr){
+    return (BlockHeader*)((char*)ptr - header_bytes);
+}
+
+FreeList::BlockHeader* FreeList::next_physical(BlockHeader* block){
+    return (BlockHeader*)(payload(block) + block_size(block));
+}
+
+void FreeList::mapping(const size_t size, int& first_level, int& second_level){
+    if(size < ((size_t)1 << first_level_shift)){
+        first_level = 0;
+        second_level = (int)(size / alignment_bytes);
+    }else{
+        const int last_bit = find_last_set(size);
+        second_level = (int)(size >> (last_bit - second_level_log2)) ^ second_level_count;
+        first_level = last_bit - (first_level_shift - 1);
+    }
+}
+
+FreeList::BlockHeader* FreeList::take_free_block(const size_t size){
+
+    // rounds the size up to the next list so that any block of the list is large enough
+    size_t search_size = size;
+    if(search_size >= ((size_t)1 << first_level_shift)){
+        search_size += ((size_t)1 << (find_last_set(search_size) - second_level_log2)) - 1;
+    }
+
+    int first_level;
+    int second_level;
+    mapping(search_size, first_level, second_level);
+    if(first_level >= first_level_count){
+        return nullptr;
+    }
+
+    uint32_t second_level_map = second_level_bitmap[first_level] & (~0u << second_level);
+    if(!second_level_map){
+        const uint32_t first_level_map = (first_level + 1 < 32) ? first_level_bitmap & (~0u << (first_level + 1)) : 0u;
+        if(!first_level_map){
+            return nullptr;
+        }
+
+        first_level = find_first_set(first_level_map);
+        second_level_map = second_level_bitmap[first_level];
+    }
+    second_level = find_first_set(second_level_map);
+
+    BlockHeader* block = free_blocks[first_level][second_level];
+    remove_free_block(block);
+    return block;
+}
+
+void FreeList::insert_free_block(BlockHeader* block){
+
+    int first_level;
+    int second_level;
+    mapping(block_size(block), first_level, second_level);
+
+    BlockHeader* head = free_blocks[first_level][second_level];
+    block->next_free = head;
+    block->previous_free = nullptr;
+    if(head){
+        head->previous_free = block;
+    }
+    free_blocks[first_level][second_level] = block;
+
+    first_level_bitmap |= 1u << first_level;
+    second_level_bitmap[first_level] |= 1u << second_level;
+}
+
+void FreeList::remove_free_block(BlockHeader* block){
+
+    int first_level;
+    int second_level;
+    mapping(block_size(block), first_level, second_level);
+
+    if(block->next_free){
+        block->next_free->previous_free = block->previous_free;
+    }
+    if(block->previous_free){
+        block->previous_free->next_free = block->next_free;
+    }else{
+        free_blocks[first_level][second_level] = block->next_free;
+        if(!block->next_free){
+            second_level_bitmap[first_level] &= ~(1u << second_level);
+            if(!second_level_bitmap[first_level]){
+                first_level_bitmap &= ~(1u << first_level);
+            }
+        }
+    }
+}
@@ -1,35 +1,110 @@
-/*
+#ifndef H_FREELIST
+#define H_FREELIST
 
-#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
 
-struct FreeList{
+#if defined(MEMORY_STATISTICS)
+#include "MemoryStatistics.h"
+#endif
 
-    struct list_element{
-        list_element* next;
-        size_t size;
-    };
+// Variable size allocator over a fixed arena using a two-level segregated fit
+// (TLSF) ie the free blocks are stored in lists indexed by the power of two
+// of their size, subdivided in second_level_count linear classes
+// Bitmaps of the non-empty lists find a free block large enough with two bit
+// scans and the blocks store their size and a pointer to the previous block
+// in memory (boundary tags) so that a freed block is merged with its free
+// neighbors in constant time ie get and give run in O(1) with a bounded worst case
+//
+// ex:
+// FreeList free_list;
+// free_list.allocate(1 << 20);
+// Particle* particle = free_list.get<Particle>();
+// float* values = (float*)free_list.get_bytes(count * sizeof(float), alignof(float));
+// free_list.give(particle);
+// free_list.give_bytes(values);
+struct FreeList{
 
-    template<typename T>
-    union MemoryBlock{
-        T data;
-        list_element;
-    };
+    // ---- Constructor ---- //
 
     FreeList();
     ~FreeList();
 
-    void allocate(size_t bytes);
+    // ---- Allocation ---- //
+
+    // The arena must be smaller than 4 GB
+    void allocate(const size_t bytes);
     void deallocate();
 
-    template<typename T>
-    T* get();
+    // Releases every block ie the arena becomes a single free block
+    void reset();
+
+    // ---- Get / give ---- //
+
+    // Returns nullptr when there is no free block large enough
+    template<typename T, typename ... ConstructorArguments>
+    T* get(const ConstructorArguments& ... arguments);
 
     template<typename T>
     void give(T* ptr);
 
+    // /alignment/ must be a power of two, the alignments up to
+    // alignment_bytes do not use additional memory
+    void* get_bytes(const size_t bytes, const size_t alignment = alignment_bytes);
+    void give_bytes(void* ptr);
+
+    // ---- Blocks ---- //
+
+    // The payload of a block starts after /previous_physical/ and /size/
+    // /next_free/ and /previous_free/ are stored in the payload of the free blocks
+    struct BlockHeader{
+        BlockHeader* previous_physical;
+        size_t size; // bytes of the payload with the flags in the low bits
+        BlockHeader* next_free;
+        BlockHeader* previous_free;
+    };
+
+    // header_bytes is the offset of /next_free/ ie the layout of 64-bit platforms
+    static constexpr size_t alignment_bytes = 16;
+    static constexpr size_t header_bytes = 16;
+    static constexpr size_t min_payload_bytes = 16;
+    static constexpr size_t flag_free = 1;
+    static constexpr size_t flag_previous_free = 2;
+
+    // The blocks smaller than 2^first_level_shift bytes are all in the first
+    // level, each second level list covers alignment_bytes bytes
+    static constexpr int second_level_log2 = 4;
+    static constexpr int second_level_count = 1 << second_level_log2;
+    static constexpr int first_level_shift = 8;
+    static constexpr int first_level_count = 32 - first_level_shift + 1;
+
+    static size_t block_size(const BlockHeader* block);
+    static char* payload(BlockHeader* block);
+    static BlockHeader* block_of(void* ptr);
+    static BlockHeader* next_physical(BlockHeader* block);
+
+    // Lists of the blocks of /size/ bytes
+    static void mapping(const size_t size, int& first_level, int& second_level);
+
+    // Returns a free block of at least /size/ bytes, removed from its list
+    BlockHeader* take_free_block(const size_t size);
+    void insert_free_block(BlockHeader* block);
+    void remove_free_block(BlockHeader* block);
+
+    // ---- Data ---- //
+
     void* memory = nullptr;
-    list_element* current_block = nullptr;
-    int arena_bytes = 0;
+    size_t memory_bytes = 0;
+
+    uint32_t first_level_bitmap = 0;
+    uint32_t second_level_bitmap[first_level_count] = {};
+    BlockHeader* free_blocks[first_level_count][second_level_count] = {};
+
+#if defined(MEMORY_STATISTICS)
+    AllocatorStatistics* statistics = allocator_statistics("FreeList");
+#endif
 };
 
-*/
+#include "FreeList.inl"
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef INL_FREELIST
+#define INL_FREELIST
+
+#include <new>
+
+template<typename T, typename ... ConstructorArguments>
+T* FreeList::get(const ConstructorArguments& ... arguments){
+
+    void* placement_ptr = get_bytes(sizeof(T), alignof(T));
+    if(placement_ptr){
+        return new (placement_ptr) T(arguments...);
+    }else{
+        return nullptr;
+    }
+}
+
+template<typename T>
+void FreeList::give(T* ptr){
+
+    if(ptr){
+        ptr->~T();
+        give_bytes(ptr);
+    }
+}
+
+#endif
@@ -1,26 +1,156 @@
 #include "LinearAllocator.h"
+#include "VirtualArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 
 LinearAllocator::LinearAllocator(){
 }
 
 LinearAllocator::~LinearAllocator(){
-    free(memory);
+    deallocate();
 }
 
-void LinearAllocator::allocate(size_t bytes){
-    free(memory);
-    memory_bytes = bytes;
-    memory = malloc(bytes);
-    current = (char*)memory;
+void LinearAllocator::allocate(const size_t bytes){
+    deallocate();
+
+    Chunk chunk;
+    chunk.memory = arena ? (char*)arena->get_bytes(bytes, 1) : (char*)malloc(bytes);
+    chunk.bytes = chunk.memory ? bytes : 0;
+    chunks.push_back(chunk);
+
+    current_chunk = 0;
+    current = chunk.memory;
 }
 
 void LinearAllocator::deallocate(){
-    free(memory);
-    memory_bytes = 0;
-    memory = nullptr;
+    if(!arena){
+        for(Chunk& chunk : chunks){
+            free(chunk.memory);
+        }
+    }
+    chunks.clear();
+    current_chunk = 0;
     current = nullptr;
 }
 
 void LinearAllocator::reset(){
-    current = (char*)memory;
+#if defined(MEMORY_STATISTICS)
+    statistics->record_give(used_bytes());
+#endif
+    current_chunk = 0;
+    current = chunks.empty() ? nullptr : chunks[0].memory;
+}
+
+LinearAllocator::Marker LinearAllocator::mark() const{
+    Marker marker;
+    marker.chunk = current_chunk;
+    marker.current = current;
+    return marker;
+}
+
+void LinearAllocator::rewind(const Marker& marker){
+#if defined(MEMORY_STATISTICS)
+    const size_t used_bytes_before = used_bytes();
+#endif
+    current_chunk = marker.chunk;
+    current = marker.current;
+#if defined(MEMORY_STATISTICS)
+    statistics->record_give(used_bytes_before - used_bytes());
+#endif
+}
+
+size_t LinearAllocator::used_bytes() const{
+    if(chunks.empty()){
+        return 0;
+    }
+
+    size_t bytes = current - chunks[current_chunk].memory;
+    for(size_t ichunk = 0; ichunk != current_chunk; ++ichunk){
+        bytes += chunks[ichunk].bytes;
+    }
+    return bytes;
+}
+
+void* LinearAllocator::get_bytes(const size_t bytes, const size_t alignment){
+
+    // the current chunk then the chunks kept by reset / rewind
+    while(current_chunk < chunks.size()){
+        const Chunk& chunk = chunks[current_chunk];
+
+        const size_t offset = current - chunk.memory;
+        const size_t aligned_offset = offset + ((alignment - (uintptr_t)current % alignment) % alignment);
+
+        if(aligned_offset + bytes <= chunk.bytes){
+            current = chunk.memory + aligned_offset + bytes;
+#if defined(MEMORY_STATISTICS)
+            statistics->record_get(bytes);
+#endif
+            return chunk.memory + aligned_offset;
+        }
+
+        if(current_chunk + 1 == chunks.size()){
+            break;
+        }
+        ++current_chunk;
+        current = chunks[current_chunk].memory;
+    }
+
+    if(!growable){
+#if defined(MEMORY_STATISTICS)
+        statistics->record_failed_get(bytes);
+#endif
+        return nullptr;
+    }
+
+    size_t total_bytes = 0;
+    for(const Chunk& chunk : chunks){
+        total_bytes += chunk.bytes;
+    }
+
+    Chunk chunk;
+    chunk.bytes = std::max(std::max(total_bytes, min_chunk_bytes), bytes + alignment);
+    chunk.memory = arena ? (char*)arena->get_bytes(chunk.bytes, 1) : (char*)malloc(chunk.bytes);
+    if(!chunk.memory){
+#if defined(MEMORY_STATISTICS)
+        statistics->record_failed_get(bytes);
+#endif
+        return nullptr;
+    }
+    chunks.push_back(chunk);
+
+    const size_t aligned_offset = (alignment - (uintptr_t)chunk.memory % alignment) % alignment;
+    current_chunk = chunks.size() - 1;
+    current = chunk.memory + aligned_offset + bytes;
+#if defined(MEMORY_STATISTICS)
+    statistics->record_get(bytes);
+#endif
+    return chunk.memory + aligned_offset;
+}
+
+// ---- FrameAllocator ---- //
+
+void FrameAllocator::allocate(const size_t bytes_per_frame){
+    frames[0].allocate(bytes_per_frame);
+    frames[1].allocate(bytes_per_frame);
+    current_frame = 0;
+}
+
+void FrameAllocator::deallocate(){
+    frames[0].deallocate();
+    frames[1].deallocate();
+}
+
+void FrameAllocator::next_frame(){
+    current_frame = 1 - current_frame;
+    frames[current_frame].reset();
+}
+
+// ---- Scratch ---- //
+
+LinearAllocator& scratch_allocator(){
+    thread_local LinearAllocator allocator;
+    allocator.growable = true;
+    return allocator;
 }
@@ -1,6 +1,29 @@
 #ifndef H_LINEARALLOCATOR
 #define H_LINEARALLOCATOR
 
+#include <cstddef>
+#include <vector>
+
+#if defined(MEMORY_STATISTICS)
+#include "MemoryStatistics.h"
+#endif
+
+struct VirtualArena;
+
+// Bump allocator ie get() moves a pointer forward and the memory is released
+// all at once with reset() or back to a position saved with mark()
+// The destructors of the objects are never called so the allocator should
+// only contain trivially destructible types
+// allocate() creates the first chunk and, when /growable/ is true, get()
+// chains new chunks instead of returning nullptr
+// When /arena/ is set, the chunks are taken from the arena instead of malloc
+// and their memory is released by VirtualArena::reset
+//
+// ex:
+// LinearAllocator::Marker marker = allocator.mark();
+// float* temporary = allocator.get_array<float>(size);
+// ...
+// allocator.rewind(marker);
 struct LinearAllocator{
 
     // ---- Constructor ---- //
@@ -12,16 +35,89 @@ struct LinearAllocator{
 
     void allocate(const size_t bytes);
     void deallocate();
+
+    // Releases everything but keeps the chunks for the next allocations
     void reset();
 
+    // Position of the allocator, rewinding to a marker releases everything
+    // allocated after the call to mark()
+    struct Marker{
+        size_t chunk = 0;
+        char* current = nullptr;
+    };
+    Marker mark() const;
+    void rewind(const Marker& marker);
+
+    // Bytes between the start of the first chunk and the current position,
+    // the unused ends of the skipped chunks included
+    size_t used_bytes() const;
+
+    // ---- Get ---- //
+
+    // Returns nullptr when the chunks are full and the allocator is not growable
     template<typename T, typename ... ConstructorArguments>
     T* get(const ConstructorArguments& ... arguments);
 
+    // Array of /count/ default-initialized T
+    template<typename T>
+    T* get_array(const size_t count);
+
+    // /bytes/ bytes aligned on /alignment/, a power of two
+    void* get_bytes(const size_t bytes, const size_t alignment);
+
     // ---- Data ---- //
 
-    size_t memory_bytes = 0;
-    void* memory = nullptr;
-    char* current = nullptr;
-}
+    struct Chunk{
+        char* memory = nullptr;
+        size_t bytes = 0;
+    };
+
+    // When the chunks are full, a growable allocator adds a chunk with as
+    // many bytes as all the existing chunks, with at least /min_chunk_bytes/
+    bool growable = false;
+    size_t min_chunk_bytes = 1 << 16;
+
+    std::vector<Chunk> chunks;
+    size_t current_chunk = 0;
+    char* current = nullptr; // first free byte of chunks[current_chunk]
+
+    VirtualArena* arena = nullptr;
+
+#if defined(MEMORY_STATISTICS)
+    AllocatorStatistics* statistics = allocator_statistics("LinearAllocator");
+#endif
+};
+
+// Two LinearAllocators used on alternate frames ie what is allocated during
+// a frame remains valid during the next frame
+struct FrameAllocator{
+
+    // ---- Allocation ---- //
+
+    void allocate(const size_t bytes_per_frame);
+    void deallocate();
+
+    // Switches to the allocator of the frame before the current one and resets it
+    void next_frame();
+
+    // ---- Get ---- //
+
+    template<typename T, typename ... ConstructorArguments>
+    T* get(const ConstructorArguments& ... arguments);
+
+    template<typename T>
+    T* get_array(const size_t count);
+
+    // ---- Data ---- //
+
+    LinearAllocator frames[2];
+    int current_frame = 0;
+};
+
+// Growable LinearAllocator of the calling thread for the temporaries of a
+// function, that should rewind it to a marker before returning
+LinearAllocator& scratch_allocator();
+
+#include "LinearAllocator.inl"
 
 #endif
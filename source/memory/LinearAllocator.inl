@@ -1,17 +1,39 @@
 #ifndef INL_LINEARALLOCATOR
 #define INL_LINEARALLOCATOR
 
+#include <new>
+
 template<typename T, typename ... ConstructorArguments>
 T* LinearAllocator::get(const ConstructorArguments& ... arguments){
 
-    char* aligned_ptr = current + (current % std::alignment_of(T));
-
-    if((memory_bytes - (aligned_ptr - memory)) >= sizeof(T)){
-        current = aligned_ptr;
-        return new (aligned_ptr) T(arguments...);
+    void* placement_ptr = get_bytes(sizeof(T), alignof(T));
+    if(placement_ptr){
+        return new (placement_ptr) T(arguments...);
     }else{
         return nullptr;
     }
 }
 
+template<typename T>
+T* LinearAllocator::get_array(const size_t count){
+
+    T* array = (T*)get_bytes(count * sizeof(T), alignof(T));
+    if(array){
+        for(size_t ielement = 0; ielement != count; ++ielement){
+            new (array + ielement) T;
+        }
+    }
+    return array;
+}
+
+template<typename T, typename ... ConstructorArguments>
+T* FrameAllocator::get(const ConstructorArguments& ... arguments){
+    return frames[current_frame].get<T>(arguments...);
+}
+
+template<typename T>
+T* FrameAllocator::get_array(const size_t count){
+    return frames[current_frame].get_array<T>(count);
+}
+
 #endif
@@ -1,10 +1,24 @@
 #ifndef H_MEMORYPOOL
 #define H_MEMORYPOOL
 
+#include "VirtualArena.h"
+
+#if defined(MEMORY_STATISTICS)
+#include "MemoryStatistics.h"
+
+#include <string>
+#endif
+
 #include <cstdlib>
+#include <vector>
 
 // block_size should be determined using sizeof(T) for the type we want to store
 // in the MemoryPool because this makes sure blocks are properly aligned
+// The blocks are stored in slabs, allocate() creates the first one and, when
+// /growable/ is true, get() chains new slabs instead of returning nullptr
+// The blocks never move so the pointers remain valid when the pool grows
+// When /arena/ is set, the slabs are taken from the arena instead of malloc
+// and their memory is released by VirtualArena::reset
 template<size_t block_size>
 struct MemoryPool{
 
@@ -19,10 +33,23 @@ struct MemoryPool{
     void deallocate();
     void reset();
 
+    // Adds a slab of /blocks/ blocks to the free blocks
+    void grow(const size_t blocks);
+
+    // Releases the slabs whose blocks are all free and returns the number of
+    // released blocks, the pages of the slabs taken from an arena are
+    // discarded
+    // Runs in O(free blocks * log(slabs)) so it should be called between
+    // scenes rather than every frame
+    size_t shrink();
+
+    // Whether /ptr/ points inside one of the slabs
+    bool owns(const void* ptr) const;
+
     // ---- Block get / give ---- //
 
     // Takes a block from the pool and calls the constructor of T inside it using a placement new
-    // Returns nullptr when there are no blocks available
+    // Returns nullptr when there are no blocks available and the pool is not growable
     // ex:
     // A{short, short, short}   ; sizeof(A) = 6 and alignment on a multiple of 2
     // B{int}                   ; sizeof(B) = 4 and alignment on a multiple of 4
@@ -37,6 +64,11 @@ struct MemoryPool{
     template<typename T>
     void give(T* ptr);
 
+    // Same as get / give without constructor and destructor calls ie the
+    // block is raw storage of block_size bytes
+    void* get_block();
+    void give_block(void* ptr);
+
     // ---- Data ---- //
 
     union MemoryBlock{
@@ -44,9 +76,26 @@ struct MemoryPool{
         MemoryBlock* next;
     };
 
-    void* memory = nullptr;
+    struct Slab{
+        MemoryBlock* memory = nullptr;
+        size_t blocks = 0;
+    };
+
+    // When the pool is empty, a growable pool adds a slab with as many blocks
+    // as all the existing slabs ie the capacity doubles, with at least
+    // /min_slab_blocks/ blocks
+    bool growable = false;
+    size_t min_slab_blocks = 64;
+
+    std::vector<Slab> slabs;
     size_t memory_blocks = 0;
     MemoryBlock* current_block = nullptr;
+
+    VirtualArena* arena = nullptr;
+
+#if defined(MEMORY_STATISTICS)
+    AllocatorStatistics* statistics = allocator_statistics("MemoryPool<" + std::to_string(block_size) + ">");
+#endif
 };
 
 #include "MemoryPool.inl"
@@ -1,7 +1,9 @@
 #ifndef INL_MEMORYPOOL
 #define INL_MEMORYPOOL
 
+#include <algorithm>
 #include <cassert>
+#include <new>
 
 template<size_t block_size>
 MemoryPool<block_size>::MemoryPool(){
@@ -9,37 +11,138 @@ MemoryPool<block_size>::MemoryPool(){
 
 template<size_t block_size>
 MemoryPool<block_size>::~MemoryPool(){
-    free(memory);
+    deallocate();
 }
 
 template<size_t block_size>
 void MemoryPool<block_size>::allocate(const size_t blocks){
-    free(memory);
-    memory = malloc(blocks * sizeof(MemoryBlock));
-    current_block = (MemoryBlock*)memory;
-
-    for(size_t iblock = 0; iblock != blocks - 1; ++iblock){
-        (current_block + iblock)->next = current_block + (iblock + 1);
-    }
-
-    memory_blocks = blocks;
+    deallocate();
+    grow(blocks);
 }
 
 template<size_t block_size>
 void MemoryPool<block_size>::deallocate(){
-    free(memory);
-    memory = nullptr;
+    if(!arena){
+        for(Slab& slab : slabs){
+            free(slab.memory);
+        }
+    }
+    slabs.clear();
+    memory_blocks = 0;
     current_block = nullptr;
 }
 
 template<size_t block_size>
 void MemoryPool<block_size>::reset(){
-    current_block = (MemoryBlock*)memory;
+    current_block = nullptr;
 
-    for(size_t block = 0; block != memory_blocks - 1; ++block){
-        (current_block + block)->next = current_block + (block + 1);
+    // the first blocks of the first slab are returned first by get
+    for(size_t islab = slabs.size(); islab-- != 0;){
+        MemoryBlock* slab_memory = slabs[islab].memory;
+        for(size_t block = slabs[islab].blocks; block-- != 0;){
+            (slab_memory + block)->next = current_block;
+            current_block = slab_memory + block;
+        }
+    }
+}
 
+template<size_t block_size>
+void MemoryPool<block_size>::grow(const size_t blocks){
+
+    if(!blocks){
+        return;
+    }
+
+    Slab slab;
+    slab.memory = arena ? (MemoryBlock*)arena->get_bytes(blocks * sizeof(MemoryBlock), alignof(MemoryBlock))
+        : (MemoryBlock*)malloc(blocks * sizeof(MemoryBlock));
+    if(!slab.memory){
+        return;
+    }
+    slab.blocks = blocks;
+
+    for(size_t iblock = 0; iblock != blocks - 1; ++iblock){
+        (slab.memory + iblock)->next = slab.memory + (iblock + 1);
     }
+    (slab.memory + (blocks - 1))->next = current_block;
+    current_block = slab.memory;
+
+    slabs.push_back(slab);
+    memory_blocks += blocks;
+}
+
+template<size_t block_size>
+size_t MemoryPool<block_size>::shrink(){
+
+    // slabs sorted by address to find the slab of a block with a binary search
+    std::vector<size_t> slab_order(slabs.size());
+    for(size_t islab = 0; islab != slabs.size(); ++islab){
+        slab_order[islab] = islab;
+    }
+    std::sort(slab_order.begin(), slab_order.end(), [this](const size_t A, const size_t B){
+        return slabs[A].memory < slabs[B].memory;
+    });
+
+    auto slab_of_block = [&](const MemoryBlock* block){
+        const auto after = std::upper_bound(slab_order.begin(), slab_order.end(), block,
+            [this](const MemoryBlock* value, const size_t islab){
+                return value < slabs[islab].memory;
+            });
+        return *(after - 1);
+    };
+
+    std::vector<size_t> free_blocks(slabs.size(), 0);
+    for(MemoryBlock* block = current_block; block; block = block->next){
+        ++free_blocks[slab_of_block(block)];
+    }
+
+    std::vector<unsigned char> released(slabs.size(), 0);
+    size_t released_blocks = 0;
+    for(size_t islab = 0; islab != slabs.size(); ++islab){
+        if(free_blocks[islab] == slabs[islab].blocks){
+            released[islab] = 1;
+            released_blocks += slabs[islab].blocks;
+        }
+    }
+
+    if(!released_blocks){
+        return 0;
+    }
+
+    // unlinks the blocks of the released slabs, preserving the order of the others
+    MemoryBlock** link = &current_block;
+    while(*link){
+        if(released[slab_of_block(*link)]){
+            *link = (*link)->next;
+        }else{
+            link = &(*link)->next;
+        }
+    }
+
+    size_t kept_slabs = 0;
+    for(size_t islab = 0; islab != slabs.size(); ++islab){
+        if(released[islab] && arena){
+            arena->discard(slabs[islab].memory, slabs[islab].blocks * sizeof(MemoryBlock));
+        }else if(released[islab]){
+            free(slabs[islab].memory);
+        }else{
+            slabs[kept_slabs++] = slabs[islab];
+        }
+    }
+    slabs.resize(kept_slabs);
+    memory_blocks -= released_blocks;
+
+    return released_blocks;
+}
+
+template<size_t block_size>
+bool MemoryPool<block_size>::owns(const void* ptr) const{
+    for(const Slab& slab : slabs){
+        if(ptr >= (const void*)slab.memory && ptr < (const void*)(slab.memory + slab.blocks)){
+            return true;
+        }
+    }
+    return false;
 }
 
 template<size_t block_size>
@@ -49,10 +152,7 @@ T* MemoryPool<block_size>::get(const ConstructorArguments& ... arguments){
     static_assert(sizeof(T) <= block_size && (block_size % alignof(T)) == 0,
                 "The alignment of T is not compatible with the block_size of the MemoryPool");
 
-    if(current_block){
-        // The temporary storage is necessary because of the placement new
-        MemoryBlock* placement_ptr = current_block;
-        current_block = current_block->next;
+    if(void* placement_ptr = get_block()){
         return new (placement_ptr) T(arguments...);
     }else{
         return nullptr;
@@ -63,12 +163,45 @@ template<size_t block_size>
 template<typename T>
 void MemoryPool<block_size>::give(T* ptr){
 
-    assert((void*)ptr >= memory && (void*)ptr <= (void*)((MemoryBlock*)(memory) + memory_blocks));
-
     if(ptr){
         ptr->~T();
+        give_block(ptr);
+    }
+}
+
+template<size_t block_size>
+void* MemoryPool<block_size>::get_block(){
+
+    if(!current_block && growable){
+        grow(std::max(memory_blocks, min_slab_blocks));
+    }
+
+    if(current_block){
+        MemoryBlock* block = current_block;
+        current_block = current_block->next;
+#if defined(MEMORY_STATISTICS)
+        statistics->record_get(block_size);
+#endif
+        return block;
+    }else{
+#if defined(MEMORY_STATISTICS)
+        statistics->record_failed_get(block_size);
+#endif
+        return nullptr;
+    }
+}
+
+template<size_t block_size>
+void MemoryPool<block_size>::give_block(void* ptr){
+
+    assert(!ptr || owns(ptr));
+
+    if(ptr){
         ((MemoryBlock*)ptr)->next = current_block;
         current_block = (MemoryBlock*)ptr;
+#if defined(MEMORY_STATISTICS)
+        statistics->record_give(block_size);
+#endif
     }
 }
 
@@ -0,0 +1,162 @@
+#include "MemoryStatistics.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+
+static thread_local const char* current_tag = nullptr;
+
+// ---- AllocatorStatistics ---- //
+
+void AllocatorStatistics::record_get(const size_t bytes){
+    gets.fetch_add(1, std::memory_order_relaxed);
+    const size_t live = live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t high_water = high_water_bytes.load(std::memory_order_relaxed);
+    while(live > high_water && !high_water_bytes.compare_exchange_weak(high_water, live, std::memory_order_relaxed)){
+    }
+
+    int size_class = 0;
+    while(size_class != number_of_size_classes - 1 && bytes > ((size_t)8 << size_class)){
+        ++size_class;
+    }
+    size_class_gets[size_class].fetch_add(1, std::memory_order_relaxed);
+
+    if(current_tag){
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        TagStatistics& tag = tags[current_tag];
+        ++tag.gets;
+        tag.bytes += bytes;
+    }
+}
+
+void AllocatorStatistics::record_give(const size_t bytes){
+    gives.fetch_add(1, std::memory_order_relaxed);
+    size_t live = live_bytes.load(std::memory_order_relaxed);
+    while(!live_bytes.compare_exchange_weak(live, (bytes < live) ? live - bytes : 0, std::memory_order_relaxed)){
+    }
+}
+
+void AllocatorStatistics::record_failed_get(const size_t bytes){
+    (void)bytes;
+    failed_gets.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ---- Registry ---- //
+
+struct StatisticsRegistry{
+    std::mutex mutex;
+    std::deque<AllocatorStatistics> records; // the pointers remain valid
+    std::string path = "memory_statistics.json";
+};
+
+static StatisticsRegistry& statistics_registry(){
+    static StatisticsRegistry registry;
+    return registry;
+}
+
+#if defined(MEMORY_STATISTICS)
+static void write_memory_statistics_at_exit(){
+    StatisticsRegistry& registry = statistics_registry();
+    write_memory_statistics(registry.path.c_str());
+}
+#endif
+
+AllocatorStatistics* allocator_statistics(const std::string& name){
+    StatisticsRegistry& registry = statistics_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for(AllocatorStatistics& record : registry.records){
+        if(record.name == name){
+            return &record;
+        }
+    }
+
+#if defined(MEMORY_STATISTICS)
+    // registered after the construction of the registry so that it is
+    // called before the destruction of the registry
+    if(registry.records.empty()){
+        atexit(write_memory_statistics_at_exit);
+    }
+#endif
+
+    registry.records.emplace_back();
+    registry.records.back().name = name;
+    return &registry.records.back();
+}
+
+void set_memory_statistics_path(const char* path){
+    StatisticsRegistry& registry = statistics_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.path = path;
+}
+
+static void write_json_string(FILE* file, const std::string& value){
+    fputc('"', file);
+    for(const char character : value){
+        if(character == '"' || character == '\\'){
+            fputc('\\', file);
+        }
+        fputc(character, file);
+    }
+    fputc('"', file);
+}
+
+bool write_memory_statistics(const char* path){
+
+    FILE* file = fopen(path, "w");
+    if(!file){
+        return false;
+    }
+
+    StatisticsRegistry& registry = statistics_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    fprintf(file, "{\n    \"allocators\": [");
+    for(size_t irecord = 0; irecord != registry.records.size(); ++irecord){
+        AllocatorStatistics& record = registry.records[irecord];
+
+        fprintf(file, "%s\n        {\n            \"name\": ", irecord ? "," : "");
+        write_json_string(file, record.name);
+        fprintf(file, ",\n            \"live_bytes\": %zu,\n            \"high_water_bytes\": %zu,"
+                "\n            \"gets\": %zu,\n            \"gives\": %zu,\n            \"failed_gets\": %zu,",
+                record.live_bytes.load(), record.high_water_bytes.load(), record.gets.load(), record.gives.load(),
+                record.failed_gets.load());
+
+        fprintf(file, "\n            \"size_classes\": [");
+        for(int iclass = 0; iclass != AllocatorStatistics::number_of_size_classes; ++iclass){
+            if(iclass == AllocatorStatistics::number_of_size_classes - 1){
+                fprintf(file, "{\"max_bytes\": null, \"gets\": %zu}", record.size_class_gets[iclass].load());
+            }else{
+                fprintf(file, "{\"max_bytes\": %zu, \"gets\": %zu}, ", (size_t)8 << iclass, record.size_class_gets[iclass].load());
+            }
+        }
+        fprintf(file, "],");
+
+        fprintf(file, "\n            \"tags\": {");
+        std::lock_guard<std::mutex> tags_lock(record.tags_mutex);
+        bool first_tag = true;
+        for(const auto& tag : record.tags){
+            fprintf(file, "%s\n                ", first_tag ? "" : ",");
+            write_json_string(file, tag.first);
+            fprintf(file, ": {\"gets\": %zu, \"bytes\": %zu}", tag.second.gets, tag.second.bytes);
+            first_tag = false;
+        }
+        fprintf(file, "%s}\n        }", first_tag ? "" : "\n            ");
+    }
+    fprintf(file, "\n    ]\n}\n");
+
+    fclose(file);
+    return true;
+}
+
+// ---- MemoryTag ---- //
+
+MemoryTag::MemoryTag(const char* tag){
+    previous_tag = current_tag;
+    current_tag = tag;
+}
+
+MemoryTag::~MemoryTag(){
+    current_tag = previous_tag;
+}
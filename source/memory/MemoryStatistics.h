@@ -0,0 +1,71 @@
+#ifndef H_MEMORYSTATISTICS
+#define H_MEMORYSTATISTICS
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Statistics of the allocators of the memory module, recorded only when
+// MEMORY_STATISTICS is defined (cf. HONEYCOMB_MEMORY_STATISTICS in CMake)
+// Each allocator points to an AllocatorStatistics shared by the allocators
+// with the same name, the records outlive the allocators and are written as
+// JSON at exit
+// The allocators of several threads can share a record, eg the thread_local
+// scratch allocators, so the counters are atomic and the tags are locked
+//
+// ex:
+// pool.statistics = allocator_statistics("particles");
+// {
+//     MemoryTag tag("Particles::start");
+//     ... gets recorded with the tag "Particles::start"
+// }
+
+struct AllocatorStatistics{
+
+    void record_get(const size_t bytes);
+    void record_give(const size_t bytes);
+    void record_failed_get(const size_t bytes);
+
+    // ---- Data ---- //
+
+    std::string name;
+
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<size_t> high_water_bytes{0};
+    std::atomic<size_t> gets{0};
+    std::atomic<size_t> gives{0};
+    std::atomic<size_t> failed_gets{0};
+
+    // The class i counts the gets of up to 8 << i bytes, the last class the larger ones
+    static constexpr int number_of_size_classes = 12;
+    std::atomic<size_t> size_class_gets[number_of_size_classes] = {};
+
+    // Gets made while a MemoryTag is alive, accessed under /tags_mutex/
+    struct TagStatistics{
+        size_t gets = 0;
+        size_t bytes = 0;
+    };
+    std::map<std::string, TagStatistics> tags;
+    std::mutex tags_mutex;
+};
+
+// Record of the allocators named /name/, created on the first call
+AllocatorStatistics* allocator_statistics(const std::string& name);
+
+// Writes every record as JSON, returns false when the file cannot be opened
+bool write_memory_statistics(const char* path);
+
+// File written at exit when MEMORY_STATISTICS is defined
+void set_memory_statistics_path(const char* path);
+
+// Tags the gets of the calling thread until it is destroyed, the tags nest
+struct MemoryTag{
+    MemoryTag(const char* tag);
+    ~MemoryTag();
+
+    const char* previous_tag = nullptr;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef H_SIZECLASSALLOCATOR
+#define H_SIZECLASSALLOCATOR
+
+#include "MemoryPool.h"
+
+#if defined(MEMORY_STATISTICS)
+#include "MemoryStatistics.h"
+#endif
+
+#include <cstddef>
+#include <memory_resource>
+
+// Small-object allocator made of growable MemoryPools for the size classes
+// 8, 16, 32, ..., 1024 bytes
+// A request of /bytes/ with /alignment/ is served by the smallest class that
+// holds max(bytes, alignment) bytes ie the blocks are aligned on
+// min(class size, alignof(std::max_align_t)), larger or over-aligned requests
+// go to the /upstream/ resource
+// Not thread safe, like MemoryPool
+//
+// ex:
+// SizeClassAllocator allocator;
+// std::pmr::vector<int> values(&allocator);
+// std::pmr::unordered_map<int, float> map(&allocator);
+struct SizeClassAllocator : public std::pmr::memory_resource{
+
+    // ---- Constructor ---- //
+
+    SizeClassAllocator(std::pmr::memory_resource* upstream_resource = std::pmr::new_delete_resource());
+
+    // ---- Allocation ---- //
+
+    // Releases the fully free slabs of every size class and returns the
+    // number of released bytes
+    size_t shrink();
+
+    // Index of the size class of a request of /bytes/ <= max_class_size
+    static int size_class(const size_t bytes);
+
+    // ---- memory_resource ---- //
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    // ---- Data ---- //
+
+    static constexpr size_t min_class_size = 8;
+    static constexpr size_t max_class_size = 1024;
+    static constexpr int number_of_classes = 8;
+
+    std::pmr::memory_resource* upstream = nullptr;
+
+    MemoryPool<8> pool_8;
+    MemoryPool<16> pool_16;
+    MemoryPool<32> pool_32;
+    MemoryPool<64> pool_64;
+    MemoryPool<128> pool_128;
+    MemoryPool<256> pool_256;
+    MemoryPool<512> pool_512;
+    MemoryPool<1024> pool_1024;
+
+    // The requests of all the size classes, the pools have their own records
+#if defined(MEMORY_STATISTICS)
+    AllocatorStatistics* statistics = allocator_statistics("SizeClassAllocator");
+#endif
+};
+
+#include "SizeClassAllocator.inl"
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef INL_SIZECLASSALLOCATOR
+#define INL_SIZECLASSALLOCATOR
+
+#include <algorithm>
+#include <array>
+#include <new>
+
+// The allocator is not a template but its functions are defined inline so
+// that the memory folder can be used without compiling sources
+
+inline SizeClassAllocator::SizeClassAllocator(std::pmr::memory_resource* upstream_resource)
+    : upstream(upstream_resource){
+
+    pool_8.growable = true;
+    pool_16.growable = true;
+    pool_32.growable = true;
+    pool_64.growable = true;
+    pool_128.growable = true;
+    pool_256.growable = true;
+    pool_512.growable = true;
+    pool_1024.growable = true;
+}
+
+inline size_t SizeClassAllocator::shrink(){
+    return pool_8.shrink() * 8
+        + pool_16.shrink() * 16
+        + pool_32.shrink() * 32
+        + pool_64.shrink() * 64
+        + pool_128.shrink() * 128
+        + pool_256.shrink() * 256
+        + pool_512.shrink() * 512
+        + pool_1024.shrink() * 1024;
+}
+
+inline int SizeClassAllocator::size_class(const size_t bytes){
+
+    // class of each multiple of min_class_size ie a table lookup
+    static constexpr std::array<unsigned char, max_class_size / min_class_size> classes = [](){
+        std::array<unsigned char, max_class_size / min_class_size> output = {};
+        unsigned char output_class = 0;
+        for(size_t ientry = 0; ientry != output.size(); ++ientry){
+            while((min_class_size << output_class) < (ientry + 1) * min_class_size){
+                ++output_class;
+            }
+            output[ientry] = output_class;
+        }
+        return output;
+    }();
+
+    return bytes ? classes[(bytes - 1) / min_class_size] : 0;
+}
+
+inline void* SizeClassAllocator::do_allocate(size_t bytes, size_t alignment){
+
+#if defined(MEMORY_STATISTICS)
+    statistics->record_get(bytes);
+#endif
+
+    const size_t class_bytes = std::max(bytes, alignment);
+    if(class_bytes > max_class_size || alignment > alignof(std::max_align_t)){
+        return upstream->allocate(bytes, alignment);
+    }
+
+    void* ptr = nullptr;
+    switch(size_class(class_bytes)){
+        case 0: ptr = pool_8.get_block(); break;
+        case 1: ptr = pool_16.get_block(); break;
+        case 2: ptr = pool_32.get_block(); break;
+        case 3: ptr = pool_64.get_block(); break;
+        case 4: ptr = pool_128.get_block(); break;
+        case 5: ptr = pool_256.get_block(); break;
+        case 6: ptr = pool_512.get_block(); break;
+        case 7: ptr = pool_1024.get_block(); break;
+    }
+
+    // the pools only fail when malloc fails
+    if(!ptr){
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+inline void SizeClassAllocator::do_deallocate(void* ptr, size_t bytes, size_t alignment){
+
+#if defined(MEMORY_STATISTICS)
+    statistics->record_give(bytes);
+#endif
+
+    const size_t class_bytes = std::max(bytes, alignment);
+    if(class_bytes > max_class_size || alignment > alignof(std::max_align_t)){
+        upstream->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    switch(size_class(class_bytes)){
+        case 0: pool_8.give_block(ptr); break;
+        case 1: pool_16.give_block(ptr); break;
+        case 2: pool_32.give_block(ptr); break;
+        case 3: pool_64.give_block(ptr); break;
+        case 4: pool_128.give_block(ptr); break;
+        case 5: pool_256.give_block(ptr); break;
+        case 6: pool_512.give_block(ptr); break;
+        case 7: pool_1024.give_block(ptr); break;
+    }
+}
+
+inline bool SizeClassAllocator::do_is_equal(const std::pmr::memory_resource& other) const noexcept{
+    return this == &other;
+}
+
+#endif
@@ -0,0 +1,196 @@
+#define NOMINMAX
+
+#include "VirtualArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static constexpr size_t huge_page_bytes = (size_t)2 << 20;
+
+static size_t round_up(const size_t value, const size_t multiple){
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+VirtualArena::VirtualArena(){
+}
+
+VirtualArena::~VirtualArena(){
+    release();
+}
+
+bool VirtualArena::reserve(const size_t bytes, const HugePages huge_pages_mode){
+    release();
+
+#if defined(_WIN32)
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    page_bytes = system_info.dwPageSize;
+    commit_granularity = page_bytes;
+    huge_pages = NONE;
+
+    reserved_bytes = round_up(bytes, system_info.dwAllocationGranularity);
+    mapping = VirtualAlloc(nullptr, reserved_bytes, MEM_RESERVE, PAGE_NOACCESS);
+    mapping_bytes = reserved_bytes;
+    if(!mapping){
+        reserved_bytes = 0;
+        mapping_bytes = 0;
+        return false;
+    }
+    memory = (char*)mapping;
+
+#else
+
+    page_bytes = sysconf(_SC_PAGESIZE);
+    huge_pages = huge_pages_mode;
+
+#if defined(MAP_HUGETLB)
+    // without MAP_NORESERVE the huge pages of the whole range are reserved
+    // by mmap, that fails when they are not available instead of the first
+    // access to a missing page raising SIGBUS
+    if(huge_pages == EXPLICIT){
+        reserved_bytes = round_up(bytes, huge_page_bytes);
+        mapping = mmap(nullptr, reserved_bytes, PROT_NONE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(mapping != MAP_FAILED){
+            mapping_bytes = reserved_bytes;
+            memory = (char*)mapping;
+            commit_granularity = huge_page_bytes;
+            return true;
+        }
+        mapping = nullptr;
+    }
+#endif
+
+    if(huge_pages != NONE){
+        huge_pages = TRANSPARENT;
+    }
+
+    // the transparent huge pages require ranges aligned on their size so the
+    // mapping has one more huge page to align /memory/
+    const size_t alignment = (huge_pages == TRANSPARENT) ? huge_page_bytes : page_bytes;
+    reserved_bytes = round_up(bytes, alignment);
+    mapping_bytes = reserved_bytes + (alignment > page_bytes ? alignment : 0);
+
+    mapping = mmap(nullptr, mapping_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(mapping == MAP_FAILED){
+        mapping = nullptr;
+        reserved_bytes = 0;
+        mapping_bytes = 0;
+        return false;
+    }
+    memory = (char*)round_up((uintptr_t)mapping, alignment);
+    commit_granularity = alignment;
+
+#if defined(MADV_HUGEPAGE)
+    if(huge_pages == TRANSPARENT){
+        madvise(memory, reserved_bytes, MADV_HUGEPAGE);
+    }
+#endif
+
+#endif
+
+    return true;
+}
+
+void VirtualArena::release(){
+
+    if(mapping){
+#if defined(_WIN32)
+        VirtualFree(mapping, 0, MEM_RELEASE);
+#else
+        munmap(mapping, mapping_bytes);
+#endif
+    }
+
+    memory = nullptr;
+    reserved_bytes = 0;
+    committed_bytes = 0;
+    used_bytes = 0;
+    mapping = nullptr;
+    mapping_bytes = 0;
+}
+
+bool VirtualArena::commit(const size_t bytes){
+
+    if(bytes <= committed_bytes){
+        return true;
+    }
+    if(bytes > reserved_bytes){
+        return false;
+    }
+
+    const size_t new_committed_bytes = std::min(round_up(bytes, commit_granularity), reserved_bytes);
+
+#if defined(_WIN32)
+    if(!VirtualAlloc(memory + committed_bytes, new_committed_bytes - committed_bytes, MEM_COMMIT, PAGE_READWRITE)){
+        return false;
+    }
+#else
+    if(mprotect(memory + committed_bytes, new_committed_bytes - committed_bytes, PROT_READ | PROT_WRITE)){
+        return false;
+    }
+#endif
+
+    committed_bytes = new_committed_bytes;
+    return true;
+}
+
+void VirtualArena::reset(){
+
+#if defined(MEMORY_STATISTICS)
+    statistics->record_give(used_bytes);
+#endif
+
+    if(committed_bytes){
+#if defined(_WIN32)
+        VirtualFree(memory, committed_bytes, MEM_DECOMMIT);
+#else
+        madvise(memory, committed_bytes, MADV_DONTNEED);
+        mprotect(memory, committed_bytes, PROT_NONE);
+#endif
+    }
+
+    committed_bytes = 0;
+    used_bytes = 0;
+}
+
+void VirtualArena::discard(void* ptr, const size_t bytes){
+
+    const uintptr_t begin = round_up((uintptr_t)ptr, page_bytes);
+    const uintptr_t end = ((uintptr_t)ptr + bytes) / page_bytes * page_bytes;
+    if(end <= begin){
+        return;
+    }
+
+#if defined(_WIN32)
+    // MEM_RESET lets the system drop the pages but does not zero them
+    VirtualAlloc((void*)begin, end - begin, MEM_RESET, PAGE_READWRITE);
+#else
+    madvise((void*)begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+void* VirtualArena::get_bytes(const size_t bytes, const size_t alignment){
+
+    const size_t offset = round_up((uintptr_t)(memory + used_bytes), alignment) - (uintptr_t)memory;
+    if(!memory || offset + bytes > reserved_bytes || !commit(offset + bytes)){
+#if defined(MEMORY_STATISTICS)
+        statistics->record_failed_get(bytes);
+#endif
+        return nullptr;
+    }
+
+#if defined(MEMORY_STATISTICS)
+    statistics->record_get(offset + bytes - used_bytes);
+#endif
+    used_bytes = offset + bytes;
+    return memory + offset;
+}
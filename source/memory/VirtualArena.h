@@ -0,0 +1,83 @@
+#ifndef H_VIRTUALARENA
+#define H_VIRTUALARENA
+
+#include <cstddef>
+
+#if defined(MEMORY_STATISTICS)
+#include "MemoryStatistics.h"
+#endif
+
+// Range of virtual memory reserved once and committed on demand ie large
+// buffers can grow without being copied and only the used pages consume
+// physical memory
+// get_bytes() allocates linearly from the start of the range, reset()
+// decommits everything and the memory reads as zero afterwards
+// The LinearAllocator and MemoryPool use an arena instead of malloc when
+// their /arena/ pointer is set
+//
+// ex:
+// VirtualArena arena;
+// arena.reserve((size_t)16 << 30, VirtualArena::TRANSPARENT);
+// float* grid = (float*)arena.get_bytes(width * height * sizeof(float));
+struct VirtualArena{
+
+    // NONE uses the default pages
+    // TRANSPARENT aligns the range on 2 MB and asks the kernel to use
+    // transparent huge pages ie madvise(MADV_HUGEPAGE)
+    // EXPLICIT maps the range with MAP_HUGETLB, which requires enough huge
+    // pages for the whole range in /proc/sys/vm/nr_hugepages, and falls back
+    // to TRANSPARENT
+    // Only NONE is available on Windows where large pages require a privilege
+    enum HugePages {NONE = 0, TRANSPARENT = 1, EXPLICIT = 2};
+
+    // ---- Constructor ---- //
+
+    VirtualArena();
+    ~VirtualArena();
+
+    // ---- Reservation ---- //
+
+    // Returns false when the range could not be reserved
+    bool reserve(const size_t bytes, const HugePages huge_pages_mode = NONE);
+    void release();
+
+    // Makes [memory; memory + bytes[ usable, rounded up to commit_granularity
+    // Returns false when bytes is larger than the reservation
+    bool commit(const size_t bytes);
+
+    // Returns the committed pages to the system, releases everything
+    // allocated by get_bytes and keeps the reservation
+    void reset();
+
+    // Returns the pages fully inside [ptr; ptr + bytes[ to the system, the
+    // range is still committed but its content is undefined
+    void discard(void* ptr, const size_t bytes);
+
+    // ---- Get ---- //
+
+    // /bytes/ bytes aligned on /alignment/, a power of two, committing the
+    // memory when needed
+    // Returns nullptr when the reservation is full
+    void* get_bytes(const size_t bytes, const size_t alignment = 64);
+
+    // ---- Data ---- //
+
+    char* memory = nullptr;
+    size_t reserved_bytes = 0;
+    size_t committed_bytes = 0;
+    size_t used_bytes = 0;
+
+    HugePages huge_pages = NONE;
+    size_t page_bytes = 4096;
+    size_t commit_granularity = 4096;
+
+    // Start and size of the mapping when /memory/ was aligned
+    void* mapping = nullptr;
+    size_t mapping_bytes = 0;
+
+#if defined(MEMORY_STATISTICS)
+    AllocatorStatistics* statistics = allocator_statistics("VirtualArena");
+#endif
+};
+
+#endif
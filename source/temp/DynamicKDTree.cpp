@@ -0,0 +1,297 @@
+#define NOMINMAX
+
+#include "DynamicKDTree.h"
+
+#include <algorithm>
+#include <new>
+
+DynamicKDTree::DynamicKDTree(){
+}
+
+DynamicKDTree::~DynamicKDTree(){
+    clear();
+}
+
+void DynamicKDTree::build(const glm::vec3* points, const unsigned int point_count){
+
+    clear();
+
+    locations.resize(point_count);
+    gathered_points.assign(points, points + point_count);
+    gathered_ids.resize(point_count);
+    for(unsigned int ipoint = 0; ipoint != point_count; ++ipoint){
+        gathered_ids[ipoint] = ipoint;
+    }
+    number_of_points = point_count;
+
+    unsigned int ilevel = 0;
+    while(ilevel + 1 < max_levels && level_capacity(ilevel) < point_count){
+        ++ilevel;
+    }
+    build_gathered(ilevel);
+}
+
+void DynamicKDTree::clear(){
+
+    for(unsigned int ilevel = 0; ilevel != max_levels; ++ilevel){
+        levels[ilevel].clear();
+        level_points[ilevel] = 0;
+    }
+
+    if(buffer){
+        ::operator delete(buffer, std::align_val_t(64));
+    }
+    buffer = nullptr;
+    buffer_blocks = 0;
+    buffer_size = 0;
+
+    locations.clear();
+    free_ids.clear();
+    number_of_points = 0;
+}
+
+void DynamicKDTree::rebuild(){
+
+    gathered_points.clear();
+    gathered_ids.clear();
+    gather(buffer_level);
+    for(unsigned int ilevel = 0; ilevel != max_levels; ++ilevel){
+        gather(ilevel);
+    }
+
+    unsigned int ilevel = 0;
+    while(ilevel + 1 < max_levels && level_capacity(ilevel) < gathered_points.size()){
+        ++ilevel;
+    }
+    build_gathered(ilevel);
+}
+
+uint32_t DynamicKDTree::insert(const glm::vec3 position){
+
+    uint32_t id;
+    if(free_ids.empty()){
+        id = (uint32_t)locations.size();
+        locations.push_back({erased_level, 0u});
+    }else{
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+
+    push(id, position);
+    ++number_of_points;
+    return id;
+}
+
+void DynamicKDTree::erase(const uint32_t id){
+
+    remove(id);
+    locations[id] = {erased_level, 0u};
+    free_ids.push_back(id);
+    --number_of_points;
+}
+
+void DynamicKDTree::move(const uint32_t id, const glm::vec3 position){
+
+    const Location location = locations[id];
+    FlatKDTree::LeafBlock* block;
+
+    if(location.level == buffer_level){
+        block = &buffer[location.slot / 8];
+    }else{
+        // the point stays in place when the search for /position/ ends in
+        // the leaf that contains it
+        const FlatKDTree& tree = levels[location.level];
+        const uint32_t ileaf = tree.leaf(position);
+        if(location.slot / 8 < tree.leaf_offsets[ileaf] || location.slot / 8 >= tree.leaf_offsets[ileaf + 1]){
+            remove(id);
+            push(id, position);
+            return;
+        }
+        block = &tree.blocks[location.slot / 8];
+    }
+
+    block->x[location.slot % 8] = position.x;
+    block->y[location.slot % 8] = position.y;
+    block->z[location.slot % 8] = position.z;
+}
+
+glm::vec3 DynamicKDTree::position(const uint32_t id) const{
+
+    const Location location = locations[id];
+    const FlatKDTree::LeafBlock& block = location.level == buffer_level
+        ? buffer[location.slot / 8] : levels[location.level].blocks[location.slot / 8];
+    return glm::vec3(block.x[location.slot % 8], block.y[location.slot % 8], block.z[location.slot % 8]);
+}
+
+uint32_t DynamicKDTree::nearest(const glm::vec3 point, float* squared_distance) const{
+
+    uint32_t best = invalid_index;
+    float best_distance = INFINITY;
+
+    // the largest levels first so that the bound prunes the smaller ones
+    for(unsigned int ilevel = max_levels; ilevel--;){
+        if(level_points[ilevel]){
+            float distance;
+            const uint32_t index = levels[ilevel].nearest(point, &distance, best_distance);
+            if(index != invalid_index){
+                best = index;
+                best_distance = distance;
+            }
+        }
+    }
+
+    for(unsigned int iblock = 0; iblock != (buffer_size + 7) / 8; ++iblock){
+        const FlatKDTree::LeafBlock& block = buffer[iblock];
+
+        float squared_distances[8];
+        unsigned int mask = FlatKDTree::block_closer(block, point, best_distance, squared_distances);
+        for(int ientry = 0; mask; ++ientry, mask >>= 1){
+            if((mask & 1u) && squared_distances[ientry] < best_distance){
+                best_distance = squared_distances[ientry];
+                best = block.index[ientry];
+            }
+        }
+    }
+
+    if(squared_distance){
+        *squared_distance = best_distance;
+    }
+    return best;
+}
+
+// ---- Internal ---- //
+
+static void set_padding(FlatKDTree::LeafBlock& block, const unsigned int entry){
+    block.x[entry] = INFINITY;
+    block.y[entry] = INFINITY;
+    block.z[entry] = INFINITY;
+    block.index[entry] = FlatKDTree::invalid_index;
+}
+
+void DynamicKDTree::remove(const uint32_t id){
+
+    const Location location = locations[id];
+
+    if(location.level == buffer_level){
+        // the last point of the buffer takes the slot of the point
+        const uint32_t last = --buffer_size;
+        FlatKDTree::LeafBlock& block = buffer[location.slot / 8];
+        FlatKDTree::LeafBlock& last_block = buffer[last / 8];
+
+        block.x[location.slot % 8] = last_block.x[last % 8];
+        block.y[location.slot % 8] = last_block.y[last % 8];
+        block.z[location.slot % 8] = last_block.z[last % 8];
+        block.index[location.slot % 8] = last_block.index[last % 8];
+        locations[block.index[location.slot % 8]].slot = location.slot;
+        set_padding(last_block, last % 8);
+        return;
+    }
+
+    set_padding(levels[location.level].blocks[location.slot / 8], location.slot % 8);
+    --level_points[location.level];
+
+    if(level_points[location.level] < levels[location.level].number_of_points / 2){
+        gathered_points.clear();
+        gathered_ids.clear();
+        gather(location.level);
+        build_gathered(location.level);
+    }
+}
+
+void DynamicKDTree::push(const uint32_t id, const glm::vec3 position){
+
+    if(!buffer){
+        buffer_blocks = std::max(1u, (buffer_capacity + 7) / 8);
+        buffer = (FlatKDTree::LeafBlock*)::operator new(buffer_blocks * sizeof(FlatKDTree::LeafBlock), std::align_val_t(64));
+        for(unsigned int ientry = 0; ientry != 8 * buffer_blocks; ++ientry){
+            set_padding(buffer[ientry / 8], ientry % 8);
+        }
+    }
+
+    // the buffer and the smallest levels go to the first level that can
+    // hold all of them
+    if(buffer_size == 8 * buffer_blocks){
+        uint64_t count = buffer_size + level_points[0];
+        unsigned int target = 0;
+        while(target + 1 < max_levels && count > level_capacity(target)){
+            ++target;
+            count += level_points[target];
+        }
+
+        gathered_points.clear();
+        gathered_ids.clear();
+        gather(buffer_level);
+        for(unsigned int ilevel = 0; ilevel <= target; ++ilevel){
+            gather(ilevel);
+        }
+        build_gathered(target);
+    }
+
+    FlatKDTree::LeafBlock& block = buffer[buffer_size / 8];
+    block.x[buffer_size % 8] = position.x;
+    block.y[buffer_size % 8] = position.y;
+    block.z[buffer_size % 8] = position.z;
+    block.index[buffer_size % 8] = id;
+    locations[id] = {buffer_level, buffer_size};
+    ++buffer_size;
+}
+
+void DynamicKDTree::gather(const unsigned int ilevel){
+
+    if(ilevel == buffer_level){
+        for(unsigned int ientry = 0; ientry != buffer_size; ++ientry){
+            FlatKDTree::LeafBlock& block = buffer[ientry / 8];
+            gathered_points.push_back(glm::vec3(block.x[ientry % 8], block.y[ientry % 8], block.z[ientry % 8]));
+            gathered_ids.push_back(block.index[ientry % 8]);
+            set_padding(block, ientry % 8);
+        }
+        buffer_size = 0;
+        return;
+    }
+
+    FlatKDTree& tree = levels[ilevel];
+    for(unsigned int iblock = 0; iblock != tree.number_of_blocks; ++iblock){
+        const FlatKDTree::LeafBlock& block = tree.blocks[iblock];
+        for(int ientry = 0; ientry != 8; ++ientry){
+            if(block.index[ientry] != invalid_index){
+                gathered_points.push_back(glm::vec3(block.x[ientry], block.y[ientry], block.z[ientry]));
+                gathered_ids.push_back(block.index[ientry]);
+            }
+        }
+    }
+    tree.clear();
+    level_points[ilevel] = 0;
+}
+
+void DynamicKDTree::build_gathered(const unsigned int ilevel){
+
+    FlatKDTree& tree = levels[ilevel];
+    if(gathered_points.empty()){
+        tree.clear();
+        level_points[ilevel] = 0;
+        return;
+    }
+
+    tree.build(gathered_points.data(), (unsigned int)gathered_points.size(), thread_pool);
+    level_points[ilevel] = (unsigned int)gathered_points.size();
+
+    // the blocks store the ids instead of the indices in the gathered points
+    for(unsigned int iblock = 0; iblock != tree.number_of_blocks; ++iblock){
+        FlatKDTree::LeafBlock& block = tree.blocks[iblock];
+        for(unsigned int ientry = 0; ientry != 8; ++ientry){
+            if(block.index[ientry] != invalid_index){
+                block.index[ientry] = gathered_ids[block.index[ientry]];
+                locations[block.index[ientry]] = {ilevel, 8 * iblock + ientry};
+            }
+        }
+    }
+}
+
+uint64_t DynamicKDTree::level_capacity(const unsigned int ilevel) const{
+
+    uint64_t capacity = std::max(8u, buffer_capacity);
+    for(unsigned int ipower = 0; ipower <= ilevel; ++ipower){
+        capacity *= std::max(2u, growth);
+    }
+    return capacity;
+}
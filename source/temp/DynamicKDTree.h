@@ -0,0 +1,110 @@
+#ifndef H_DYNAMIC_KDTREE
+#define H_DYNAMIC_KDTREE
+
+#include "FlatKDTree.h"
+
+#include <vector>
+
+// Set of 3D points with insert, erase and move on top of FlatKDTree
+// The points are identified by the id returned by insert, ids of erased
+// points are reused by the next inserts
+//
+// The points are split between a buffer of up to buffer_capacity points and
+// levels of static FlatKDTree, the level i holding at most
+// buffer_capacity * growth^(i + 1) points (logarithmic method)
+// When the buffer is full it is merged with the smallest levels into the
+// first level that can hold all of them, so a point is rebuilt at most
+// growth times per level ie O(growth log(n) log(n) / log(growth)) amortized
+// per insert, and the queries search O(log(n) / log(growth)) trees
+// The points of a level are erased by replacing them by the padding points
+// at infinity of the FlatKDTree blocks, which the queries never return, and a
+// level is rebuilt once half of its points are erased
+// A point moved inside the leaf that contains it is updated in place, which
+// is the common case for points moving a bit every frame, otherwise it is
+// erased from its level and inserted in the buffer
+//
+// ex:
+// DynamicKDTree tree;
+// uint32_t id = tree.insert(glm::vec3(0.f, 1.f, 2.f));
+// tree.move(id, glm::vec3(0.f, 1.f, 3.f));
+// uint32_t inearest = tree.nearest(glm::vec3(0.f, 0.f, 0.f));
+// tree.erase(id);
+struct DynamicKDTree{
+
+    DynamicKDTree();
+    ~DynamicKDTree();
+
+    // Replaces the points of the tree by /points/ in a single level, the
+    // point i has the id i
+    void build(const glm::vec3* points, const unsigned int point_count);
+    void clear();
+
+    // Merges all the points in a single level to make the queries faster
+    void rebuild();
+
+    uint32_t insert(const glm::vec3 position);
+    void erase(const uint32_t id);
+    void move(const uint32_t id, const glm::vec3 position);
+    glm::vec3 position(const uint32_t id) const;
+
+    // Same as FlatKDTree with the ids of the points
+    uint32_t nearest(const glm::vec3 point, float* squared_distance = nullptr) const;
+    template<typename Function>
+    void radius(const glm::vec3 point, const float radius, const Function& function) const;
+
+    static constexpr uint32_t invalid_index = FlatKDTree::invalid_index;
+
+    // ---- Internal ---- //
+
+    // Location of an id, in a level, in the buffer or erased
+    static constexpr uint32_t buffer_level = UINT32_MAX - 1u;
+    static constexpr uint32_t erased_level = UINT32_MAX;
+    struct Location{
+        uint32_t level;
+        uint32_t slot; // 8 * block + entry in the blocks of the level or buffer
+    };
+
+    // Removes /id/ from its level or buffer without releasing the id
+    void remove(const uint32_t id);
+    // Appends /id/ to the buffer, merging the buffer into the levels first
+    // when it is full
+    void push(const uint32_t id, const glm::vec3 position);
+
+    // Appends the points of the level /ilevel/, or of the buffer with
+    // buffer_level, to the gathered points and empties it
+    void gather(const unsigned int ilevel);
+    // Builds the level /ilevel/ with the gathered points
+    void build_gathered(const unsigned int ilevel);
+    // Maximum number of points of the level /ilevel/
+    uint64_t level_capacity(const unsigned int ilevel) const;
+
+    // ---- Data ---- //
+
+    // Read by the merges and rebuilds, buffer_capacity is read when the
+    // buffer is allocated by the first insert after clear()
+    unsigned int buffer_capacity = 256;
+    unsigned int growth = 8;
+    WorkStealingPool* thread_pool = nullptr;
+
+    unsigned int number_of_points = 0;
+
+    static constexpr unsigned int max_levels = 16;
+    FlatKDTree levels[max_levels];
+    unsigned int level_points[max_levels] = {}; // points not erased
+
+    // Points of the buffer in blocks of 8 with padding points at infinity
+    FlatKDTree::LeafBlock* buffer = nullptr;
+    unsigned int buffer_blocks = 0;
+    unsigned int buffer_size = 0;
+
+    std::vector<Location> locations;
+    std::vector<uint32_t> free_ids;
+
+    // Points gathered by the rebuilds
+    std::vector<glm::vec3> gathered_points;
+    std::vector<uint32_t> gathered_ids;
+};
+
+#include "DynamicKDTree.inl"
+
+#endif
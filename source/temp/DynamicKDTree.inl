@@ -0,0 +1,28 @@
+#ifndef INL_DYNAMIC_KDTREE
+#define INL_DYNAMIC_KDTREE
+
+template<typename Function>
+void DynamicKDTree::radius(const glm::vec3 point, const float radius, const Function& function) const{
+
+    // the erased points of the levels are at infinity and keep invalid_index
+    for(unsigned int ilevel = 0; ilevel != max_levels; ++ilevel){
+        if(level_points[ilevel]){
+            levels[ilevel].radius(point, radius, function);
+        }
+    }
+
+    const float bound = std::nextafter(radius * radius, INFINITY);
+    for(unsigned int iblock = 0; iblock != (buffer_size + 7) / 8; ++iblock){
+        const FlatKDTree::LeafBlock& block = buffer[iblock];
+
+        float squared_distances[8];
+        unsigned int mask = FlatKDTree::block_closer(block, point, bound, squared_distances);
+        for(int ientry = 0; mask; ++ientry, mask >>= 1){
+            if(mask & 1u){
+                function(block.index[ientry], squared_distances[ientry]);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,689 @@
+#define NOMINMAX
+
+#include "FlatKDTree.h"
+#include "WorkStealingPool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <numeric>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <glm/common.hpp>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FlatKDTree::FlatKDTree(){
+}
+
+FlatKDTree::~FlatKDTree(){
+    clear();
+}
+
+// ---- Build ---- //
+
+// Subtrees with more points are split by parallel passes over their points
+static constexpr uint32_t parallel_split_points = 1u << 18;
+// Subtrees with more points build their left child as a separate task
+static constexpr uint32_t task_points = 1u << 14;
+
+// Point and its index in the input array, the points are partitioned by
+// value so that the splits read them sequentially
+struct FlatKDTreeBuildPoint{
+    float coordinates[3];
+    uint32_t index;
+};
+
+// Splits of the subtrees of a FlatKDTree, the points of the node being built
+// are order[begin; end[
+struct FlatKDTreeBuilder{
+
+    void build_subtree(const uint32_t inode, const uint32_t begin, const uint32_t end);
+
+    // Computes the split of the node /inode/ and partitions order[begin; end[
+    // around its median, which is returned
+    uint32_t split(const uint32_t inode, const uint32_t begin, const uint32_t end);
+
+    // split() where the bounding box and the median are computed in parallel
+    // The median is found with a histogram of the split dimension, then the
+    // points are partitioned between the bins below, in and above the bin of
+    // the median through /scratch/ and only the median bin is sorted with
+    // nth_element
+    uint32_t split_parallel(const uint32_t inode, const uint32_t begin, const uint32_t end);
+
+    FlatKDTree* tree = nullptr;
+    FlatKDTreeBuildPoint* order = nullptr;
+    FlatKDTreeBuildPoint* scratch = nullptr;
+    uint32_t* leaf_begin = nullptr;
+    FlatKDTree::Node* nodes = nullptr;
+    WorkStealingPool* thread_pool = nullptr;
+};
+
+void FlatKDTreeBuilder::build_subtree(const uint32_t inode, const uint32_t begin, const uint32_t end){
+
+    if(inode >= tree->number_of_nodes){
+        leaf_begin[inode - tree->number_of_nodes] = begin;
+        return;
+    }
+
+    const uint32_t median = thread_pool && end - begin >= parallel_split_points
+        ? split_parallel(inode, begin, end) : split(inode, begin, end);
+
+    if(thread_pool && end - begin >= task_points){
+        FlatKDTreeBuilder* builder = this;
+        WorkStealingPool::TaskGroup group;
+        thread_pool->run(group, [builder, inode, begin, median](){
+            builder->build_subtree(2 * inode + 1, begin, median);
+        });
+        build_subtree(2 * inode + 2, median, end);
+        thread_pool->wait(group);
+
+    }else{
+        build_subtree(2 * inode + 1, begin, median);
+        build_subtree(2 * inode + 2, median, end);
+    }
+}
+
+uint32_t FlatKDTreeBuilder::split(const uint32_t inode, const uint32_t begin, const uint32_t end){
+
+    glm::vec3 min_corner = glm::vec3(INFINITY);
+    glm::vec3 max_corner = glm::vec3(- INFINITY);
+    for(uint32_t iorder = begin; iorder != end; ++iorder){
+        const glm::vec3 point(order[iorder].coordinates[0], order[iorder].coordinates[1], order[iorder].coordinates[2]);
+        min_corner = glm::min(min_corner, point);
+        max_corner = glm::max(max_corner, point);
+    }
+
+    const glm::vec3 extent = max_corner - min_corner;
+    const uint32_t dimension = extent.x >= extent.y && extent.x >= extent.z ? 0u
+        : (extent.y >= extent.z ? 1u : 2u);
+
+    const uint32_t median = begin + (end - begin) / 2;
+    std::nth_element(order + begin, order + median, order + end,
+            [dimension](const FlatKDTreeBuildPoint& A, const FlatKDTreeBuildPoint& B){
+        return A.coordinates[dimension] < B.coordinates[dimension];
+    });
+
+    nodes[inode] = {order[median].coordinates[dimension], dimension};
+    return median;
+}
+
+uint32_t FlatKDTreeBuilder::split_parallel(const uint32_t inode, const uint32_t begin, const uint32_t end){
+
+    constexpr int number_of_chunks = 64;
+    constexpr int number_of_bins = 1024;
+    const uint32_t chunk_points = (end - begin + number_of_chunks - 1) / number_of_chunks;
+
+    auto chunk_begin = [=](const int ichunk){
+        return begin + std::min(end - begin, ichunk * chunk_points);
+    };
+
+    // ---- Bounding box ---- //
+
+    glm::vec3 chunk_min[number_of_chunks];
+    glm::vec3 chunk_max[number_of_chunks];
+    thread_pool->parallel_for(0, number_of_chunks, 1, [&](const int range_begin, const int range_end){
+        for(int ichunk = range_begin; ichunk != range_end; ++ichunk){
+            glm::vec3 min_corner = glm::vec3(INFINITY);
+            glm::vec3 max_corner = glm::vec3(- INFINITY);
+            for(uint32_t iorder = chunk_begin(ichunk); iorder != chunk_begin(ichunk + 1); ++iorder){
+                const glm::vec3 point(order[iorder].coordinates[0], order[iorder].coordinates[1], order[iorder].coordinates[2]);
+                min_corner = glm::min(min_corner, point);
+                max_corner = glm::max(max_corner, point);
+            }
+            chunk_min[ichunk] = min_corner;
+            chunk_max[ichunk] = max_corner;
+        }
+    });
+
+    glm::vec3 min_corner = chunk_min[0];
+    glm::vec3 max_corner = chunk_max[0];
+    for(int ichunk = 1; ichunk != number_of_chunks; ++ichunk){
+        min_corner = glm::min(min_corner, chunk_min[ichunk]);
+        max_corner = glm::max(max_corner, chunk_max[ichunk]);
+    }
+
+    const glm::vec3 extent = max_corner - min_corner;
+    const uint32_t dimension = extent.x >= extent.y && extent.x >= extent.z ? 0u
+        : (extent.y >= extent.z ? 1u : 2u);
+
+    const uint32_t median = begin + (end - begin) / 2;
+
+    // every point is a median
+    if(extent[dimension] == 0.f){
+        nodes[inode] = {min_corner[dimension], dimension};
+        return median;
+    }
+
+    // ---- Histogram ---- //
+
+    // the bins are non-decreasing with the coordinate so a point in a lower
+    // bin is strictly below a point in a higher bin
+    const float bin_min = min_corner[dimension];
+    const float bin_scale = number_of_bins / extent[dimension];
+    auto bin = [=](const float coordinate){
+        return std::min(number_of_bins - 1, (int)((coordinate - bin_min) * bin_scale));
+    };
+
+    std::vector<uint32_t> histograms(number_of_chunks * number_of_bins, 0u);
+    thread_pool->parallel_for(0, number_of_chunks, 1, [&](const int range_begin, const int range_end){
+        for(int ichunk = range_begin; ichunk != range_end; ++ichunk){
+            uint32_t* histogram = histograms.data() + ichunk * number_of_bins;
+            for(uint32_t iorder = chunk_begin(ichunk); iorder != chunk_begin(ichunk + 1); ++iorder){
+                ++histogram[bin(order[iorder].coordinates[dimension])];
+            }
+        }
+    });
+
+    int median_bin = 0;
+    uint32_t below_median_bin = 0;
+    for(;; ++median_bin){
+        uint32_t bin_points = 0;
+        for(int ichunk = 0; ichunk != number_of_chunks; ++ichunk){
+            bin_points += histograms[ichunk * number_of_bins + median_bin];
+        }
+        if(begin + below_median_bin + bin_points > median){
+            break;
+        }
+        below_median_bin += bin_points;
+    }
+
+    // ---- Partition ---- //
+
+    // destination of the first point of each chunk in the three groups
+    uint32_t chunk_output[number_of_chunks][3];
+    uint32_t group_begin[3] = {begin, begin + below_median_bin, 0u};
+    uint32_t group_size[3] = {0u, 0u, 0u};
+    for(int ichunk = 0; ichunk != number_of_chunks; ++ichunk){
+        const uint32_t* histogram = histograms.data() + ichunk * number_of_bins;
+        const uint32_t chunk_lower = std::accumulate(histogram, histogram + median_bin, 0u);
+        const uint32_t chunk_middle = histogram[median_bin];
+        const uint32_t chunk_upper = chunk_begin(ichunk + 1) - chunk_begin(ichunk) - chunk_lower - chunk_middle;
+
+        chunk_output[ichunk][0] = group_size[0];
+        chunk_output[ichunk][1] = group_size[1];
+        chunk_output[ichunk][2] = group_size[2];
+        group_size[0] += chunk_lower;
+        group_size[1] += chunk_middle;
+        group_size[2] += chunk_upper;
+    }
+    group_begin[2] = group_begin[1] + group_size[1];
+
+    thread_pool->parallel_for(0, number_of_chunks, 1, [&](const int range_begin, const int range_end){
+        for(int ichunk = range_begin; ichunk != range_end; ++ichunk){
+            uint32_t output[3] = {group_begin[0] + chunk_output[ichunk][0],
+                group_begin[1] + chunk_output[ichunk][1],
+                group_begin[2] + chunk_output[ichunk][2]};
+
+            for(uint32_t iorder = chunk_begin(ichunk); iorder != chunk_begin(ichunk + 1); ++iorder){
+                const int point_bin = bin(order[iorder].coordinates[dimension]);
+                const int group = (point_bin >= median_bin) + (point_bin > median_bin);
+                scratch[output[group]++] = order[iorder];
+            }
+        }
+    });
+
+    thread_pool->parallel_for(0, number_of_chunks, 1, [&](const int range_begin, const int range_end){
+        std::copy(scratch + chunk_begin(range_begin), scratch + chunk_begin(range_end), order + chunk_begin(range_begin));
+    });
+
+    std::nth_element(order + group_begin[1], order + median, order + group_begin[2],
+            [dimension](const FlatKDTreeBuildPoint& A, const FlatKDTreeBuildPoint& B){
+        return A.coordinates[dimension] < B.coordinates[dimension];
+    });
+
+    nodes[inode] = {order[median].coordinates[dimension], dimension};
+    return median;
+}
+
+void FlatKDTree::build(const glm::vec3* points, const unsigned int point_count, WorkStealingPool* thread_pool){
+
+    clear();
+
+    number_of_points = point_count;
+
+    // smallest depth with at most max_leaf_points points per leaf
+    const uint64_t leaf_points = std::max(1u, max_leaf_points);
+    depth = 0;
+    while(((uint64_t)number_of_points + (1ull << depth) - 1) >> depth > leaf_points){
+        ++depth;
+    }
+    number_of_leaves = 1u << depth;
+    number_of_nodes = number_of_leaves - 1;
+
+    // ---- Splits ---- //
+
+    std::vector<FlatKDTreeBuildPoint> order(number_of_points);
+    std::vector<FlatKDTreeBuildPoint> scratch(thread_pool && number_of_points >= parallel_split_points ? number_of_points : 0u);
+    std::vector<uint32_t> leaf_begin(number_of_leaves + 1);
+    std::vector<Node> split_nodes(number_of_nodes);
+
+    auto fill_order = [&order, points](const int range_begin, const int range_end){
+        for(int ipoint = range_begin; ipoint != range_end; ++ipoint){
+            order[ipoint] = {{points[ipoint].x, points[ipoint].y, points[ipoint].z}, (uint32_t)ipoint};
+        }
+    };
+    if(thread_pool){
+        thread_pool->parallel_for(0, number_of_points, 1 << 20, fill_order);
+    }else{
+        fill_order(0, number_of_points);
+    }
+
+    FlatKDTreeBuilder builder;
+    builder.tree = this;
+    builder.order = order.data();
+    builder.scratch = scratch.data();
+    builder.leaf_begin = leaf_begin.data();
+    builder.nodes = split_nodes.data();
+    builder.thread_pool = thread_pool;
+    builder.build_subtree(0, 0, number_of_points);
+    leaf_begin[number_of_leaves] = number_of_points;
+
+    // ---- Storage ---- //
+
+    std::vector<uint32_t> offsets(number_of_leaves + 1);
+    offsets[0] = 0;
+    for(unsigned int ileaf = 0; ileaf != number_of_leaves; ++ileaf){
+        offsets[ileaf + 1] = offsets[ileaf] + (leaf_begin[ileaf + 1] - leaf_begin[ileaf] + 7) / 8;
+    }
+    number_of_blocks = offsets[number_of_leaves];
+
+    auto section_bytes = [](const size_t bytes){
+        return (bytes + 63) / 64 * 64;
+    };
+    const size_t nodes_bytes = section_bytes(number_of_nodes * sizeof(Node));
+    const size_t offsets_bytes = section_bytes((number_of_leaves + 1) * sizeof(uint32_t));
+    const size_t blocks_bytes = number_of_blocks * sizeof(LeafBlock);
+
+    storage_bytes = nodes_bytes + offsets_bytes + blocks_bytes;
+    storage = ::operator new(storage_bytes, std::align_val_t(64));
+
+    nodes = (Node*)storage;
+    leaf_offsets = (uint32_t*)((char*)storage + nodes_bytes);
+    blocks = (LeafBlock*)((char*)storage + nodes_bytes + offsets_bytes);
+
+    std::copy(split_nodes.begin(), split_nodes.end(), nodes);
+    std::copy(offsets.begin(), offsets.end(), leaf_offsets);
+
+    auto fill_leaves = [&](const int leaf_range_begin, const int leaf_range_end){
+        for(int ileaf = leaf_range_begin; ileaf != leaf_range_end; ++ileaf){
+            const uint32_t leaf_points = leaf_begin[ileaf + 1] - leaf_begin[ileaf];
+
+            for(uint32_t ientry = 0; ientry != 8 * (leaf_offsets[ileaf + 1] - leaf_offsets[ileaf]); ++ientry){
+                LeafBlock& block = blocks[leaf_offsets[ileaf] + ientry / 8];
+
+                if(ientry < leaf_points){
+                    const FlatKDTreeBuildPoint& point = order[leaf_begin[ileaf] + ientry];
+                    block.x[ientry % 8] = point.coordinates[0];
+                    block.y[ientry % 8] = point.coordinates[1];
+                    block.z[ientry % 8] = point.coordinates[2];
+                    block.index[ientry % 8] = point.index;
+                }else{
+                    block.x[ientry % 8] = INFINITY;
+                    block.y[ientry % 8] = INFINITY;
+                    block.z[ientry % 8] = INFINITY;
+                    block.index[ientry % 8] = invalid_index;
+                }
+            }
+        }
+    };
+    if(thread_pool){
+        thread_pool->parallel_for(0, number_of_leaves, 1024, fill_leaves);
+    }else{
+        fill_leaves(0, number_of_leaves);
+    }
+}
+
+void FlatKDTree::clear(){
+    if(storage){
+        ::operator delete(storage, std::align_val_t(64));
+    }
+
+    if(mapping){
+#if defined(_WIN32)
+        UnmapViewOfFile(mapping);
+        CloseHandle((HANDLE)mapping_handle);
+        mapping_handle = nullptr;
+#else
+        munmap(mapping, mapping_bytes);
+#endif
+    }
+    mapping = nullptr;
+    mapping_bytes = 0;
+
+    storage = nullptr;
+    storage_bytes = 0;
+    nodes = nullptr;
+    leaf_offsets = nullptr;
+    blocks = nullptr;
+    number_of_blocks = 0;
+
+    number_of_points = 0;
+    depth = 0;
+    number_of_nodes = 0;
+    number_of_leaves = 0;
+}
+
+uint32_t FlatKDTree::nearest(const glm::vec3 point, float* squared_distance, const float squared_bound) const{
+
+    uint32_t best = invalid_index;
+    float best_distance = squared_bound;
+
+    if(!number_of_points){
+        if(squared_distance){
+            *squared_distance = best_distance;
+        }
+        return best;
+    }
+
+    // subtrees to visit with a lower bound of their squared distance to /point/
+    // The nearest child is always visited first so there are at most depth
+    // pending subtrees
+    struct Entry{
+        uint32_t node;
+        float distance;
+    };
+    Entry stack[64];
+    int stack_size = 0;
+    stack[stack_size++] = {0u, 0.f};
+
+    while(stack_size){
+        const Entry entry = stack[--stack_size];
+        if(entry.distance >= best_distance){
+            continue;
+        }
+
+        uint32_t inode = entry.node;
+        while(inode < number_of_nodes){
+            const Node node = nodes[inode];
+            const float difference = point[node.dimension] - node.split;
+            const uint32_t near_child = 2 * inode + 1 + (difference >= 0.f);
+            const uint32_t far_child = 2 * inode + 1 + (difference < 0.f);
+
+            stack[stack_size++] = {far_child, std::max(entry.distance, difference * difference)};
+            inode = near_child;
+        }
+
+        const uint32_t ileaf = inode - number_of_nodes;
+        for(uint32_t iblock = leaf_offsets[ileaf]; iblock != leaf_offsets[ileaf + 1]; ++iblock){
+            const LeafBlock& block = blocks[iblock];
+
+            float squared_distances[8];
+            unsigned int mask = block_closer(block, point, best_distance, squared_distances);
+            for(int ientry = 0; mask; ++ientry, mask >>= 1){
+                if((mask & 1u) && squared_distances[ientry] < best_distance){
+                    best_distance = squared_distances[ientry];
+                    best = block.index[ientry];
+                }
+            }
+        }
+    }
+
+    if(squared_distance){
+        *squared_distance = best_distance;
+    }
+    return best;
+}
+
+unsigned int FlatKDTree::knn(const glm::vec3 point, const unsigned int k, Neighbor* neighbors) const{
+
+    if(!k || !number_of_points){
+        return 0u;
+    }
+
+    // max-heap on the squared distance, the farthest neighbor found is
+    // neighbors[0] and bounds the search once there are k neighbors
+    auto closer = [](const Neighbor& A, const Neighbor& B){
+        return A.squared_distance < B.squared_distance;
+    };
+    unsigned int size = 0;
+    float bound = INFINITY;
+
+    struct Entry{
+        uint32_t node;
+        float distance;
+    };
+    Entry stack[64];
+    int stack_size = 0;
+    stack[stack_size++] = {0u, 0.f};
+
+    while(stack_size){
+        const Entry entry = stack[--stack_size];
+        if(entry.distance >= bound){
+            continue;
+        }
+
+        uint32_t inode = entry.node;
+        while(inode < number_of_nodes){
+            const Node node = nodes[inode];
+            const float difference = point[node.dimension] - node.split;
+            const uint32_t near_child = 2 * inode + 1 + (difference >= 0.f);
+            const uint32_t far_child = 2 * inode + 1 + (difference < 0.f);
+
+            stack[stack_size++] = {far_child, std::max(entry.distance, difference * difference)};
+            inode = near_child;
+        }
+
+        const uint32_t ileaf = inode - number_of_nodes;
+        for(uint32_t iblock = leaf_offsets[ileaf]; iblock != leaf_offsets[ileaf + 1]; ++iblock){
+            const LeafBlock& block = blocks[iblock];
+
+            float squared_distances[8];
+            unsigned int mask = block_closer(block, point, bound, squared_distances);
+            for(int ientry = 0; mask; ++ientry, mask >>= 1){
+                if(!(mask & 1u) || squared_distances[ientry] >= bound){
+                    continue;
+                }
+
+                if(size == k){
+                    std::pop_heap(neighbors, neighbors + size, closer);
+                    --size;
+                }
+                neighbors[size++] = {squared_distances[ientry], block.index[ientry]};
+                std::push_heap(neighbors, neighbors + size, closer);
+
+                if(size == k){
+                    bound = neighbors[0].squared_distance;
+                }
+            }
+        }
+    }
+
+    std::sort_heap(neighbors, neighbors + size, closer);
+    return size;
+}
+
+void FlatKDTree::nearest_batch(const glm::vec3* queries, const unsigned int count,
+        uint32_t* output_indices, float* output_squared_distances) const{
+
+    if(!number_of_points){
+        std::fill(output_indices, output_indices + count, invalid_index);
+        if(output_squared_distances){
+            std::fill(output_squared_distances, output_squared_distances + count, INFINITY);
+        }
+        return;
+    }
+
+    // counting sort of the queries by leaf, the leaves are numbered along the
+    // splits so queries in nearby leaves are also close
+    std::vector<uint32_t> query_leaf(count);
+    std::vector<uint32_t> leaf_begin(number_of_leaves + 1, 0u);
+    for(unsigned int iquery = 0; iquery != count; ++iquery){
+        query_leaf[iquery] = leaf(queries[iquery]);
+        ++leaf_begin[query_leaf[iquery] + 1];
+    }
+    for(unsigned int ileaf = 0; ileaf != number_of_leaves; ++ileaf){
+        leaf_begin[ileaf + 1] += leaf_begin[ileaf];
+    }
+
+    std::vector<uint32_t> order(count);
+    for(unsigned int iquery = 0; iquery != count; ++iquery){
+        order[leaf_begin[query_leaf[iquery]]++] = iquery;
+    }
+
+    for(const uint32_t iquery : order){
+        output_indices[iquery] = nearest(queries[iquery],
+                output_squared_distances ? output_squared_distances + iquery : nullptr);
+    }
+}
+
+// ---- File ---- //
+
+constexpr char FlatKDTree::file_magic[8];
+
+static_assert(sizeof(FlatKDTree::FileHeader) <= FlatKDTree::file_header_bytes && FlatKDTree::file_header_bytes % 64 == 0,
+        "FlatKDTree::FileHeader : the storage must start on a multiple of 64 bytes");
+
+bool FlatKDTree::write(const std::string& path) const{
+
+    std::ofstream stream(path, std::ios::binary);
+    if(!stream){
+        return false;
+    }
+
+    // the sections are at the same offsets from /nodes/ in the storage and in a mapping
+    const char* storage_begin = (const char*)nodes;
+
+    stream.write(file_magic, sizeof(file_magic));
+    put_bytes(stream, file_version);
+    put_bytes(stream, file_header_bytes);
+    put_bytes(stream, file_byte_order);
+    put_bytes(stream, (uint32_t)sizeof(Node));
+    put_bytes(stream, (uint32_t)sizeof(LeafBlock));
+    put_bytes(stream, (uint32_t)max_leaf_points);
+    put_bytes(stream, (uint32_t)number_of_points);
+    put_bytes(stream, (uint32_t)depth);
+    put_bytes(stream, (uint32_t)number_of_nodes);
+    put_bytes(stream, (uint32_t)number_of_leaves);
+    put_bytes(stream, (uint32_t)number_of_blocks);
+    put_bytes(stream, (uint32_t)0);
+    put_bytes(stream, (uint64_t)0);
+    put_bytes(stream, (uint64_t)(storage_begin ? (const char*)leaf_offsets - storage_begin : 0));
+    put_bytes(stream, (uint64_t)(storage_begin ? (const char*)blocks - storage_begin : 0));
+    put_bytes(stream, (uint64_t)storage_bytes);
+
+    const char padding[file_header_bytes] = {};
+    stream.write(padding, file_header_bytes - sizeof(FileHeader));
+
+    if(storage_bytes){
+        stream.write(storage_begin, storage_bytes);
+    }
+
+    return (bool)stream;
+}
+
+bool FlatKDTree::map(const std::string& path){
+
+    clear();
+
+    // ---- Mapping ---- //
+
+    void* file_mapping = nullptr;
+    size_t file_bytes = 0;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE){
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    HANDLE file_mapping_handle = nullptr;
+    if(GetFileSizeEx(file, &file_size) && file_size.QuadPart >= file_header_bytes){
+        file_bytes = (size_t)file_size.QuadPart;
+        file_mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+
+    if(file_mapping_handle){
+        file_mapping = MapViewOfFile(file_mapping_handle, FILE_MAP_READ, 0, 0, 0);
+        if(!file_mapping){
+            CloseHandle(file_mapping_handle);
+        }
+    }
+    if(!file_mapping){
+        return false;
+    }
+
+    mapping_handle = file_mapping_handle;
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if(file == -1){
+        return false;
+    }
+
+    struct stat file_status;
+    if(fstat(file, &file_status) == 0 && file_status.st_size >= (off_t)file_header_bytes){
+        file_bytes = (size_t)file_status.st_size;
+        file_mapping = mmap(nullptr, file_bytes, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+
+    if(!file_mapping || file_mapping == MAP_FAILED){
+        return false;
+    }
+#endif
+
+    mapping = file_mapping;
+    mapping_bytes = file_bytes;
+
+    // ---- Header ---- //
+
+    FileHeader header;
+    std::memcpy(&header, mapping, sizeof(FileHeader));
+
+    auto section_bytes = [](const size_t bytes){
+        return (bytes + 63) / 64 * 64;
+    };
+
+    const bool valid = std::memcmp(header.magic, file_magic, sizeof(file_magic)) == 0
+        && header.version == file_version
+        && header.header_bytes == file_header_bytes
+        && header.byte_order == file_byte_order
+        && header.node_bytes == sizeof(Node)
+        && header.block_bytes == sizeof(LeafBlock)
+        && header.depth < 32
+        && header.number_of_leaves == (header.storage_bytes ? 1u << header.depth : 0u)
+        && header.number_of_nodes == (header.storage_bytes ? header.number_of_leaves - 1 : 0u)
+        && header.nodes_offset == 0
+        && header.leaf_offsets_offset == (header.storage_bytes ? section_bytes(header.number_of_nodes * sizeof(Node)) : 0u)
+        && header.blocks_offset == (header.storage_bytes ? header.leaf_offsets_offset
+            + section_bytes((header.number_of_leaves + 1) * sizeof(uint32_t)) : 0u)
+        && header.storage_bytes == (header.storage_bytes ? header.blocks_offset
+            + header.number_of_blocks * sizeof(LeafBlock) : 0u)
+        && header.storage_bytes <= file_bytes - file_header_bytes;
+
+    if(!valid){
+        clear();
+        return false;
+    }
+
+    char* storage_begin = (char*)mapping + file_header_bytes;
+
+    max_leaf_points = header.max_leaf_points;
+    number_of_points = header.number_of_points;
+    depth = header.depth;
+    number_of_nodes = header.number_of_nodes;
+    number_of_leaves = header.number_of_leaves;
+    number_of_blocks = header.number_of_blocks;
+    storage_bytes = header.storage_bytes;
+
+    if(storage_bytes){
+        nodes = (Node*)(storage_begin + header.nodes_offset);
+        leaf_offsets = (uint32_t*)(storage_begin + header.leaf_offsets_offset);
+        blocks = (LeafBlock*)(storage_begin + header.blocks_offset);
+    }
+
+    return true;
+}
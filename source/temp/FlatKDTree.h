@@ -0,0 +1,171 @@
+#ifndef H_FLAT_KDTREE
+#define H_FLAT_KDTREE
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <glm/vec3.hpp>
+
+struct WorkStealingPool;
+
+// KDTree over 3D points stored in a single allocation without pointers
+// The inner nodes form an implicit complete binary tree in breadth-first order
+// ie the children of the node i are 2i + 1 and 2i + 2, and each node only
+// stores its split plane
+// Every split is at the median of the dimension of largest extent so all the
+// leaves are at the same depth, the leaf j being the node number_of_nodes + j
+// The points of a leaf are stored in blocks of 8 points in SoA layout ie
+// {x[8], y[8], z[8], index[8]} on two cache lines, with the index of each point
+// in the input array, and the last block of a leaf is padded with points at
+// infinity
+//
+// ex:
+// FlatKDTree tree;
+// tree.build(points.data(), points.size());
+// uint32_t inearest = tree.nearest(glm::vec3(0.f, 1.f, 2.f));
+struct FlatKDTree{
+
+    // 8 points of a leaf, aligned on 64 bytes in the storage of the tree
+    struct LeafBlock{
+        float x[8];
+        float y[8];
+        float z[8];
+        uint32_t index[8];
+    };
+
+    FlatKDTree();
+    ~FlatKDTree();
+
+    // The tree stores a copy of the points, /points/ is not used after build
+    // With a /thread_pool/ the subtrees are built as tasks of the pool and
+    // the splits of the largest subtrees use parallel passes over their points
+    void build(const glm::vec3* points, const unsigned int point_count,
+            WorkStealingPool* thread_pool = nullptr);
+    void clear();
+
+    // Index of the point nearest to /point/ in the array given to build or
+    // invalid_index when the tree is empty
+    // The squared distance to that point is written to /squared_distance/
+    // Only the points at a squared distance below /squared_bound/ are
+    // considered, which prunes the search when the bound comes from another
+    // tree holding a part of the points, and squared_bound is written when
+    // there is none
+    uint32_t nearest(const glm::vec3 point, float* squared_distance = nullptr,
+            const float squared_bound = INFINITY) const;
+
+    // The /k/ points nearest to /point/ sorted by increasing distance, the
+    // number of points written to /neighbors/ ie min(k, number_of_points) is
+    // returned
+    // /neighbors/ must have room for /k/ neighbors and is used as a max-heap
+    // of the k nearest points found during the search
+    struct Neighbor{
+        float squared_distance;
+        uint32_t index;
+    };
+    unsigned int knn(const glm::vec3 point, const unsigned int k, Neighbor* neighbors) const;
+
+    // Calls function(index, squared_distance) for every point at a distance
+    // of at most /radius/ from /point/, in no particular order
+    template<typename Function>
+    void radius(const glm::vec3 point, const float radius, const Function& function) const;
+
+    // nearest() for each of the /count/ points of /queries/
+    // The queries are sorted by the leaf that contains them so that
+    // consecutive searches visit the same nodes and leaves while they are in
+    // the cache, each query is still searched on its own
+    // Bounding a search by the result of the previous query does not prune
+    // more than the first leaf of the search already does
+    void nearest_batch(const glm::vec3* queries, const unsigned int count,
+            uint32_t* output_indices, float* output_squared_distances = nullptr) const;
+
+    // Writes the squared distances between /point/ and the points of /block/
+    // to /squared_distances/ and returns the mask of the points with a
+    // squared distance below /bound/
+    static inline unsigned int block_closer(const LeafBlock& block, const glm::vec3 point,
+            const float bound, float* squared_distances);
+
+    // Leaf that would contain /point/
+    inline uint32_t leaf(const glm::vec3 point) const;
+
+    static constexpr uint32_t invalid_index = UINT32_MAX;
+
+    // ---- File ---- //
+
+    // Writes a header followed by /storage/ to /path/, which must not be the
+    // file mapped by this tree
+    // Returns false when the file could not be written
+    bool write(const std::string& path) const;
+
+    // Maps the file written by write() read-only and points the sections of
+    // the tree to the mapping ie the queries read the pages of the file
+    // without parsing or copying them
+    // The tree must not be modified until clear() or the next build / map
+    // Returns false when the file could not be mapped or when its header does
+    // not match this version of the format, the content is not validated
+    bool map(const std::string& path);
+
+    // The storage starts at file_header_bytes, a multiple of 64 bytes, in the
+    // file so that the sections keep their alignment in the mapping
+    // The fields are written in this order by put_bytes
+    struct FileHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t header_bytes;
+        uint32_t byte_order; // file_byte_order in the byte order of the writer
+        uint32_t node_bytes;
+        uint32_t block_bytes;
+        uint32_t max_leaf_points;
+        uint32_t number_of_points;
+        uint32_t depth;
+        uint32_t number_of_nodes;
+        uint32_t number_of_leaves;
+        uint32_t number_of_blocks;
+        uint32_t reserved;
+        uint64_t nodes_offset;
+        uint64_t leaf_offsets_offset;
+        uint64_t blocks_offset;
+        uint64_t storage_bytes;
+    };
+    static constexpr char file_magic[8] = "FKDTREE";
+    static constexpr uint32_t file_version = 1;
+    static constexpr uint32_t file_header_bytes = 128;
+    static constexpr uint32_t file_byte_order = 0x01020304;
+
+    // ---- Data ---- //
+
+    // Points {x, y, z} are on the left of the node when point[dimension] < split
+    struct Node{
+        float split;
+        uint32_t dimension;
+    };
+
+    // Number of points of a leaf before padding, read by build
+    unsigned int max_leaf_points = 32;
+
+    unsigned int number_of_points = 0;
+    unsigned int depth = 0;
+    unsigned int number_of_nodes = 0; // inner nodes ie 2^depth - 1
+    unsigned int number_of_leaves = 0; // 2^depth
+
+    // Sections of /storage/, each one aligned on 64 bytes
+    // The leaf j uses the blocks [leaf_offsets[j]; leaf_offsets[j + 1][
+    Node* nodes = nullptr;
+    uint32_t* leaf_offsets = nullptr;
+    LeafBlock* blocks = nullptr;
+    unsigned int number_of_blocks = 0;
+
+    void* storage = nullptr;
+    size_t storage_bytes = 0;
+
+    // File mapped by map(), /storage/ is nullptr while a file is mapped
+    void* mapping = nullptr;
+    size_t mapping_bytes = 0;
+#if defined(_WIN32)
+    void* mapping_handle = nullptr;
+#endif
+};
+
+#include "FlatKDTree.inl"
+
+#endif
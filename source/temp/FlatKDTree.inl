@@ -0,0 +1,93 @@
+#ifndef INL_FLAT_KDTREE
+#define INL_FLAT_KDTREE
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+unsigned int FlatKDTree::block_closer(const LeafBlock& block, const glm::vec3 point,
+        const float bound, float* squared_distances){
+
+#if defined(__AVX__)
+    const __m256 dx = _mm256_sub_ps(_mm256_load_ps(block.x), _mm256_set1_ps(point.x));
+    const __m256 dy = _mm256_sub_ps(_mm256_load_ps(block.y), _mm256_set1_ps(point.y));
+    const __m256 dz = _mm256_sub_ps(_mm256_load_ps(block.z), _mm256_set1_ps(point.z));
+    const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+            _mm256_mul_ps(dz, dz));
+
+    _mm256_storeu_ps(squared_distances, distance);
+    return (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_set1_ps(bound), _CMP_LT_OQ));
+#else
+    unsigned int mask = 0u;
+    for(int ientry = 0; ientry != 8; ++ientry){
+        const float dx = block.x[ientry] - point.x;
+        const float dy = block.y[ientry] - point.y;
+        const float dz = block.z[ientry] - point.z;
+        squared_distances[ientry] = dx * dx + dy * dy + dz * dz;
+        mask |= (unsigned int)(squared_distances[ientry] < bound) << ientry;
+    }
+    return mask;
+#endif
+}
+
+uint32_t FlatKDTree::leaf(const glm::vec3 point) const{
+
+    uint32_t inode = 0;
+    while(inode < number_of_nodes){
+        const Node node = nodes[inode];
+        inode = 2 * inode + 1 + (point[node.dimension] >= node.split);
+    }
+    return inode - number_of_nodes;
+}
+
+template<typename Function>
+void FlatKDTree::radius(const glm::vec3 point, const float radius, const Function& function) const{
+
+    if(!number_of_points){
+        return;
+    }
+
+    // the squared distances below the next float are at most radius^2
+    const float squared_radius = radius * radius;
+    const float bound = std::nextafter(squared_radius, INFINITY);
+
+    uint32_t stack[64];
+    int stack_size = 0;
+    stack[stack_size++] = 0u;
+
+    while(stack_size){
+        const uint32_t inode = stack[--stack_size];
+
+        if(inode < number_of_nodes){
+            const Node node = nodes[inode];
+            const float difference = point[node.dimension] - node.split;
+
+            // the points on the left are at most split and the ones on the right at least split
+            if(difference < 0.f || difference * difference <= squared_radius){
+                stack[stack_size++] = 2 * inode + 1;
+            }
+            if(difference >= 0.f || difference * difference <= squared_radius){
+                stack[stack_size++] = 2 * inode + 2;
+            }
+            continue;
+        }
+
+        const uint32_t ileaf = inode - number_of_nodes;
+        for(uint32_t iblock = leaf_offsets[ileaf]; iblock != leaf_offsets[ileaf + 1]; ++iblock){
+            const LeafBlock& block = blocks[iblock];
+
+            float squared_distances[8];
+            unsigned int mask = block_closer(block, point, bound, squared_distances);
+            for(int ientry = 0; mask; ++ientry, mask >>= 1){
+                if(mask & 1u){
+                    function(block.index[ientry], squared_distances[ientry]);
+                }
+            }
+        }
+    }
+}
+
+#endif
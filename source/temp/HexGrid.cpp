@@ -1,5 +1,43 @@
 #include "HexGrid.h"
 
-bool glm::operator<(const glm::ivec3& lhs, const glm::ivec3& rhs){
-	return (lhs.x < rhs.x) || (lhs.x == rhs.x && (lhs.y < rhs.y || (lhs.y == rhs.y && lhs.z < rhs.z)));
+#include <cstdlib>
+
+HexIndexMap::HexIndexMap(){
+}
+
+HexIndexMap::~HexIndexMap(){
+    deallocate();
+}
+
+void HexIndexMap::reserve(const unsigned int number_of_entries){
+
+    deallocate();
+
+    uint64_t number_of_slots = 16;
+    while(number_of_slots < 2 * (uint64_t)number_of_entries){
+        number_of_slots *= 2;
+    }
+
+    slots = (Slot*)malloc(number_of_slots * sizeof(Slot));
+    slot_mask = number_of_slots - 1;
+    for(uint64_t islot = 0; islot != number_of_slots; ++islot){
+        slots[islot].key = empty_key;
+    }
+}
+
+void HexIndexMap::deallocate(){
+    free(slots);
+    slots = nullptr;
+    slot_mask = 0;
+}
+
+void HexIndexMap::insert(const glm::ivec3 cube_coord, const uint32_t index){
+
+    const uint64_t key = pack_axial(cube_coord);
+    uint64_t islot = (uint64_t)hash64shift((long long)key) & slot_mask;
+    while(slots[islot].key != empty_key && slots[islot].key != key){
+        islot = (islot + 1) & slot_mask;
+    }
+    slots[islot].key = key;
+    slots[islot].index = index;
 }
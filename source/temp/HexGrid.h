@@ -1,16 +1,11 @@
 #ifndef H_HONEYCOMB
 #define H_HONEYCOMB
 
-#include <map>
+#include <cstdint>
 #include <vector>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
-// Requierement to use an std::map<glm::ivec3>
-namespace glm{
-	bool operator<(const glm::ivec3& lhs, const glm::ivec3& rhs);
-}
-
 // Constants defined for easy access to neighbor cells
 enum HexNeighbor {TOP_RIGHT, RIGHT, BOTTOM_RIGHT, BOTTOM_LEFT, LEFT, TOP_LEFT};
 constexpr glm::ivec3 neighbor_coord[6] = {{1, 0, -1}, // top-right
@@ -38,13 +33,45 @@ inline glm::vec2 cube_to_world(const glm::ivec3 cube_coord, const float width, c
 // Manhattan distance on the Hexgrid between two coordinates
 inline unsigned int cube_manhattan_distance(const glm::ivec3 A, const glm::ivec3 B);
 
-template<typename T>
-struct HexCell{
-	glm::ivec3 cube_coord = {0, 0, 0};
-	HexCell* neighbors[6] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
-    T* value = nullptr;
+// Packs the axial coordinates {q, r} = {x, z} of /cube_coord/ in 64 bits
+inline uint64_t pack_axial(const glm::ivec3 cube_coord);
+
+// Open addressing hash map from cube coordinates to cell indices, stored in a
+// single allocation with linear probing and hashed with hash64shift
+struct HexIndexMap{
+
+    HexIndexMap();
+    ~HexIndexMap();
+
+    // Removes every entry and allocates slots for /number_of_entries/ entries
+    // at a load factor of at most 1/2
+    void reserve(const unsigned int number_of_entries);
+    void deallocate();
+
+    void insert(const glm::ivec3 cube_coord, const uint32_t index);
+
+    // Returns the index of /cube_coord/ or invalid_index
+    inline uint32_t find(const glm::ivec3 cube_coord) const;
+
+    static constexpr uint32_t invalid_index = UINT32_MAX;
+
+    // The key of the cube coordinates {INT32_MIN, *, INT32_MIN} marks the
+    // empty slots
+    static constexpr uint64_t empty_key = 0x8000000080000000ull;
+
+    struct Slot{
+        uint64_t key;
+        uint32_t index;
+    };
+    Slot* slots = nullptr;
+    uint64_t slot_mask = 0; // number of slots - 1, a power of two minus one
 };
 
+// Cells stored as structure of arrays ie the values of the cells are
+// contiguous in /grid_values/, the coordinates in /coord_x/ and /coord_z/
+// (y = - x - z) and the neighbors are 32-bit indices
+// The neighbors of the cell i are neighbor_indices[6 * i + HexNeighbor], so
+// an update kernel reads the values and the neighbor table linearly
 template<typename T>
 struct HexGrid{
 
@@ -65,22 +92,52 @@ struct HexGrid{
     // from bottom to top
 	void buildGridScanline(unsigned int width, unsigned int height);
 
-    // Update the /neighbors/ of each HexCell in the HexGrid
+    // Cells at arbitrary coordinates, allocated in the order of /cube_coords/
+    // The cells are found with a hash map of the coordinates
+    void buildCustom(const std::vector<glm::ivec3>& cube_coords);
+
+    // Update the /neighbor_indices/ of each cell in the HexGrid
     void updateNeighbors();
 
     // ---- accessors ---- //
 
-    // Returns the HexCell at /cube_coord/ if it exists or nullptr
-    HexCell<T>* searchCell(const glm::ivec3 cube_coord);
-    inline HexCell<T>* searchCell(const int x, const int y, const int z);
+    // Index of the cell at /cube_coord/ or -1 when there is no cell at these
+    // coordinates
+    // The layered and scanline layouts compute the index without lookup
+    inline int cell_index(const glm::ivec3 cube_coord) const;
+
+    inline glm::ivec3 cell_coord(const unsigned int icell) const;
+
+    // Index of the neighbor /ineighbor/ (cf. HexNeighbor) of the cell /icell/
+    // or invalid_cell
+    inline uint32_t neighbor(const unsigned int icell, const int ineighbor) const;
+
+    // Returns the value of the cell at /cube_coord/ if it exists or nullptr
+    T* searchCell(const glm::ivec3 cube_coord);
+    inline T* searchCell(const int x, const int y, const int z);
 
     // ---- data ---- //
 
+    // Allocates the arrays of /cells/ cells
+    void allocate(const unsigned int cells);
+    void deallocate();
+
+    static constexpr uint32_t invalid_cell = UINT32_MAX;
+
     unsigned int number_of_cells = 0;
-    HexCell<T>* grid_cells = nullptr;
     T* grid_values = nullptr;
-
-	std::map<glm::ivec3, HexCell<T>*> coord_to_cell;
+    int* coord_x = nullptr;
+    int* coord_z = nullptr;
+    uint32_t* neighbor_indices = nullptr;
+
+    enum Layout {NONE, LAYERED, SCANLINE, CUSTOM};
+    Layout layout = NONE;
+    unsigned int layout_layers = 0;
+    unsigned int layout_width = 0;
+    unsigned int layout_height = 0;
+
+    // Only used by the CUSTOM layout
+    HexIndexMap coord_to_index;
 };
 
 #include "HexGrid.inl"
@@ -1,6 +1,9 @@
 #ifndef INL_HONEYCOMB
 #define INL_HONEYCOMB
 
+#include "utils.h"
+
+#include <algorithm>
 #include <cmath>
 
 glm::ivec2 cube_to_square(const glm::ivec3 hex_coord){
@@ -32,148 +35,113 @@ unsigned int cube_manhattan_distance(const glm::ivec3 A, const glm::ivec3 B){
     //return std::max(std::max(std::abs(A.x - B.x), std::abs(A.y - B.y)), std::abs(A.z - B.z));
 }
 
+uint64_t pack_axial(const glm::ivec3 cube_coord){
+    return ((uint64_t)(uint32_t)cube_coord.x << 32) | (uint64_t)(uint32_t)cube_coord.z;
+}
+
+uint32_t HexIndexMap::find(const glm::ivec3 cube_coord) const{
+
+    if(!slots){
+        return invalid_index;
+    }
+
+    const uint64_t key = pack_axial(cube_coord);
+    uint64_t islot = (uint64_t)hash64shift((long long)key) & slot_mask;
+    while(slots[islot].key != empty_key){
+        if(slots[islot].key == key){
+            return slots[islot].index;
+        }
+        islot = (islot + 1) & slot_mask;
+    }
+    return invalid_index;
+}
+
 template<typename T>
 HexGrid<T>::HexGrid(){
 }
 
 template<typename T>
 HexGrid<T>::~HexGrid(){
+    deallocate();
 }
 
 template<typename T>
-void HexGrid<T>::buildLayered(unsigned int number_of_layers){
+void HexGrid<T>::allocate(const unsigned int cells){
+    deallocate();
 
-    // compute the number of cells
-	number_of_cells = 0;
-	for(unsigned int layer = 0; layer != number_of_layers; ++layer){
-		number_of_cells += (layer + 1);
-	}
-	number_of_cells = 1 + 6 * number_of_cells;
+    number_of_cells = cells;
+    grid_values = new T[number_of_cells];
+    coord_x = new int[number_of_cells];
+    coord_z = new int[number_of_cells];
+    neighbor_indices = new uint32_t[6 * number_of_cells];
+}
 
-    // free old memory
-    if(grid_cells){
-        delete[] grid_cells;
-    }
-    if(grid_values){
-        delete[] grid_values;
-    }
+template<typename T>
+void HexGrid<T>::deallocate(){
+    delete[] grid_values;
+    delete[] coord_x;
+    delete[] coord_z;
+    delete[] neighbor_indices;
+    grid_values = nullptr;
+    coord_x = nullptr;
+    coord_z = nullptr;
+    neighbor_indices = nullptr;
+    number_of_cells = 0;
+    layout = NONE;
+    coord_to_index.deallocate();
+}
 
-    // allocate new memory
-    grid_cells = new HexCell<T>[number_of_cells];
-    grid_values = new T[number_of_cells];
+template<typename T>
+void HexGrid<T>::buildLayered(unsigned int number_of_layers){
+
+    allocate(1 + 3 * number_of_layers * (number_of_layers + 1));
+    layout = LAYERED;
+    layout_layers = number_of_layers;
 
 	// update the cells coordinates
-	grid_cells[0].cube_coord = {0, 0, 0};
-    grid_cells[0].value = grid_values;
+    coord_x[0] = 0;
+    coord_z[0] = 0;
 	unsigned int cell_offset = 1;
 
-	for(unsigned int layer = 1; layer != number_of_layers + 1; ++layer){
+	for(int layer = 1; layer != (int)number_of_layers + 1; ++layer){
 		glm::ivec3 layer_coord = {layer, 0, -layer};
 
-		// top-right to right
-		for(unsigned int side_cell = 0; side_cell != layer; ++side_cell){
-			grid_cells[cell_offset].cube_coord = layer_coord;
-            grid_cells[cell_offset].value = grid_values + cell_offset;
-
-			layer_coord.y -= 1;
-			layer_coord.z += 1;
-
-			++cell_offset;
-		}
-
-		// right to bottom-right
-		for(unsigned int side_cell = 0; side_cell != layer; ++side_cell){
-			grid_cells[cell_offset].cube_coord = layer_coord;
-            grid_cells[cell_offset].value = grid_values + cell_offset;
-
-			layer_coord.x -= 1;
-			layer_coord.z += 1;
-
-			++cell_offset;
-		}
-
-		// bottom-right to bottom-left
-		for(unsigned int side_cell = 0; side_cell != layer; ++side_cell){
-			grid_cells[cell_offset].cube_coord = layer_coord;
-            grid_cells[cell_offset].value = grid_values + cell_offset;
-
-			layer_coord.x -= 1;
-			layer_coord.y += 1;
-
-			++cell_offset;
-		}
-
-		// bottom-left to left
-		for(unsigned int side_cell = 0; side_cell != layer; ++side_cell){
-			grid_cells[cell_offset].cube_coord = layer_coord;
-            grid_cells[cell_offset].value = grid_values + cell_offset;
-
-			layer_coord.y += 1;
-			layer_coord.z -= 1;
-
-			++cell_offset;
-		}
-
-		// left to top-left
-		for(unsigned int side_cell = 0; side_cell != layer; ++side_cell){
-			grid_cells[cell_offset].cube_coord = layer_coord;
-            grid_cells[cell_offset].value = grid_values + cell_offset;
-
-			layer_coord.x += 1;
-			layer_coord.z -= 1;
-
-			++cell_offset;
-		}
-
-		// top-left to top-right
-		for(unsigned int side_cell = 0; side_cell != layer; ++side_cell){
-			grid_cells[cell_offset].cube_coord = layer_coord;
-            grid_cells[cell_offset].value = grid_values + cell_offset;
-
-			layer_coord.x += 1;
-			layer_coord.y -= 1;
-
-			++cell_offset;
-		}
+        // top-right to right, right to bottom-right, bottom-right to
+        // bottom-left, bottom-left to left, left to top-left, top-left to top-right
+        for(int side = 0; side != 6; ++side){
+            for(int side_cell = 0; side_cell != layer; ++side_cell){
+                coord_x[cell_offset] = layer_coord.x;
+                coord_z[cell_offset] = layer_coord.z;
+
+                layer_coord += side_coord[side];
+                ++cell_offset;
+            }
+        }
 	}
 
-
     updateNeighbors();
 }
 
 template<typename T>
 void HexGrid<T>::buildGridScanline(unsigned int width, unsigned int height){
 
-	// update the allocation
-	number_of_cells = width * height;
-
-    // deallocate old memory
-    if(grid_cells){
-        delete[] grid_cells;
-    }
-    if(grid_values){
-        delete[] grid_values;
-    }
-
-    // allocate new memory
-    grid_cells = new HexCell<T>[number_of_cells];
-    grid_values = new T[number_of_cells];
+    allocate(width * height);
+    layout = SCANLINE;
+    layout_width = width;
+    layout_height = height;
 
     // update the cells coordinates
 	// cube offset of a square row = (row / 2) * (1, 1, -2) + (row % 2) * (1, 0, -1);
 	// cube offset of a square column = column * (1, -1, 0)
 	for(unsigned int row = 0; row != height; ++row){
-		unsigned int double_step = row / 2;
-		unsigned int odd_row = row % 2;
+		const int double_step = row / 2;
+		const int odd_row = row % 2;
 
 		for(unsigned int column = 0; column != width; ++column){
             const unsigned int cell_offset = row * width + column;
 
-			grid_cells[cell_offset].cube_coord.x = double_step + odd_row + column;
-			grid_cells[cell_offset].cube_coord.y = double_step - column;
-			grid_cells[cell_offset].cube_coord.z = - 2 * double_step - odd_row;
-
-            grid_cells[cell_offset].value = grid_values[cell_offset];
+			coord_x[cell_offset] = double_step + odd_row + column;
+			coord_z[cell_offset] = - 2 * double_step - odd_row;
 		}
 	}
 
@@ -181,82 +149,120 @@ void HexGrid<T>::buildGridScanline(unsigned int width, unsigned int height){
 }
 
 template<typename T>
-void HexGrid<T>::updateNeighbors(){
+void HexGrid<T>::buildCustom(const std::vector<glm::ivec3>& cube_coords){
 
-	// adding cells to the map
-	for(unsigned int icell = 0; icell != number_of_cells; ++icell){
-		coord_to_cell.emplace(grid_cells[icell].cube_coord, &grid_cells[icell]);
-	}
+    allocate(cube_coords.size());
+    layout = CUSTOM;
 
-	// updating neighbors
-	for(unsigned int icell = 0; icell != number_of_cells; ++icell){
+    coord_to_index.reserve(number_of_cells);
+    for(unsigned int icell = 0; icell != number_of_cells; ++icell){
+        coord_x[icell] = cube_coords[icell].x;
+        coord_z[icell] = cube_coords[icell].z;
+        coord_to_index.insert(cube_coords[icell], icell);
+    }
 
-		// top-right
-        glm::ivec3 neighbor = {grid_cells[icell].cube_coord.x + 1,
-            grid_cells[icell].cube_coord.y,
-            grid_cells[icell].cube_coord.z - 1};
-        typename std::map<glm::ivec3, HexCell<T>*>::iterator neighbor_iterator = coord_to_cell.find(neighbor);
-		if(neighbor_iterator != coord_to_cell.end()){
-			grid_cells[icell].neighbors[0] = neighbor_iterator->second;
-		}
+    updateNeighbors();
+}
 
-		// right
-		neighbor.y -= 1;
-		neighbor.z += 1;
-		neighbor_iterator = coord_to_cell.find(neighbor);
-		if(neighbor_iterator != coord_to_cell.end()){
-			grid_cells[icell].neighbors[1] = neighbor_iterator->second;
-		}
+template<typename T>
+void HexGrid<T>::updateNeighbors(){
+	for(unsigned int icell = 0; icell != number_of_cells; ++icell){
+        const glm::ivec3 cube_coord = cell_coord(icell);
+        for(int ineighbor = 0; ineighbor != 6; ++ineighbor){
+            const int neighbor_index = cell_index(cube_coord + neighbor_coord[ineighbor]);
+            neighbor_indices[6 * icell + ineighbor] = (neighbor_index < 0) ? invalid_cell : (uint32_t)neighbor_index;
+        }
+	}
+}
 
-		// bottom-right
-		neighbor.x -= 1;
-		neighbor.z += 1;
-		neighbor_iterator = coord_to_cell.find(neighbor);
-		if(neighbor_iterator != coord_to_cell.end()){
-			grid_cells[icell].neighbors[2] = neighbor_iterator->second;
-		}
+template<typename T>
+int HexGrid<T>::cell_index(const glm::ivec3 cube_coord) const{
 
-		// bottom-left
-		neighbor.x -= 1;
-		neighbor.y += 1;
-		neighbor_iterator = coord_to_cell.find(neighbor);
-		if(neighbor_iterator != coord_to_cell.end()){
-			grid_cells[icell].neighbors[3] = neighbor_iterator->second;
-		}
+    // the layouts only store the coordinates of the cube plane, eg the map
+    // of CUSTOM is indexed by x and z
+    if(cube_coord.x + cube_coord.y + cube_coord.z != 0){
+        return -1;
+    }
 
-		// left
-		neighbor.y += 1;
-		neighbor.z -= 1;
-		neighbor_iterator = coord_to_cell.find(neighbor);
-		if(neighbor_iterator != coord_to_cell.end()){
-			grid_cells[icell].neighbors[4] = neighbor_iterator->second;
-		}
+    switch(layout){
+        case LAYERED:
+        {
+            // the cells of the layer L are after the 1 + 3 * L * (L - 1) cells
+            // of the smaller layers, in 6 sides of L cells
+            const int layer = std::max(std::max(std::abs(cube_coord.x), std::abs(cube_coord.y)), std::abs(cube_coord.z));
+            if(layer > (int)layout_layers){
+                return -1;
+            }
+            if(layer == 0){
+                return 0;
+            }
+
+            int side;
+            int side_cell;
+            if(cube_coord.x == layer && cube_coord.z < 0){ // top-right to right
+                side = 0;
+                side_cell = cube_coord.z + layer;
+            }else if(cube_coord.y == -layer && cube_coord.x > 0){ // right to bottom-right
+                side = 1;
+                side_cell = layer - cube_coord.x;
+            }else if(cube_coord.z == layer && cube_coord.y < 0){ // bottom-right to bottom-left
+                side = 2;
+                side_cell = -cube_coord.x;
+            }else if(cube_coord.x == -layer && cube_coord.z > 0){ // bottom-left to left
+                side = 3;
+                side_cell = cube_coord.y;
+            }else if(cube_coord.y == layer && cube_coord.x < 0){ // left to top-left
+                side = 4;
+                side_cell = cube_coord.x + layer;
+            }else{ // top-left to top-right
+                side = 5;
+                side_cell = cube_coord.x;
+            }
+
+            return 1 + 3 * layer * (layer - 1) + side * layer + side_cell;
+        }
+
+        case SCANLINE:
+        {
+            // inverse of the coordinates computed by buildGridScanline
+            const int row = - cube_coord.z;
+            const int column = row / 2 - cube_coord.y;
+            if(row < 0 || row >= (int)layout_height || column < 0 || column >= (int)layout_width){
+                return -1;
+            }
+            return row * layout_width + column;
+        }
+
+        case CUSTOM:
+        {
+            const uint32_t index = coord_to_index.find(cube_coord);
+            return (index == HexIndexMap::invalid_index) ? -1 : (int)index;
+        }
+
+        default:
+            return -1;
+    }
+}
 
-		// top-left
-		neighbor.x += 1;
-		neighbor.z -= 1;
-		neighbor_iterator = coord_to_cell.find(neighbor);
-		if(neighbor_iterator != coord_to_cell.end()){
-			grid_cells[icell].neighbors[5] = neighbor_iterator->second;
-		}
-	}
+template<typename T>
+glm::ivec3 HexGrid<T>::cell_coord(const unsigned int icell) const{
+    return {coord_x[icell], - coord_x[icell] - coord_z[icell], coord_z[icell]};
 }
 
 template<typename T>
-HexCell<T>* HexGrid<T>::searchCell(const glm::ivec3 cube_coord){
-    typename std::map<glm::ivec3, HexCell<T>*>::iterator cell_iterator = coord_to_cell.find(cube_coord);
+uint32_t HexGrid<T>::neighbor(const unsigned int icell, const int ineighbor) const{
+    return neighbor_indices[6 * icell + ineighbor];
+}
 
-    if(cell_iterator != coord_to_cell.end()){
-        return cell_iterator->second;
-    }else{
-        return nullptr;
-    }
+template<typename T>
+T* HexGrid<T>::searchCell(const glm::ivec3 cube_coord){
+    const int index = cell_index(cube_coord);
+    return (index < 0) ? nullptr : grid_values + index;
 }
 
 template<typename T>
-HexCell<T>* HexGrid<T>::searchCell(const int x, const int y, const int z){
-    glm::ivec3 cube_coord(x, y, z);
-    searchCell(cube_coord);
+T* HexGrid<T>::searchCell(const int x, const int y, const int z){
+    return searchCell(glm::ivec3(x, y, z));
 }
 
 #endif
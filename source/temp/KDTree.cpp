@@ -32,7 +32,6 @@ void KDTree::build(std::vector<Star>::iterator begin, std::vector<Star>::iterato
         ++begin){
 
         root->temp.push_back(&(*begin));
-        ++begin;
     }
 
     // initializing the queue of nodes to build
@@ -119,16 +118,15 @@ Star* KDTree::searchNN(const Star* const star){
         [this, star, &best, &bestDist, &sqDist, &searchStep]
         (KDNode* node, const unsigned int depth){
 
-        if(node->isLeaf()){
+        // the inner nodes also store a star ie the split point
+        float currentDist = sqDist(star, node->star);
 
-            float currentDist = sqDist(star, node->star);
-
-            if(currentDist < bestDist){
-                best = node->star;
-                bestDist = currentDist;
-            }
+        if(currentDist < bestDist){
+            best = node->star;
+            bestDist = currentDist;
+        }
 
-        }else{
+        if(!node->isLeaf()){
             const unsigned int dim = depth % 3;
 
             if(star->mPosition.mDim[dim] < node->star->mPosition.mDim[dim]){
@@ -139,7 +137,8 @@ Star* KDTree::searchNN(const Star* const star){
                 }
 
                 // keep searching right if the search radius still reaches the right split
-                if(star->mPosition.mDim[dim] + bestDist >= node->star->mPosition.mDim[dim]
+                const float splitDist = node->star->mPosition.mDim[dim] - star->mPosition.mDim[dim];
+                if(splitDist * splitDist <= bestDist
                     && node->children[1]){
                     searchStep(node->children[1], depth + 1);
                 }
@@ -152,7 +151,8 @@ Star* KDTree::searchNN(const Star* const star){
                 }
 
                 // keep searching left if the search radius still reaches the left split
-                if(star->mPosition.mDim[dim] - bestDist <= node->star->mPosition.mDim[dim]
+                const float splitDist = star->mPosition.mDim[dim] - node->star->mPosition.mDim[dim];
+                if(splitDist * splitDist <= bestDist
                     && node->children[0]){
                     searchStep(node->children[0], depth + 1);
                 }
@@ -1,6 +1,10 @@
 #ifndef KDTREE_H
 #define KDTREE_H
 
+#include "Star.hpp"
+
+#include <vector>
+
 struct KDNode{
     bool isLeaf();
 
@@ -0,0 +1,46 @@
+#ifndef H_PARALLEL_BANDS
+#define H_PARALLEL_BANDS
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+// Number of bands for /number_of_threads/ threads, the hardware concurrency
+// when /number_of_threads/ is 0
+inline int band_count(const unsigned int number_of_threads){
+    return (int)(number_of_threads ? number_of_threads : std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// Splits the rows [0; rows[ in /number_of_bands/ bands and calls
+// band_function(band_index, row_begin, row_end) for each band in parallel
+// The calling thread processes the last band, with the index
+// number_of_bands - 1, while /thread_pool/ processes the others
+template<typename BandFunction>
+void parallel_bands(ThreadPool& thread_pool, const int number_of_bands, const int rows,
+        const BandFunction& band_function){
+
+    const int rows_per_band = (rows + number_of_bands - 1) / number_of_bands;
+
+    std::vector<std::future<void>> band_tasks;
+    band_tasks.reserve(number_of_bands);
+
+    int row_begin = 0;
+    for(int iband = 0; iband != number_of_bands - 1 && row_begin + rows_per_band < rows; ++iband){
+        band_tasks.push_back(thread_pool.Enqueue([&band_function, iband, row_begin, rows_per_band](){
+            band_function(iband, row_begin, row_begin + rows_per_band);
+        }));
+
+        row_begin += rows_per_band;
+    }
+
+    band_function(number_of_bands - 1, row_begin, rows);
+
+    for(std::future<void>& task : band_tasks){
+        task.wait();
+    }
+}
+
+#endif
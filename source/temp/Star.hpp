@@ -0,0 +1,20 @@
+#ifndef STAR_H
+#define STAR_H
+
+// Position of a star, the coordinates are accessed by name or by dimension
+struct StarPosition{
+    union{
+        struct{
+            float mX;
+            float mY;
+            float mZ;
+        };
+        float mDim[3];
+    };
+};
+
+struct Star{
+    StarPosition mPosition;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#define NOMINMAX
+
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Pool and deque of the calling thread when it is a worker
+static thread_local const WorkStealingPool* worker_pool = nullptr;
+static thread_local int worker_deque = -1;
+
+// ---- Chase-Lev deque ---- //
+
+// Push and pop are only called by the owner of the deque, steal by any thread
+// https://fzn.fr/readings/ppopp13.pdf
+
+bool WorkStealingPool::Deque::push(const Task& task){
+
+    const int64_t current_bottom = bottom.load(std::memory_order_relaxed);
+    const int64_t current_top = top.load(std::memory_order_acquire);
+
+    if(current_bottom - current_top >= capacity){
+        return false;
+    }
+
+    write_slot(current_bottom, task);
+    bottom.store(current_bottom + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool WorkStealingPool::Deque::pop(Task& task){
+
+    const int64_t current_bottom = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(current_bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t current_top = top.load(std::memory_order_relaxed);
+
+    if(current_top > current_bottom){
+        bottom.store(current_bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    read_slot(current_bottom, task);
+
+    // last task, competing with the thieves
+    if(current_top == current_bottom){
+        const bool success = top.compare_exchange_strong(current_top, current_top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(current_bottom + 1, std::memory_order_relaxed);
+        return success;
+    }
+
+    return true;
+}
+
+bool WorkStealingPool::Deque::steal(Task& task){
+
+    int64_t current_top = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t current_bottom = bottom.load(std::memory_order_acquire);
+
+    if(current_top >= current_bottom){
+        return false;
+    }
+
+    // the slot cannot be overwritten before top is incremented because the
+    // deque is then full for the owner
+    read_slot(current_top, task);
+
+    return top.compare_exchange_strong(current_top, current_top + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+void WorkStealingPool::Deque::write_slot(const int64_t index, const Task& task){
+
+    uint64_t words[slot_words];
+    memcpy(words, &task, sizeof(Task));
+
+    std::atomic<uint64_t>* slot = slots + (index % capacity) * slot_words;
+    for(int iword = 0; iword != slot_words; ++iword){
+        slot[iword].store(words[iword], std::memory_order_relaxed);
+    }
+}
+
+void WorkStealingPool::Deque::read_slot(const int64_t index, Task& task) const{
+
+    uint64_t words[slot_words];
+
+    const std::atomic<uint64_t>* slot = slots + (index % capacity) * slot_words;
+    for(int iword = 0; iword != slot_words; ++iword){
+        words[iword] = slot[iword].load(std::memory_order_relaxed);
+    }
+
+    memcpy(&task, words, sizeof(Task));
+}
+
+// ---- WorkStealingPool ---- //
+
+WorkStealingPool::WorkStealingPool(const unsigned int number_of_threads){
+
+    static_assert(sizeof(Task) % sizeof(uint64_t) == 0, "WorkStealingPool::Task must be made of 64-bit words");
+
+    number_of_workers = (int)(number_of_threads ? number_of_threads : std::max(1u, std::thread::hardware_concurrency())) - 1;
+    deques = new Deque[number_of_workers + 1];
+
+    workers.reserve(number_of_workers);
+    for(int iworker = 0; iworker != number_of_workers; ++iworker){
+        workers.emplace_back([this, iworker](){
+            worker_loop(iworker);
+        });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stop = true;
+    }
+    sleep_condition.notify_all();
+
+    for(std::thread& worker : workers){
+        worker.join();
+    }
+
+    delete[] deques;
+}
+
+void WorkStealingPool::wait(TaskGroup& group){
+
+    const int deque_index = thread_deque();
+
+    Task task;
+    while(group.pending.load(std::memory_order_acquire) != 0){
+        if(find_task(deque_index, task)){
+            task.function(task);
+        }else{
+            std::this_thread::yield();
+        }
+    }
+}
+
+int WorkStealingPool::thread_deque() const{
+    return (worker_pool == this) ? worker_deque : number_of_workers;
+}
+
+void WorkStealingPool::push(const Task& task){
+
+    const int deque_index = thread_deque();
+
+    bool pushed = false;
+    if(deque_index == number_of_workers){
+        std::lock_guard<std::mutex> lock(external_mutex);
+        pushed = deques[deque_index].push(task);
+    }else{
+        pushed = deques[deque_index].push(task);
+    }
+
+    if(!pushed){
+        task.function(task);
+        return;
+    }
+
+    task_epoch.fetch_add(1, std::memory_order_seq_cst);
+    if(sleeping_workers.load(std::memory_order_seq_cst) > 0){
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        sleep_condition.notify_one();
+    }
+}
+
+bool WorkStealingPool::find_task(const int deque_index, Task& task){
+
+    if(deque_index == number_of_workers){
+        std::lock_guard<std::mutex> lock(external_mutex);
+        if(deques[deque_index].pop(task)){
+            return true;
+        }
+    }else if(deques[deque_index].pop(task)){
+        return true;
+    }
+
+    // the victims are visited from the next deque to spread the thieves
+    for(int ivictim = 1; ivictim != number_of_workers + 1; ++ivictim){
+        if(deques[(deque_index + ivictim) % (number_of_workers + 1)].steal(task)){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingPool::worker_loop(const int worker_index){
+
+    worker_pool = this;
+    worker_deque = worker_index;
+
+    constexpr int spins_before_sleep = 64;
+
+    Task task;
+    while(true){
+        const uint64_t epoch = task_epoch.load(std::memory_order_seq_cst);
+
+        bool found = false;
+        for(int ispin = 0; ispin != spins_before_sleep && !found; ++ispin){
+            found = find_task(worker_index, task);
+            if(!found){
+                std::this_thread::yield();
+            }
+        }
+
+        if(found){
+            task.function(task);
+            continue;
+        }
+
+        // a task pushed after /epoch/ was read changes task_epoch before the
+        // pusher looks at sleeping_workers so either the wait sees the new
+        // epoch or the pusher notifies the condition
+        sleeping_workers.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep_condition.wait(lock, [this, epoch](){
+                return stop || task_epoch.load(std::memory_order_seq_cst) != epoch;
+            });
+
+            if(stop){
+                sleeping_workers.fetch_sub(1, std::memory_order_seq_cst);
+                return;
+            }
+        }
+        sleeping_workers.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
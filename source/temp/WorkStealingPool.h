@@ -0,0 +1,110 @@
+#ifndef H_WORK_STEALING_POOL
+#define H_WORK_STEALING_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool where each worker owns a Chase-Lev deque of tasks : a worker
+// pushes and pops its own tasks in LIFO order and steals the oldest tasks of
+// the other workers when its deque is empty
+// The tasks are stored inline in the deques ie submitting a task does not
+// allocate, which requires trivially copyable callables of at most
+// Task::storage_size bytes such as lambdas capturing pointers and integers
+//
+// ex:
+// WorkStealingPool pool;
+// pool.parallel_for(0, count, 1024, [&](const int begin, const int end){
+//     for(int i = begin; i != end; ++i){ ... }
+// });
+struct WorkStealingPool{
+
+    // number_of_threads = 0 uses one thread per hardware thread
+    // The thread waiting for a task group also executes tasks ie
+    // number_of_threads - 1 threads are created
+    WorkStealingPool(const unsigned int number_of_threads = 0);
+    ~WorkStealingPool();
+
+    // ---- Tasks ---- //
+
+    struct Task{
+        static constexpr size_t storage_size = 56;
+
+        void (*function)(const Task& task) = nullptr;
+        alignas(8) unsigned char storage[storage_size];
+
+        template<typename Function>
+        static Task make(const Function& function);
+    };
+
+    // Number of tasks not completed yet
+    struct TaskGroup{
+        std::atomic<int> pending{0};
+    };
+
+    // Adds a task of /group/ calling a copy of function()
+    // The task is executed immediately when the deque of the thread is full
+    template<typename Function>
+    void run(TaskGroup& group, const Function& function);
+
+    // Executes tasks until all the tasks of /group/ are completed
+    void wait(TaskGroup& group);
+
+    // Calls function(range_begin, range_end) on subranges of [begin; end[ of at
+    // most /grain/ elements in parallel and returns when all of them are done
+    template<typename Function>
+    void parallel_for(const int begin, const int end, const int grain, const Function& function);
+
+    // ---- Chase-Lev deque ---- //
+
+    // Fixed capacity, the slots are copied word by word with atomic operations
+    // so that a thief reading a slot concurrently with the owner is not a data race
+    struct Deque{
+        static constexpr int64_t capacity = 4096;
+        static constexpr int slot_words = sizeof(Task) / sizeof(uint64_t);
+
+        bool push(const Task& task);
+        bool pop(Task& task);
+        bool steal(Task& task);
+
+        void write_slot(const int64_t index, const Task& task);
+        void read_slot(const int64_t index, Task& task) const;
+
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        std::atomic<uint64_t> slots[capacity * slot_words];
+    };
+
+    // Index of the deque of the calling thread, number_of_workers for any
+    // thread that is not a worker of this pool
+    int thread_deque() const;
+
+    void push(const Task& task);
+    bool find_task(const int deque_index, Task& task);
+    void worker_loop(const int worker_index);
+
+    // ---- Data ---- //
+
+    int number_of_workers = 0;
+
+    // one deque per worker thread and a last one for the external threads,
+    // which use it one at a time
+    Deque* deques = nullptr;
+    std::vector<std::thread> workers;
+    std::mutex external_mutex;
+
+    // incremented for every new task so that a worker going to sleep can
+    // detect the tasks added since it last looked at the deques
+    std::atomic<uint64_t> task_epoch{0};
+    std::atomic<int> sleeping_workers{0};
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+    bool stop = false;
+};
+
+#include "WorkStealingPool.inl"
+
+#endif
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+template<typename Function>
+WorkStealingPool::Task WorkStealingPool::Task::make(const Function& function){
+
+    static_assert(sizeof(Function) <= storage_size, "WorkStealingPool::Task : the callable is too large");
+    static_assert(alignof(Function) <= 8, "WorkStealingPool::Task : the callable is over-aligned");
+    static_assert(std::is_trivially_copyable<Function>::value && std::is_trivially_destructible<Function>::value,
+            "WorkStealingPool::Task : the callable must be trivially copyable");
+
+    Task task;
+    new(task.storage) Function(function);
+    task.function = [](const Task& task){
+        (*(const Function*)task.storage)();
+    };
+
+    return task;
+}
+
+template<typename Function>
+void WorkStealingPool::run(TaskGroup& group, const Function& function){
+
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    TaskGroup* task_group = &group;
+    push(Task::make([task_group, function](){
+        function();
+        task_group->pending.fetch_sub(1, std::memory_order_release);
+    }));
+}
+
+template<typename Function>
+void WorkStealingPool::parallel_for(const int begin, const int end, const int grain, const Function& function){
+
+    if(begin >= end){
+        return;
+    }
+
+    TaskGroup group;
+
+    // the right halves are pushed as tasks while the left half is split
+    // further, each task splitting its own range the same way
+    struct Split{
+        WorkStealingPool* pool;
+        TaskGroup* group;
+        const Function* function;
+        int grain;
+
+        void operator()(const int range_begin, int range_end) const{
+            while(range_end - range_begin > grain){
+                const int middle = range_begin + (range_end - range_begin) / 2;
+                const int split_end = range_end;
+                const Split split = *this;
+                pool->run(*group, [split, middle, split_end](){
+                    split(middle, split_end);
+                });
+                range_end = middle;
+            }
+            (*function)(range_begin, range_end);
+        }
+    };
+
+    const Split split = {this, &group, &function, std::max(1, grain)};
+    split(begin, end);
+
+    wait(group);
+}